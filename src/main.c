@@ -4,12 +4,66 @@
 
 #include "skard.h"
 
+enum vm_kind {
+    VM_STACK,
+    VM_REGISTER,
+};
+
+struct run_options {
+    enum vm_kind vm;
+    bool fold;
+    bool ir;
+    bool peephole;
+    bool peephole_stats;
+    size_t inline_threshold;
+    bool jit;
+    size_t jit_threshold;
+    size_t max_stack_size;
+    size_t max_frames;
+    size_t gc_growth_factor;
+    bool gc_incremental;
+    size_t gc_step_objects;
+    size_t gc_max_pause_us;
+    bool gc_stats;
+    bool gc_pauses;
+    size_t memory_limit;
+    bool memory_stats;
+};
+
+// What `file` hands to the pipeline it runs under sk_memory_protect.
+struct file_run {
+    const char *filename;
+    const char *source;
+    const struct run_options *options;
+    const struct sk_allocator *allocator;
+    int result;
+};
+
 static char *read_file(const char *filename);
 
+static bool parse_run_options(struct run_options *options, int argc, char **argv, int *file_index);
+static bool parse_limit(const char *option, const char *value, size_t minimum, size_t *limit);
+
 static void help(const char *prog_name);
 static int repl(void);
-static int file(const char *filename);
+static int file(const char *filename, const struct run_options *options);
+static void run_file(void *data);
+static int run_source(
+    const char *filename,
+    const char *source,
+    const struct run_options *options,
+    const struct sk_allocator *allocator);
+static void optimize(struct sk_program *program, const struct run_options *options);
+static enum sk_vm_result run_stack(struct sk_program *program, const struct run_options *options);
+static enum sk_vm_result run_register(struct sk_program *program);
+static void free_program(void *data);
+static void free_vm(void *data);
+static void free_jit(void *data);
+static void print_gc_stats(const struct sk_gc_stats *stats);
+static void print_gc_pauses(const struct sk_gc_stats *stats);
+static void print_memory_stats(void);
 static int ast(const char *filename);
+static int ir(const char *filename);
 
 int main(int argc, char **argv)
 {
@@ -26,13 +80,21 @@ int main(int argc, char **argv)
         }
 
         if (command_length == 3 && memcmp(command, "run", 3) == 0 && argc > 2) {
-            return file(argv[2]);
+            struct run_options options;
+            int file_index;
+            if (parse_run_options(&options, argc, argv, &file_index)) {
+                return file(argv[file_index], &options);
+            }
         }
 
         if (command_length == 3 && memcmp(command, "ast", 3) == 0 && argc > 2) {
             return ast(argv[2]);
         }
 
+        if (command_length == 2 && memcmp(command, "ir", 2) == 0 && argc > 2) {
+            return ir(argv[2]);
+        }
+
         if (command_length == 4 && memcmp(command, "help", 4) == 0) {
             help(argv[0]);
             return EXIT_SUCCESS;
@@ -58,10 +120,135 @@ static void help(const char *prog_name)
     fprintf(stderr, "Usage: %s [command]\n", prog_name);
     fprintf(stderr, "\n");
     fprintf(stderr, "Commands:\n");
-    fprintf(stderr, "  %-15s %s\n", "repl", "Start an interactive session (default).");
-    fprintf(stderr, "  %-15s %s\n", "run <file>", "Execute the specified file.");
-    fprintf(stderr, "  %-15s %s\n", "ast <file>", "Generate and print the AST of the specified file.");
-    fprintf(stderr, "  %-15s %s\n", "help", "Show this help message.");
+    fprintf(stderr, "  %-20s %s\n", "repl", "Start an interactive session (default).");
+    fprintf(stderr, "  %-20s %s\n", "run [options] <file>", "Execute the specified file.");
+    fprintf(stderr, "  %-20s %s\n", "ast <file>", "Generate and print the AST of the specified file.");
+    fprintf(stderr, "  %-20s %s\n", "ir <file>", "Print the optimized SSA IR of the specified file.");
+    fprintf(stderr, "  %-20s %s\n", "help", "Show this help message.");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Run options:\n");
+    fprintf(stderr, "  %-20s %s\n", "--vm=stack", "Execute on the stack VM (default).");
+    fprintf(stderr, "  %-20s %s\n", "--vm=register", "Execute on the register VM.");
+    fprintf(stderr, "  %-20s %s\n", "--no-fold", "Skip constant folding on the checked AST.");
+    fprintf(stderr, "  %-20s %s\n", "--ir", "Compile to stack bytecode through the SSA IR.");
+    fprintf(stderr, "  %-20s %s\n", "--no-peephole", "Skip the peephole pass over stack bytecode.");
+    fprintf(stderr, "  %-20s %s\n", "--peephole-stats", "Report the bytes the peephole pass removed.");
+    fprintf(stderr, "  %-20s %s\n", "--inline=<n>", "Inline leaf functions of up to n AST nodes; 0 disables.");
+    fprintf(stderr, "  %-20s %s\n", "--jit", "Compile hot stack VM functions to x86-64 code where supported.");
+    fprintf(stderr, "  %-20s %s\n", "--jit-threshold=<n>", "Compile a function after n calls and loop iterations.");
+    fprintf(stderr, "  %-20s %s\n", "--max-stack=<n>", "Limit the stack VM to n values on its stack.");
+    fprintf(stderr, "  %-20s %s\n", "--max-frames=<n>", "Limit the stack VM to n nested calls.");
+    fprintf(stderr, "  %-20s %s\n", "--gc-growth=<n>", "Collect again once the heap is n times its live size.");
+    fprintf(stderr, "  %-20s %s\n", "--gc-incremental", "Interleave major collections with execution.");
+    fprintf(stderr, "  %-20s %s\n", "--gc-step=<n>", "Trace or sweep up to n objects per incremental slice.");
+    fprintf(stderr, "  %-20s %s\n", "--gc-max-pause=<n>", "End an incremental slice after n microseconds.");
+    fprintf(stderr, "  %-20s %s\n", "--gc-stats", "Report garbage collections and what they freed.");
+    fprintf(stderr, "  %-20s %s\n", "--gc-pauses", "Report the pause times of garbage collections.");
+    fprintf(stderr, "  %-20s %s\n", "--memory-limit=<n>", "Stop with an error once n bytes are allocated.");
+    fprintf(stderr, "  %-20s %s\n", "--memory-stats", "Report the allocations of each subsystem.");
+}
+
+static bool parse_run_options(struct run_options *options, const int argc, char **argv, int *file_index)
+{
+    options->vm = VM_STACK;
+    options->fold = true;
+    options->ir = false;
+    options->peephole = true;
+    options->peephole_stats = false;
+    options->inline_threshold = SK_INLINE_DEFAULT_THRESHOLD;
+    options->jit = false;
+    options->jit_threshold = SK_JIT_DEFAULT_THRESHOLD;
+    options->max_stack_size = SK_VM_DEFAULT_MAX_STACK_SIZE;
+    options->max_frames = SK_VM_DEFAULT_MAX_FRAMES;
+    options->gc_growth_factor = SK_GC_DEFAULT_GROWTH_FACTOR;
+    options->gc_incremental = false;
+    options->gc_step_objects = SK_GC_DEFAULT_STEP_OBJECTS;
+    options->gc_max_pause_us = SK_GC_DEFAULT_MAX_PAUSE_US;
+    options->gc_stats = false;
+    options->gc_pauses = false;
+    options->memory_limit = 0;
+    options->memory_stats = false;
+
+    // Options come between the command and the file: `run [options] <file>`.
+    int i = 2;
+    for (; i < argc - 1; i++) {
+        const char *option = argv[i];
+
+        if (strcmp(option, "--vm=stack") == 0) {
+            options->vm = VM_STACK;
+        } else if (strcmp(option, "--vm=register") == 0) {
+            options->vm = VM_REGISTER;
+        } else if (strcmp(option, "--no-fold") == 0) {
+            options->fold = false;
+        } else if (strcmp(option, "--ir") == 0) {
+            options->ir = true;
+        } else if (strcmp(option, "--no-peephole") == 0) {
+            options->peephole = false;
+        } else if (strcmp(option, "--peephole-stats") == 0) {
+            options->peephole_stats = true;
+        } else if (strncmp(option, "--inline=", 9) == 0) {
+            if (!parse_limit(option, option + 9, 0, &options->inline_threshold)) {
+                return false;
+            }
+        } else if (strcmp(option, "--jit") == 0) {
+            options->jit = true;
+        } else if (strncmp(option, "--jit-threshold=", 16) == 0) {
+            if (!parse_limit(option, option + 16, 1, &options->jit_threshold)) {
+                return false;
+            }
+        } else if (strncmp(option, "--max-stack=", 12) == 0) {
+            if (!parse_limit(option, option + 12, 1, &options->max_stack_size)) {
+                return false;
+            }
+        } else if (strncmp(option, "--max-frames=", 13) == 0) {
+            if (!parse_limit(option, option + 13, 1, &options->max_frames)) {
+                return false;
+            }
+        } else if (strncmp(option, "--gc-growth=", 12) == 0) {
+            if (!parse_limit(option, option + 12, 1, &options->gc_growth_factor)) {
+                return false;
+            }
+        } else if (strcmp(option, "--gc-incremental") == 0) {
+            options->gc_incremental = true;
+        } else if (strncmp(option, "--gc-step=", 10) == 0) {
+            if (!parse_limit(option, option + 10, 1, &options->gc_step_objects)) {
+                return false;
+            }
+        } else if (strncmp(option, "--gc-max-pause=", 15) == 0) {
+            if (!parse_limit(option, option + 15, 1, &options->gc_max_pause_us)) {
+                return false;
+            }
+        } else if (strcmp(option, "--gc-stats") == 0) {
+            options->gc_stats = true;
+        } else if (strcmp(option, "--gc-pauses") == 0) {
+            options->gc_pauses = true;
+        } else if (strncmp(option, "--memory-limit=", 15) == 0) {
+            if (!parse_limit(option, option + 15, 1, &options->memory_limit)) {
+                return false;
+            }
+        } else if (strcmp(option, "--memory-stats") == 0) {
+            options->memory_stats = true;
+        } else {
+            fprintf(stderr, "Unknown option '%s'.\n", option);
+            return false;
+        }
+    }
+
+    *file_index = i;
+    return true;
+}
+
+static bool parse_limit(const char *option, const char *value, const size_t minimum, size_t *limit)
+{
+    char *end;
+    const unsigned long long parsed = strtoull(value, &end, 10);
+    if (*value < '0' || *value > '9' || *end != '\0' || parsed < minimum) {
+        fprintf(stderr, "Invalid value in option '%s'.\n", option);
+        return false;
+    }
+
+    *limit = (size_t)parsed;
+    return true;
 }
 
 static int repl(void)
@@ -70,23 +257,62 @@ static int repl(void)
     return EXIT_FAILURE;
 }
 
-static int file(const char *filename)
+static int file(const char *filename, const struct run_options *options)
 {
     char *source = read_file(filename);
     if (source == NULL) {
         return EXIT_FAILURE;
     }
 
+    // Everything up to the bytecode is allocated from an arena, which is released in one go once the program has run
+    // or an allocation has failed.
+    struct sk_arena arena;
+    sk_arena_init(&arena);
+    const struct sk_allocator allocator = sk_arena_allocator(&arena);
+
+    sk_memory_set_limit(options->memory_limit);
+    struct file_run run = {
+        .filename = filename,
+        .source = source,
+        .options = options,
+        .allocator = &allocator,
+        .result = EXIT_FAILURE,
+    };
+    const bool completed = sk_memory_protect(run_file, &run);
+    sk_memory_use(&sk_default_allocator, SK_MEMORY_OTHER);
+
+    if (options->memory_stats) {
+        print_memory_stats();
+    }
+
+    sk_arena_free(&arena);
+    free(source);
+    return completed ? run.result : EXIT_FAILURE;
+}
+
+static void run_file(void *data)
+{
+    struct file_run *run = data;
+    run->result = run_source(run->filename, run->source, run->options, run->allocator);
+}
+
+static int run_source(
+    const char *filename,
+    const char *source,
+    const struct run_options *options,
+    const struct sk_allocator *allocator)
+{
+    sk_memory_use(allocator, SK_MEMORY_PARSER);
     struct sk_parser parser;
     sk_parser_init(&parser, filename, source);
 
     struct sk_ast_node *ast = sk_parser_parse(&parser);
     if (parser.has_error) {
         sk_parser_free(&parser);
-        free(source);
         return EXIT_FAILURE;
     }
 
+    sk_memory_use(allocator, SK_MEMORY_CHECKER);
     struct sk_checker checker;
     sk_checker_init(&checker);
 
@@ -94,19 +320,44 @@ static int file(const char *filename)
     if (!checked) {
         sk_checker_free(&checker);
         sk_parser_free(&parser);
-        free(source);
         return EXIT_FAILURE;
     }
 
+    sk_memory_use(allocator, SK_MEMORY_COMPILER);
+    if (options->fold) {
+        sk_fold_program(ast);
+    }
+
+    sk_inline_program(ast, options->inline_threshold);
+
     struct sk_program program;
 
-    struct sk_compiler compiler;
-    bool compiled = sk_compiler_compile(&compiler, ast, &program);
+    bool compiled;
+    if (options->vm == VM_REGISTER) {
+        struct sk_register_compiler compiler;
+        compiled = sk_register_compiler_compile(&compiler, ast, &program);
+    } else if (options->ir) {
+        struct sk_ir_program ir_program;
+        sk_ir_program_init(&ir_program);
+        sk_ir_build(&ir_program, ast);
+        sk_ir_run_passes(&ir_program, sk_ir_default_passes, sk_ir_default_pass_count);
+        compiled = sk_ir_lower(&ir_program, &program);
+        sk_ir_program_free(&ir_program);
+        if (compiled) {
+            optimize(&program, options);
+        }
+    } else {
+        struct sk_compiler compiler;
+        compiled = sk_compiler_compile(&compiler, ast, &program);
+        if (compiled) {
+            optimize(&program, options);
+        }
+    }
+
     if (!compiled) {
         sk_checker_free(&checker);
         sk_parser_free(&parser);
         sk_program_free(&program);
-        free(source);
         return EXIT_FAILURE;
     }
 
@@ -115,21 +366,165 @@ static int file(const char *filename)
 
     if (program.functions.count == 0) {
         sk_program_free(&program);
-        free(source);
         return EXIT_SUCCESS;
     }
 
+    // From here on the VM allocates from the C library, which the arena does not release if an allocation fails.
+    sk_memory_use(&sk_default_allocator, SK_MEMORY_VM);
+    struct sk_memory_cleanup program_cleanup = {free_program, &program, NULL};
+    sk_memory_push_cleanup(&program_cleanup);
+    program.heap.growth_factor = options->gc_growth_factor;
+    program.heap.incremental = options->gc_incremental;
+    program.heap.step_objects = options->gc_step_objects;
+    program.heap.max_pause_us = options->gc_max_pause_us;
+
+    enum sk_vm_result vm_result = options->vm == VM_REGISTER ? run_register(&program) : run_stack(&program, options);
+
+    const struct sk_gc_stats gc_stats = sk_program_gc_stats(&program);
+    if (options->gc_stats) {
+        print_gc_stats(&gc_stats);
+    }
+
+    if (options->gc_pauses) {
+        print_gc_pauses(&gc_stats);
+    }
+
+    sk_memory_pop_cleanup(&program_cleanup);
+    sk_program_free(&program);
+    return vm_result == SK_VM_OK ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void optimize(struct sk_program *program, const struct run_options *options)
+{
+    if (!options->peephole) {
+        return;
+    }
+
+    if (!options->peephole_stats) {
+        sk_peephole_optimize_program(program, NULL);
+        return;
+    }
+
+    struct sk_peephole_stats stats;
+    sk_peephole_stats_init(&stats);
+    sk_peephole_optimize_program(program, &stats);
+
+    fprintf(
+        stderr,
+        "Peephole: %zu -> %zu bytes (%zu removed, %zu unreachable, %zu dead stores).\n",
+        stats.bytes_before,
+        stats.bytes_after,
+        stats.bytes_before - stats.bytes_after,
+        stats.unreachable_bytes,
+        stats.dead_stores);
+}
+
+static enum sk_vm_result run_stack(struct sk_program *program, const struct run_options *options)
+{
     struct sk_vm vm;
     sk_vm_init(&vm);
+    vm.max_stack_size = options->max_stack_size;
+    vm.max_frames = options->max_frames;
+    struct sk_memory_cleanup vm_cleanup = {free_vm, &vm, NULL};
+    sk_memory_push_cleanup(&vm_cleanup);
+
+    // Without JIT support the interpreter runs everything, just as without --jit.
+    struct sk_jit jit;
+    struct sk_vm_tier tier;
+    struct sk_memory_cleanup jit_cleanup = {free_jit, &jit, NULL};
+    const bool use_jit = options->jit && sk_jit_supported();
+    if (use_jit) {
+        sk_jit_init(&jit, program);
+        sk_memory_push_cleanup(&jit_cleanup);
+        tier = sk_jit_tier(&jit, options->jit_threshold);
+        vm.tier = &tier;
+    }
 
-    enum sk_vm_result vm_result = sk_vm_run(&vm, &program);
+    enum sk_vm_result vm_result = sk_vm_run(&vm, program);
 
+    if (use_jit) {
+        sk_memory_pop_cleanup(&jit_cleanup);
+        sk_jit_free(&jit);
+    }
+
+    sk_memory_pop_cleanup(&vm_cleanup);
     sk_vm_free(&vm);
+    return vm_result;
+}
 
-    sk_program_free(&program);
+static enum sk_vm_result run_register(struct sk_program *program)
+{
+    struct sk_register_vm vm;
+    sk_register_vm_init(&vm);
 
-    free(source);
-    return vm_result == SK_VM_OK ? EXIT_SUCCESS : EXIT_FAILURE;
+    enum sk_vm_result vm_result = sk_register_vm_run(&vm, program);
+
+    sk_register_vm_free(&vm);
+    return vm_result;
+}
+
+static void free_program(void *data)
+{
+    sk_program_free(data);
+}
+
+static void free_vm(void *data)
+{
+    sk_vm_free(data);
+}
+
+static void free_jit(void *data)
+{
+    sk_jit_free(data);
+}
+
+static void print_gc_stats(const struct sk_gc_stats *stats)
+{
+    fprintf(
+        stderr,
+        "GC: %zu minor and %zu major collections in %zu incremental steps, %zu objects (%zu bytes) promoted, "
+        "%zu young bytes freed, %zu old objects (%zu bytes) freed, %zu bytes live, %zu pauses.\n",
+        stats->minor_collections,
+        stats->major_collections,
+        stats->steps,
+        stats->promoted_objects,
+        stats->promoted_bytes,
+        stats->young_freed_bytes,
+        stats->freed_objects,
+        stats->freed_bytes,
+        stats->live_bytes,
+        stats->pauses);
+}
+
+static void print_gc_pauses(const struct sk_gc_stats *stats)
+{
+    fprintf(stderr, "GC pauses: %zu us total, %zu us longest,", stats->total_pause_us, stats->max_pause_us);
+
+    static const char *const limits[SK_GC_PAUSE_BUCKETS] = {"1 us", "10 us", "100 us", "1 ms", "10 ms", "100 ms", NULL};
+    for (size_t i = 0; i < SK_GC_PAUSE_BUCKETS; i++) {
+        if (limits[i] != NULL) {
+            fprintf(stderr, " %zu under %s,", stats->pause_histogram[i], limits[i]);
+        } else {
+            fprintf(stderr, " %zu longer.\n", stats->pause_histogram[i]);
+        }
+    }
+}
+
+static void print_memory_stats(void)
+{
+    fprintf(stderr, "Memory:");
+    for (size_t i = 0; i < SK_MEMORY_SUBSYSTEM_COUNT; i++) {
+        const struct sk_memory_stats *stats = sk_memory_stats((enum sk_memory_subsystem)i);
+        fprintf(
+            stderr,
+            "%s %s %zu allocations (%zu bytes at peak)",
+            i == 0 ? "" : ",",
+            sk_memory_subsystem_name((enum sk_memory_subsystem)i),
+            stats->allocations,
+            stats->peak_bytes);
+    }
+
+    fprintf(stderr, ".\n");
 }
 
 static int ast(const char *filename)
@@ -157,6 +552,50 @@ static int ast(const char *filename)
     return EXIT_SUCCESS;
 }
 
+// Prints the IR that `run --ir` lowers, after the default folding, inlining and IR passes.
+static int ir(const char *filename)
+{
+    char *source = read_file(filename);
+    if (source == NULL) {
+        return EXIT_FAILURE;
+    }
+
+    struct sk_parser parser;
+    sk_parser_init(&parser, filename, source);
+
+    struct sk_ast_node *node = sk_parser_parse(&parser);
+    if (parser.has_error) {
+        sk_parser_free(&parser);
+        free(source);
+        return EXIT_FAILURE;
+    }
+
+    struct sk_checker checker;
+    sk_checker_init(&checker);
+    if (!sk_checker_check(&checker, node)) {
+        sk_checker_free(&checker);
+        sk_parser_free(&parser);
+        free(source);
+        return EXIT_FAILURE;
+    }
+
+    sk_fold_program(node);
+    sk_inline_program(node, SK_INLINE_DEFAULT_THRESHOLD);
+
+    struct sk_ir_program ir_program;
+    sk_ir_program_init(&ir_program);
+    sk_ir_build(&ir_program, node);
+    sk_ir_run_passes(&ir_program, sk_ir_default_passes, sk_ir_default_pass_count);
+    sk_ir_print(&ir_program);
+    sk_ir_program_free(&ir_program);
+
+    sk_checker_free(&checker);
+    sk_parser_free(&parser);
+
+    free(source);
+    return EXIT_SUCCESS;
+}
+
 static char *read_file(const char *filename)
 {
     FILE *file = fopen(filename, "rb");
@@ -0,0 +1,104 @@
+#include "sk_arena.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+static size_t align(size_t size);
+static bool is_last(const struct sk_arena *arena, const void *ptr, size_t size);
+static void *arena_allocate(void *user_data, size_t size);
+static void *arena_reallocate(void *user_data, void *ptr, size_t old_size, size_t new_size);
+static void arena_free(void *user_data, void *ptr, size_t size);
+
+void sk_arena_init(struct sk_arena *arena)
+{
+    arena->block = NULL;
+}
+
+void sk_arena_free(struct sk_arena *arena)
+{
+    struct sk_arena_block *block = arena->block;
+    while (block != NULL) {
+        struct sk_arena_block *previous = block->previous;
+        free(block);
+        block = previous;
+    }
+
+    sk_arena_init(arena);
+}
+
+struct sk_allocator sk_arena_allocator(struct sk_arena *arena)
+{
+    return (struct sk_allocator) {
+        .allocate = arena_allocate,
+        .reallocate = arena_reallocate,
+        .free = arena_free,
+        .user_data = arena,
+    };
+}
+
+static size_t align(const size_t size)
+{
+    return (size + SK_MEMORY_ALIGNMENT - 1) / SK_MEMORY_ALIGNMENT * SK_MEMORY_ALIGNMENT;
+}
+
+// Whether the block at `ptr` ends where the current block's free space starts.
+static bool is_last(const struct sk_arena *arena, const void *ptr, const size_t size)
+{
+    const struct sk_arena_block *block = arena->block;
+    return block != NULL && (const uint8_t *)ptr + align(size) == (const uint8_t *)block->data + block->used;
+}
+
+// The arena's blocks come from the C library: the arena is the allocator, so it cannot allocate through sk_reallocate.
+static void *arena_allocate(void *user_data, const size_t size)
+{
+    struct sk_arena *arena = user_data;
+    const size_t aligned = align(size);
+
+    struct sk_arena_block *block = arena->block;
+    if (block == NULL || block->capacity - block->used < aligned) {
+        const size_t capacity = aligned > SK_ARENA_BLOCK_SIZE ? aligned : SK_ARENA_BLOCK_SIZE;
+        block = malloc(sizeof(struct sk_arena_block) + capacity);
+        if (block == NULL) {
+            return NULL;
+        }
+
+        block->previous = arena->block;
+        block->capacity = capacity;
+        block->used = 0;
+        arena->block = block;
+    }
+
+    void *result = (uint8_t *)block->data + block->used;
+    block->used += aligned;
+    return result;
+}
+
+static void *arena_reallocate(void *user_data, void *ptr, const size_t old_size, const size_t new_size)
+{
+    struct sk_arena *arena = user_data;
+    if (is_last(arena, ptr, old_size)) {
+        struct sk_arena_block *block = arena->block;
+        const size_t start = block->used - align(old_size);
+        if (block->capacity - start >= align(new_size)) {
+            block->used = start + align(new_size);
+            return ptr;
+        }
+    }
+
+    void *result = arena_allocate(arena, new_size);
+    if (result == NULL) {
+        return NULL;
+    }
+
+    memcpy(result, ptr, old_size < new_size ? old_size : new_size);
+    return result;
+}
+
+static void arena_free(void *user_data, void *ptr, const size_t size)
+{
+    struct sk_arena *arena = user_data;
+    if (is_last(arena, ptr, size)) {
+        arena->block->used -= align(size);
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef SKARD_SK_ARENA_H
+#define SKARD_SK_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sk_memory.h"
+
+// Bytes of a regular arena block. Larger allocations get a block of their own.
+#define SK_ARENA_BLOCK_SIZE (64 * 1024)
+
+struct sk_arena_block {
+    struct sk_arena_block *previous;
+    size_t capacity;
+    size_t used;
+    // Aligned to SK_MEMORY_ALIGNMENT.
+    union sk_max_align data[];
+};
+
+// Bump allocator that releases all of its memory at once. Freeing or resizing the most recent allocation of the
+// current block reuses its space; other frees are ignored and the space stays taken until the arena is freed.
+struct sk_arena {
+    struct sk_arena_block *block;
+};
+
+void sk_arena_init(struct sk_arena *arena);
+// Releases every block, which must no longer be used.
+void sk_arena_free(struct sk_arena *arena);
+
+// An allocator that allocates from `arena`.
+struct sk_allocator sk_arena_allocator(struct sk_arena *arena);
+
+#endif // SKARD_SK_ARENA_H
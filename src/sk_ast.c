@@ -76,6 +76,15 @@ static void print_print(const struct sk_ast_node *node, int depth);
 static void print_fn(const struct sk_ast_node *node, int depth);
 static void print_program(const struct sk_ast_node *node, int depth);
 
+sk_number sk_ast_literal_number(const struct sk_ast_literal *literal)
+{
+    if (literal->folded) {
+        return literal->number;
+    }
+
+    return sk_number_from_string(literal->token.start, literal->token.length);
+}
+
 void sk_ast_node_print(const struct sk_ast_node *node)
 {
     ast_node_print_impl(node, 0);
@@ -92,6 +101,11 @@ static void print_parenthesized_expression(const struct sk_ast_node *node)
 {
     switch (node->type) {
         case SK_AST_LITERAL:
+            if (node->as.literal.folded) {
+                printf("%g", node->as.literal.number);
+                break;
+            }
+
             printf("%.*s", (int)node->as.literal.token.length, node->as.literal.token.start);
             break;
         case SK_AST_IDENTIFIER:
@@ -5,6 +5,7 @@
 #include <stdlib.h>
 
 #include "sk_lexer.h"
+#include "sk_value.h"
 
 struct sk_symbol;
 struct sk_ast_node;
@@ -82,6 +83,10 @@ enum sk_ast_node_type {
 
 struct sk_ast_literal {
     struct sk_token token;
+
+    // Number literals produced by constant folding have no source text; their value is stored here instead.
+    bool folded;
+    sk_number number;
 };
 
 struct sk_ast_identifier {
@@ -99,11 +104,19 @@ struct sk_ast_binary {
     struct sk_token operator;
     struct sk_ast_node *left;
     struct sk_ast_node *right;
+
+    // Set by the checker for `+`, `==` and `!=`. Numbers are added and compare as doubles; strings are concatenated and
+    // every other type compares by identity.
+    bool number_operands;
 };
 
 struct sk_ast_call {
     struct sk_ast_node *callee;
     struct sk_ast_node_array args;
+
+    // Set by the inliner to the callee's return expression, which is then compiled in place of the call with the
+    // callee's parameters bound to the evaluated arguments.
+    const struct sk_ast_node *inlined;
 };
 
 struct sk_ast_block {
@@ -196,6 +209,8 @@ struct sk_ast_node {
     } as;
 };
 
+sk_number sk_ast_literal_number(const struct sk_ast_literal *literal);
+
 void sk_ast_node_print(const struct sk_ast_node *node);
 
 struct sk_ast_node_arena_block {
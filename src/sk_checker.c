@@ -177,7 +177,7 @@ static struct sk_type *check_expression(
 static struct sk_type *check_literal(struct sk_checker *checker, const struct sk_ast_node *node);
 static struct sk_type *check_identifier(struct sk_checker *checker, struct sk_ast_node *node);
 static struct sk_type *check_unary(struct sk_checker *checker, const struct sk_ast_node *node);
-static struct sk_type *check_binary(struct sk_checker *checker, const struct sk_ast_node *node);
+static struct sk_type *check_binary(struct sk_checker *checker, struct sk_ast_node *node);
 static struct sk_type *check_call(struct sk_checker *checker, const struct sk_ast_node *node);
 static void check_block(struct sk_checker *checker, const struct sk_ast_node *node);
 static void check_let(
@@ -664,7 +664,7 @@ static struct sk_type *check_unary(struct sk_checker *checker, const struct sk_a
     }
 }
 
-static struct sk_type *check_binary(struct sk_checker *checker, const struct sk_ast_node *node)
+static struct sk_type *check_binary(struct sk_checker *checker, struct sk_ast_node *node)
 {
     const struct sk_type *left_type = check_expression(checker, node->as.binary.left, NULL);
     const struct sk_type *right_type = check_expression(checker, node->as.binary.right, NULL);
@@ -674,6 +674,18 @@ static struct sk_type *check_binary(struct sk_checker *checker, const struct sk_
 
     switch (node->as.binary.operator.type) {
         case SK_TOKEN_PLUS:
+            if (left_type->kind == SK_TYPE_STRING && right_type->kind == SK_TYPE_STRING) {
+                node->as.binary.number_operands = false;
+                return make_type(checker, SK_TYPE_STRING);
+            }
+
+            if (left_type->kind != SK_TYPE_NUMBER || right_type->kind != SK_TYPE_NUMBER) {
+                checker_type_error(checker, &node->as.binary.operator, "Addition requires two Numbers or two Strings.");
+                return make_type(checker, SK_TYPE_INVALID);
+            }
+
+            node->as.binary.number_operands = true;
+            return make_type(checker, SK_TYPE_NUMBER);
         case SK_TOKEN_MINUS:
         case SK_TOKEN_STAR:
         case SK_TOKEN_SLASH:
@@ -697,6 +709,7 @@ static struct sk_type *check_binary(struct sk_checker *checker, const struct sk_
                 checker_type_error(checker, &node->as.binary.operator, "Equality operands must have the same type.");
                 return make_type(checker, SK_TYPE_INVALID);
             }
+            node->as.binary.number_operands = left_type->kind == SK_TYPE_NUMBER;
             return make_type(checker, SK_TYPE_BOOLEAN);
         case SK_TOKEN_AND:
         case SK_TOKEN_OR:
@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #include "sk_ast.h"
 #include "sk_hashmap.h"
@@ -10,7 +11,8 @@
 #include "sk_type.h"
 #include "sk_value.h"
 
-#define SK_MAX_LOCAL_SLOTS 256
+// Local slots are addressed by two-byte operands in the wide instructions.
+#define SK_MAX_LOCAL_SLOTS (UINT16_MAX + 1)
 
 enum sk_symbol_type {
     SK_SYMBOL_FN_OVERLOADS,
@@ -11,12 +11,20 @@ static void emit(const struct sk_compiler *compiler, uint8_t byte);
 static void emit2(const struct sk_compiler *compiler, uint8_t byte1, uint8_t byte2);
 static void emit3(const struct sk_compiler *compiler, uint8_t byte1, uint8_t byte2, uint8_t byte3);
 
-static void emit_const(const struct sk_compiler *compiler, struct sk_value constant);
+static void emit_with_operand(struct sk_compiler *compiler, uint8_t opcode, size_t operand, const char *overflow_msg);
+static void emit_const(struct sk_compiler *compiler, struct sk_value constant);
 static size_t emit_jmp(const struct sk_compiler *compiler, uint8_t instruction);
 static void emit_jmp_back(struct sk_compiler *compiler, size_t target_offset);
 
 static void patch_jmp(struct sk_compiler *compiler, size_t offset);
 
+static bool compile_compare_jump(struct sk_compiler *compiler, const struct sk_ast_node *condition, size_t *jmp_offset);
+static bool is_number_local(const struct sk_compiler *compiler, const struct sk_ast_node *node);
+static bool is_number_literal(const struct sk_ast_node *node);
+static bool is_true_literal(const struct sk_ast_node *node);
+static enum sk_token_type mirror_comparison(enum sk_token_type operator);
+static bool compare_jump_opcode(enum sk_token_type operator, uint8_t *opcode);
+
 static void compile_program(struct sk_compiler *compiler, const struct sk_ast_node *node);
 
 static void compile_declaration(struct sk_compiler *compiler, const struct sk_ast_node *node);
@@ -40,10 +48,14 @@ static void compile_unary(struct sk_compiler *compiler, const struct sk_ast_node
 static void compile_identifier(struct sk_compiler *compiler, const struct sk_ast_node *node);
 static void compile_assignment(struct sk_compiler *compiler, const struct sk_ast_node *node);
 static void compile_call(struct sk_compiler *compiler, const struct sk_ast_node *node);
+static void compile_call_instruction(struct sk_compiler *compiler, const struct sk_ast_node *node, uint8_t opcode);
+static bool is_direct_call(const struct sk_ast_call *call, sk_fnptr *fnptr);
+static void compile_inlined_call(struct sk_compiler *compiler, const struct sk_ast_node *node);
+static size_t local_slot(const struct sk_compiler *compiler, const struct sk_symbol *symbol);
 
 static void compile_literal(struct sk_compiler *compiler, const struct sk_ast_node *node);
-static void compile_number(const struct sk_compiler *compiler, const struct sk_ast_literal *literal);
-static void compile_string(const struct sk_compiler *compiler, const struct sk_ast_literal *literal);
+static void compile_number(struct sk_compiler *compiler, const struct sk_ast_literal *literal);
+static void compile_string(struct sk_compiler *compiler, const struct sk_ast_literal *literal);
 
 bool sk_compiler_compile(struct sk_compiler *compiler, const struct sk_ast_node *node, struct sk_program *program)
 {
@@ -78,9 +90,21 @@ static void emit3(const struct sk_compiler *compiler, const uint8_t byte1, const
     emit(compiler, byte3);
 }
 
-static void emit_const(const struct sk_compiler *compiler, const struct sk_value constant)
+static void emit_with_operand(
+    struct sk_compiler *compiler,
+    const uint8_t opcode,
+    const size_t operand,
+    const char *overflow_msg)
+{
+    if (!sk_chunk_add_with_operand(compiler->current_chunk, opcode, operand)) {
+        compiler_error(compiler, overflow_msg);
+    }
+}
+
+static void emit_const(struct sk_compiler *compiler, const struct sk_value constant)
 {
-    sk_chunk_add_const(compiler->current_chunk, constant);
+    const size_t index = sk_constant_table_add(&compiler->program->constants, constant);
+    emit_with_operand(compiler, SK_OP_CONST, index, "Too many constants.");
 }
 
 static size_t emit_jmp(const struct sk_compiler *compiler, const uint8_t instruction)
@@ -115,6 +139,130 @@ static void patch_jmp(struct sk_compiler *compiler, const size_t offset)
     compiler->current_chunk->code[offset + 1] = jmp_offset & 0xFF;
 }
 
+// Emits a single compare-and-branch instruction that jumps when the condition is false, provided the condition compares
+// a Number local with another Number local or a number literal. The jump offset is left to patch_jmp.
+static bool compile_compare_jump(struct sk_compiler *compiler, const struct sk_ast_node *condition, size_t *jmp_offset)
+{
+    if (condition->type != SK_AST_BINARY) {
+        return false;
+    }
+
+    const struct sk_ast_node *left = condition->as.binary.left;
+    const struct sk_ast_node *right = condition->as.binary.right;
+    enum sk_token_type operator = condition->as.binary.operator.type;
+
+    // `1 < x` is tested as `x > 1`.
+    if (!is_number_local(compiler, left) && is_number_local(compiler, right)) {
+        const struct sk_ast_node *swap = left;
+        left = right;
+        right = swap;
+        operator = mirror_comparison(operator);
+    }
+
+    uint8_t opcode;
+    if (!is_number_local(compiler, left) || !compare_jump_opcode(operator, &opcode)) {
+        return false;
+    }
+
+    const uint8_t slot = (uint8_t)local_slot(compiler, left->as.identifier.symbol);
+    struct sk_constant_table *constants = &compiler->program->constants;
+
+    if (is_number_local(compiler, right)) {
+        emit3(compiler, opcode, slot, (uint8_t)local_slot(compiler, right->as.identifier.symbol));
+    } else if (is_number_literal(right)) {
+        // Look the constant up first so that a test that cannot use the one-byte form adds nothing to the pool.
+        const struct sk_value constant = sk_number_value(sk_ast_literal_number(&right->as.literal));
+        size_t index;
+        if (!sk_constant_table_find(constants, constant, &index)) {
+            if (constants->values.count > UINT8_MAX) {
+                return false;
+            }
+
+            index = sk_constant_table_add(constants, constant);
+        }
+
+        if (index > UINT8_MAX) {
+            return false;
+        }
+
+        // The LOCAL_CONST forms are declared in the same order as the LOCALS forms.
+        opcode += SK_OP_JMP_IF_LESS_LOCAL_CONST - SK_OP_JMP_IF_LESS_LOCALS;
+        emit3(compiler, opcode, slot, (uint8_t)index);
+    } else {
+        return false;
+    }
+
+    emit2(compiler, 0xFF, 0xFF);
+    *jmp_offset = compiler->current_chunk->count - 2;
+    return true;
+}
+
+static bool is_number_local(const struct sk_compiler *compiler, const struct sk_ast_node *node)
+{
+    if (node->type != SK_AST_IDENTIFIER || node->as.identifier.symbol == NULL) {
+        return false;
+    }
+
+    // Compare-and-branch instructions only have one-byte slot operands.
+    const struct sk_symbol *symbol = node->as.identifier.symbol;
+    return symbol->type == SK_SYMBOL_LOCAL && symbol->as.local.type->kind == SK_TYPE_NUMBER &&
+        local_slot(compiler, symbol) <= UINT8_MAX;
+}
+
+static bool is_number_literal(const struct sk_ast_node *node)
+{
+    return node->type == SK_AST_LITERAL && node->as.literal.token.type == SK_TOKEN_NUMBER;
+}
+
+static bool is_true_literal(const struct sk_ast_node *node)
+{
+    return node->type == SK_AST_LITERAL && node->as.literal.token.type == SK_TOKEN_TRUE;
+}
+
+static enum sk_token_type mirror_comparison(const enum sk_token_type operator)
+{
+    switch (operator) {
+        case SK_TOKEN_LESS:
+            return SK_TOKEN_GREATER;
+        case SK_TOKEN_LESS_EQ:
+            return SK_TOKEN_GREATER_EQ;
+        case SK_TOKEN_GREATER:
+            return SK_TOKEN_LESS;
+        case SK_TOKEN_GREATER_EQ:
+            return SK_TOKEN_LESS_EQ;
+        default:
+            return operator;
+    }
+}
+
+// Maps a comparison to the LOCALS instruction that jumps when it does not hold. `<=` and `>=` are defined as the
+// negated strict comparisons, so their jumps test the strict comparison directly.
+static bool compare_jump_opcode(const enum sk_token_type operator, uint8_t *opcode)
+{
+    switch (operator) {
+        case SK_TOKEN_LESS:
+            *opcode = SK_OP_JMP_IF_NOT_LESS_LOCALS;
+            return true;
+        case SK_TOKEN_LESS_EQ:
+            *opcode = SK_OP_JMP_IF_GREATER_LOCALS;
+            return true;
+        case SK_TOKEN_GREATER:
+            *opcode = SK_OP_JMP_IF_NOT_GREATER_LOCALS;
+            return true;
+        case SK_TOKEN_GREATER_EQ:
+            *opcode = SK_OP_JMP_IF_LESS_LOCALS;
+            return true;
+        case SK_TOKEN_EQUAL:
+            *opcode = SK_OP_JMP_IF_NOT_EQUAL_LOCALS;
+            return true;
+        case SK_TOKEN_NOT_EQUAL:
+            *opcode = SK_OP_JMP_IF_EQUAL_LOCALS;
+            return true;
+        default:
+            return false;
+    }
+}
+
 static void compile_program(struct sk_compiler *compiler, const struct sk_ast_node *node)
 {
     const struct sk_ast_program *program = &node->as.program;
@@ -137,11 +285,16 @@ static void compile_function(struct sk_compiler *compiler, const struct sk_ast_n
     struct sk_compiled_function *function = sk_program_add_function(compiler->program, fnptr);
 
     compiler->current_chunk = &function->chunk;
+    compiler->next_local = fn->locals_count;
+    compiler->max_locals = fn->locals_count;
+    compiler->slot_base = 0;
+
     compile_block(compiler, fn->body);
     emit(compiler, SK_OP_NOTHING);
     emit(compiler, SK_OP_RETURN);
 
-    function->chunk.locals_count = fn->locals_count;
+    function->chunk.locals_count = compiler->max_locals;
+    function->chunk.frame_size = compiler->max_locals + sk_chunk_max_stack_depth(&function->chunk);
     function->parameter_count = fn->parameters.count;
 
     if (fn->name.length == 4 && memcmp(fn->name.start, "main", 4) == 0) {
@@ -201,7 +354,7 @@ static void compile_let_statement(struct sk_compiler *compiler, const struct sk_
         return;
     }
 
-    emit2(compiler, SK_OP_STORE_LOCAL, (uint8_t)let->symbol->as.local.slot);
+    emit_with_operand(compiler, SK_OP_STORE_LOCAL, local_slot(compiler, let->symbol), "Too many local variables.");
 }
 
 static void compile_assignment(struct sk_compiler *compiler, const struct sk_ast_node *node)
@@ -218,13 +371,29 @@ static void compile_assignment(struct sk_compiler *compiler, const struct sk_ast
         return;
     }
 
-    const uint8_t slot = (uint8_t)assign->symbol->as.local.slot;
-    emit2(compiler, SK_OP_STORE_LOCAL, slot);
-    emit2(compiler, SK_OP_LOAD_LOCAL, slot);
+    const size_t slot = local_slot(compiler, assign->symbol);
+    emit_with_operand(compiler, SK_OP_STORE_LOCAL, slot, "Too many local variables.");
+    emit_with_operand(compiler, SK_OP_LOAD_LOCAL, slot, "Too many local variables.");
 }
 
 static void compile_if_statement(struct sk_compiler *compiler, const struct sk_ast_node *node)
 {
+    size_t condition_jmp;
+    if (compile_compare_jump(compiler, node->as.ifn.condition, &condition_jmp)) {
+        compile_statement(compiler, node->as.ifn.then_branch);
+
+        if (node->as.ifn.else_branch == NULL) {
+            patch_jmp(compiler, condition_jmp);
+            return;
+        }
+
+        const size_t end_jmp = emit_jmp(compiler, SK_OP_JMP);
+        patch_jmp(compiler, condition_jmp);
+        compile_statement(compiler, node->as.ifn.else_branch);
+        patch_jmp(compiler, end_jmp);
+        return;
+    }
+
     compile_expression(compiler, node->as.ifn.condition);
     const size_t then_branch_jmp = emit_jmp(compiler, SK_OP_JMP_FALSE);
 
@@ -249,6 +418,21 @@ static void compile_while_statement(struct sk_compiler *compiler, const struct s
 {
     const size_t loop_start = compiler->current_chunk->count;
 
+    // A `while (true)` loop only ends through `return`, so it needs no test.
+    if (is_true_literal(node->as.whilen.condition)) {
+        compile_statement(compiler, node->as.whilen.body);
+        emit_jmp_back(compiler, loop_start);
+        return;
+    }
+
+    size_t condition_jmp;
+    if (compile_compare_jump(compiler, node->as.whilen.condition, &condition_jmp)) {
+        compile_statement(compiler, node->as.whilen.body);
+        emit_jmp_back(compiler, loop_start);
+        patch_jmp(compiler, condition_jmp);
+        return;
+    }
+
     compile_expression(compiler, node->as.whilen.condition);
 
     const size_t exit_jmp = emit_jmp(compiler, SK_OP_JMP_FALSE);
@@ -273,13 +457,24 @@ static void compile_print_statement(struct sk_compiler *compiler, const struct s
         compile_expression(compiler, print->args.nodes[i - 1]);
     }
 
+    if (print->args.count - 1 > UINT8_MAX) {
+        compiler_error(compiler, "Too many print arguments.");
+        return;
+    }
+
     emit(compiler, SK_OP_PRINT);
+    emit3(compiler, (uint8_t)(print->args.count - 1), (SK_PRINT_CACHE_NONE >> 8) & 0xFF, SK_PRINT_CACHE_NONE & 0xFF);
 }
 
 static void compile_return_statement(struct sk_compiler *compiler, const struct sk_ast_node *node)
 {
     const struct sk_ast_return *returnn = &node->as.returnn;
     const struct sk_ast_node *expression = returnn->expression;
+    if (expression != NULL && expression->type == SK_AST_CALL && expression->as.call.inlined == NULL) {
+        compile_call_instruction(compiler, expression, SK_OP_TAIL_CALL);
+        return;
+    }
+
     compile_expression_or_nothing(compiler, expression);
     emit(compiler, SK_OP_RETURN);
 }
@@ -345,7 +540,7 @@ static void compile_binary(struct sk_compiler *compiler, const struct sk_ast_nod
 
     switch (node->as.binary.operator.type) {
         case SK_TOKEN_PLUS:
-            emit(compiler, SK_OP_NADD);
+            emit(compiler, node->as.binary.number_operands ? SK_OP_NADD : SK_OP_CONCAT);
             break;
         case SK_TOKEN_MINUS:
             emit(compiler, SK_OP_NSUB);
@@ -369,10 +564,10 @@ static void compile_binary(struct sk_compiler *compiler, const struct sk_ast_nod
             emit2(compiler, SK_OP_NLESS, SK_OP_NOT);
             break;
         case SK_TOKEN_EQUAL:
-            emit(compiler, SK_OP_NEQUAL);
+            emit(compiler, node->as.binary.number_operands ? SK_OP_NEQUAL : SK_OP_EQUAL);
             break;
         case SK_TOKEN_NOT_EQUAL:
-            emit2(compiler, SK_OP_NEQUAL, SK_OP_NOT);
+            emit2(compiler, node->as.binary.number_operands ? SK_OP_NEQUAL : SK_OP_EQUAL, SK_OP_NOT);
             break;
         default:
             compiler_error(compiler, "Unsupported binary operator.");
@@ -434,17 +629,85 @@ static void compile_identifier(struct sk_compiler *compiler, const struct sk_ast
         return;
     }
 
-    emit2(compiler, SK_OP_LOAD_LOCAL, (uint8_t)identifier->symbol->as.local.slot);
+    const size_t slot = local_slot(compiler, identifier->symbol);
+    emit_with_operand(compiler, SK_OP_LOAD_LOCAL, slot, "Too many local variables.");
 }
 
 static void compile_call(struct sk_compiler *compiler, const struct sk_ast_node *node)
 {
-    compile_expression(compiler, node->as.call.callee);
-    for (size_t i = 0; i < node->as.call.args.count; i++) {
-        compile_expression(compiler, node->as.call.args.nodes[i]);
+    if (node->as.call.inlined != NULL) {
+        compile_inlined_call(compiler, node);
+        return;
+    }
+
+    compile_call_instruction(compiler, node, SK_OP_CALL);
+}
+
+// Emits a CALL or TAIL_CALL, or its _DIRECT form when the callee is a function named directly.
+static void compile_call_instruction(struct sk_compiler *compiler, const struct sk_ast_node *node, const uint8_t opcode)
+{
+    const struct sk_ast_call *call = &node->as.call;
+    sk_fnptr fnptr;
+    const bool direct = is_direct_call(call, &fnptr);
+
+    if (!direct) {
+        compile_expression(compiler, call->callee);
+    }
+
+    for (size_t i = 0; i < call->args.count; i++) {
+        compile_expression(compiler, call->args.nodes[i]);
+    }
+
+    if (direct) {
+        emit(compiler, opcode == SK_OP_TAIL_CALL ? SK_OP_TAIL_CALL_DIRECT : SK_OP_CALL_DIRECT);
+        emit3(compiler, (fnptr >> 8) & 0xFF, fnptr & 0xFF, (uint8_t)call->args.count);
+        return;
+    }
+
+    emit_with_operand(compiler, opcode, call->args.count, "Too many arguments.");
+}
+
+// Calls through a function value, and the rare calls whose operands do not fit a direct call, take the generic path.
+static bool is_direct_call(const struct sk_ast_call *call, sk_fnptr *fnptr)
+{
+    const struct sk_ast_node *callee = call->callee;
+    if (callee->type != SK_AST_IDENTIFIER || callee->as.identifier.symbol == NULL ||
+        callee->as.identifier.symbol->type != SK_SYMBOL_FN_OVERLOADS) {
+        return false;
     }
 
-    emit2(compiler, SK_OP_CALL, (uint8_t)node->as.call.args.count);
+    *fnptr = callee->as.identifier.symbol->as.fn_overloads.overloads.fnptr;
+    return *fnptr <= UINT16_MAX && call->args.count <= UINT8_MAX;
+}
+
+// Stores the arguments into fresh locals, in order, then compiles the callee's expression with its parameter slots
+// shifted onto them. The locals are free again once the expression has been evaluated.
+static void compile_inlined_call(struct sk_compiler *compiler, const struct sk_ast_node *node)
+{
+    const struct sk_ast_call *call = &node->as.call;
+    const size_t base = compiler->next_local;
+
+    compiler->next_local += call->args.count;
+    if (compiler->next_local > compiler->max_locals) {
+        compiler->max_locals = compiler->next_local;
+    }
+
+    for (size_t i = 0; i < call->args.count; i++) {
+        compile_expression(compiler, call->args.nodes[i]);
+        emit_with_operand(compiler, SK_OP_STORE_LOCAL, base + i, "Too many local variables.");
+    }
+
+    const size_t slot_base = compiler->slot_base;
+    compiler->slot_base = base;
+    compile_expression(compiler, call->inlined);
+    compiler->slot_base = slot_base;
+
+    compiler->next_local = base;
+}
+
+static size_t local_slot(const struct sk_compiler *compiler, const struct sk_symbol *symbol)
+{
+    return compiler->slot_base + symbol->as.local.slot;
 }
 
 static void compile_literal(struct sk_compiler *compiler, const struct sk_ast_node *node)
@@ -468,16 +731,19 @@ static void compile_literal(struct sk_compiler *compiler, const struct sk_ast_no
     }
 }
 
-static void compile_number(const struct sk_compiler *compiler, const struct sk_ast_literal *literal)
+static void compile_number(struct sk_compiler *compiler, const struct sk_ast_literal *literal)
 {
-    const sk_number number = sk_number_from_string(literal->token.start, literal->token.length);
+    const sk_number number = sk_ast_literal_number(literal);
     const struct sk_value number_value = sk_number_value(number);
     emit_const(compiler, number_value);
 }
 
-static void compile_string(const struct sk_compiler *compiler, const struct sk_ast_literal *literal)
+static void compile_string(struct sk_compiler *compiler, const struct sk_ast_literal *literal)
 {
-    const struct sk_value string_value = sk_object_value(
-        sk_object_string_from_chars(literal->token.start + 1, literal->token.length - 2));
-    emit_const(compiler, string_value);
+    const size_t index = sk_constant_table_add_string(
+        &compiler->program->constants,
+        &compiler->program->heap,
+        literal->token.start + 1,
+        literal->token.length - 2);
+    emit_with_operand(compiler, SK_OP_CONST, index, "Too many constants.");
 }
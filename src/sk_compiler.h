@@ -9,6 +9,13 @@
 struct sk_compiler {
     struct sk_chunk *current_chunk;
     struct sk_program *program;
+
+    // Inlined calls bind the callee's parameters to locals past the caller's own: `next_local` is the first free one,
+    // `max_locals` the frame's high-water mark and `slot_base` the offset added to the slots of the expression being
+    // compiled.
+    size_t next_local;
+    size_t max_locals;
+    size_t slot_base;
     bool has_error;
 };
 
@@ -51,6 +51,8 @@ static size_t debug_instruction(const uint8_t instruction)
             return debug_simple_instruction("NMUL");
         case SK_OP_NDIV:
             return debug_simple_instruction("NDIV");
+        case SK_OP_CONCAT:
+            return debug_simple_instruction("CONCAT");
         default:
             return debug_simple_instruction("INVALID");
     }
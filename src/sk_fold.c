@@ -0,0 +1,378 @@
+#include "sk_fold.h"
+
+#include <math.h>
+
+static void fold_declaration(struct sk_ast_node *node);
+
+static void fold_statement(struct sk_ast_node *node);
+static void fold_statements(const struct sk_ast_node_array *nodes);
+static void fold_if(struct sk_ast_node *node);
+static void fold_while(struct sk_ast_node *node);
+
+static void fold_expression(struct sk_ast_node *node);
+static void fold_expressions(const struct sk_ast_node_array *nodes);
+static void fold_unary(struct sk_ast_node *node);
+static void fold_binary(struct sk_ast_node *node);
+static void fold_logical(struct sk_ast_node *node);
+static bool fold_number_operation(struct sk_ast_node *node, sk_number a, sk_number b);
+
+static bool as_number_constant(const struct sk_ast_node *node, sk_number *number);
+static bool as_boolean_constant(const struct sk_ast_node *node, bool *boolean);
+static bool is_number_constant(const struct sk_ast_node *node, sk_number value);
+static bool is_pure(const struct sk_ast_node *node);
+
+static void replace_with_number(struct sk_ast_node *node, struct sk_token token, sk_number number);
+static void replace_with_boolean(struct sk_ast_node *node, struct sk_token token, bool boolean);
+static void replace_with_empty_block(struct sk_ast_node *node);
+
+void sk_fold_program(struct sk_ast_node *node)
+{
+    const struct sk_ast_program *program = &node->as.program;
+    for (size_t i = 0; i < program->declarations.count; i++) {
+        fold_declaration(program->declarations.nodes[i]);
+    }
+}
+
+static void fold_declaration(struct sk_ast_node *node)
+{
+    if (node->type == SK_AST_FN) {
+        fold_statement(node->as.fn.body);
+    }
+}
+
+static void fold_statement(struct sk_ast_node *node)
+{
+    switch (node->type) {
+        case SK_AST_BLOCK:
+            fold_statements(&node->as.block.contents);
+            break;
+        case SK_AST_LET:
+            if (node->as.let.has_initializer) {
+                fold_expression(node->as.let.expression);
+            }
+            break;
+        case SK_AST_IF:
+            fold_if(node);
+            break;
+        case SK_AST_WHILE:
+            fold_while(node);
+            break;
+        case SK_AST_RETURN:
+            if (node->as.returnn.expression != NULL) {
+                fold_expression(node->as.returnn.expression);
+            }
+            break;
+        case SK_AST_PRINT:
+            fold_expressions(&node->as.print.args);
+            break;
+        case SK_AST_EXPR_STMT:
+            fold_expression(node->as.expr_stmt.expression);
+            break;
+        default:
+            break;
+    }
+}
+
+static void fold_statements(const struct sk_ast_node_array *nodes)
+{
+    for (size_t i = 0; i < nodes->count; i++) {
+        fold_statement(nodes->nodes[i]);
+    }
+}
+
+static void fold_if(struct sk_ast_node *node)
+{
+    struct sk_ast_if *ifn = &node->as.ifn;
+    fold_expression(ifn->condition);
+    fold_statement(ifn->then_branch);
+    if (ifn->else_branch != NULL) {
+        fold_statement(ifn->else_branch);
+    }
+
+    bool condition;
+    if (!as_boolean_constant(ifn->condition, &condition)) {
+        return;
+    }
+
+    if (condition) {
+        *node = *ifn->then_branch;
+    } else if (ifn->else_branch != NULL) {
+        *node = *ifn->else_branch;
+    } else {
+        replace_with_empty_block(node);
+    }
+}
+
+static void fold_while(struct sk_ast_node *node)
+{
+    fold_expression(node->as.whilen.condition);
+    fold_statement(node->as.whilen.body);
+
+    bool condition;
+    if (as_boolean_constant(node->as.whilen.condition, &condition) && !condition) {
+        replace_with_empty_block(node);
+    }
+}
+
+static void fold_expression(struct sk_ast_node *node)
+{
+    switch (node->type) {
+        case SK_AST_UNARY:
+            fold_unary(node);
+            break;
+        case SK_AST_BINARY:
+            fold_binary(node);
+            break;
+        case SK_AST_CALL:
+            fold_expression(node->as.call.callee);
+            fold_expressions(&node->as.call.args);
+            break;
+        case SK_AST_ASSIGN:
+            fold_expression(node->as.assign.expression);
+            break;
+        default:
+            break;
+    }
+}
+
+static void fold_expressions(const struct sk_ast_node_array *nodes)
+{
+    for (size_t i = 0; i < nodes->count; i++) {
+        fold_expression(nodes->nodes[i]);
+    }
+}
+
+static void fold_unary(struct sk_ast_node *node)
+{
+    const struct sk_token operator = node->as.unary.operator;
+    const struct sk_ast_node *operand = node->as.unary.expression;
+    fold_expression(node->as.unary.expression);
+
+    sk_number number;
+    bool boolean;
+    switch (operator.type) {
+        case SK_TOKEN_PLUS:
+            *node = *operand;
+            break;
+        case SK_TOKEN_MINUS:
+            if (as_number_constant(operand, &number)) {
+                replace_with_number(node, operator, -number);
+            }
+            break;
+        case SK_TOKEN_NOT:
+            if (as_boolean_constant(operand, &boolean)) {
+                replace_with_boolean(node, operator, !boolean);
+            } else if (operand->type == SK_AST_UNARY && operand->as.unary.operator.type == SK_TOKEN_NOT) {
+                *node = *operand->as.unary.expression;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void fold_binary(struct sk_ast_node *node)
+{
+    const enum sk_token_type operator = node->as.binary.operator.type;
+    if (operator == SK_TOKEN_AND || operator == SK_TOKEN_OR) {
+        fold_logical(node);
+        return;
+    }
+
+    const struct sk_ast_node *left = node->as.binary.left;
+    const struct sk_ast_node *right = node->as.binary.right;
+    fold_expression(node->as.binary.left);
+    fold_expression(node->as.binary.right);
+
+    sk_number a;
+    sk_number b;
+    if (as_number_constant(left, &a) && as_number_constant(right, &b) && fold_number_operation(node, a, b)) {
+        return;
+    }
+
+    bool p;
+    bool q;
+    if (as_boolean_constant(left, &p) && as_boolean_constant(right, &q)) {
+        if (operator == SK_TOKEN_EQUAL) {
+            replace_with_boolean(node, node->as.binary.operator, p == q);
+        } else if (operator == SK_TOKEN_NOT_EQUAL) {
+            replace_with_boolean(node, node->as.binary.operator, p != q);
+        }
+
+        return;
+    }
+
+    // Only identities that hold for every double, including -0 and NaN, are applied. `x + 0` is not one of them:
+    // it turns -0 into +0.
+    switch (operator) {
+        case SK_TOKEN_STAR:
+            if (is_number_constant(right, 1)) {
+                *node = *left;
+            } else if (is_number_constant(left, 1)) {
+                *node = *right;
+            }
+            break;
+        case SK_TOKEN_SLASH:
+            if (is_number_constant(right, 1)) {
+                *node = *left;
+            }
+            break;
+        case SK_TOKEN_MINUS:
+            if (is_number_constant(right, 0)) {
+                *node = *left;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void fold_logical(struct sk_ast_node *node)
+{
+    const bool is_and = node->as.binary.operator.type == SK_TOKEN_AND;
+    const struct sk_ast_node *left = node->as.binary.left;
+    const struct sk_ast_node *right = node->as.binary.right;
+    fold_expression(node->as.binary.left);
+    fold_expression(node->as.binary.right);
+
+    // `true && x` is x and `false && x` is false; `||` is the mirror image.
+    bool constant;
+    if (as_boolean_constant(left, &constant)) {
+        *node = constant == is_and ? *right : *left;
+        return;
+    }
+
+    // `x && true` is x. `x && false` is false, but x must still run unless it has no side effects.
+    if (as_boolean_constant(right, &constant)) {
+        if (constant == is_and) {
+            *node = *left;
+        } else if (is_pure(left)) {
+            *node = *right;
+        }
+    }
+}
+
+// The comparisons follow the compiler: `<=` and `>=` are the negated strict comparisons, which matters for NaN.
+static bool fold_number_operation(struct sk_ast_node *node, const sk_number a, const sk_number b)
+{
+    const struct sk_token operator = node->as.binary.operator;
+    switch (operator.type) {
+        case SK_TOKEN_PLUS:
+            replace_with_number(node, operator, a + b);
+            return true;
+        case SK_TOKEN_MINUS:
+            replace_with_number(node, operator, a - b);
+            return true;
+        case SK_TOKEN_STAR:
+            replace_with_number(node, operator, a * b);
+            return true;
+        case SK_TOKEN_SLASH:
+            replace_with_number(node, operator, a / b);
+            return true;
+        case SK_TOKEN_LESS:
+            replace_with_boolean(node, operator, a < b);
+            return true;
+        case SK_TOKEN_LESS_EQ:
+            replace_with_boolean(node, operator, !(a > b));
+            return true;
+        case SK_TOKEN_GREATER:
+            replace_with_boolean(node, operator, a > b);
+            return true;
+        case SK_TOKEN_GREATER_EQ:
+            replace_with_boolean(node, operator, !(a < b));
+            return true;
+        case SK_TOKEN_EQUAL:
+            replace_with_boolean(node, operator, a == b);
+            return true;
+        case SK_TOKEN_NOT_EQUAL:
+            replace_with_boolean(node, operator, a != b);
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool as_number_constant(const struct sk_ast_node *node, sk_number *number)
+{
+    if (node->type != SK_AST_LITERAL || node->as.literal.token.type != SK_TOKEN_NUMBER) {
+        return false;
+    }
+
+    *number = sk_ast_literal_number(&node->as.literal);
+    return true;
+}
+
+static bool as_boolean_constant(const struct sk_ast_node *node, bool *boolean)
+{
+    if (node->type != SK_AST_LITERAL) {
+        return false;
+    }
+
+    switch (node->as.literal.token.type) {
+        case SK_TOKEN_TRUE:
+            *boolean = true;
+            return true;
+        case SK_TOKEN_FALSE:
+            *boolean = false;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Matches +0 but not -0, since only `x - +0` is x for every x.
+static bool is_number_constant(const struct sk_ast_node *node, const sk_number value)
+{
+    sk_number number;
+    return as_number_constant(node, &number) && number == value && !signbit(number);
+}
+
+static bool is_pure(const struct sk_ast_node *node)
+{
+    switch (node->type) {
+        case SK_AST_LITERAL:
+        case SK_AST_IDENTIFIER:
+            return true;
+        case SK_AST_UNARY:
+            return is_pure(node->as.unary.expression);
+        case SK_AST_BINARY:
+            return is_pure(node->as.binary.left) && is_pure(node->as.binary.right);
+        default:
+            return false;
+    }
+}
+
+// The replacement keeps the token of the folded operator so that the node still points at its source location.
+static void replace_with_number(struct sk_ast_node *node, struct sk_token token, const sk_number number)
+{
+    token.type = SK_TOKEN_NUMBER;
+    *node = (struct sk_ast_node) {
+        .type = SK_AST_LITERAL,
+        .as.literal = (struct sk_ast_literal) {
+            .token = token,
+            .folded = true,
+            .number = number,
+        },
+    };
+}
+
+static void replace_with_boolean(struct sk_ast_node *node, struct sk_token token, const bool boolean)
+{
+    token.type = boolean ? SK_TOKEN_TRUE : SK_TOKEN_FALSE;
+    token.start = boolean ? "true" : "false";
+    token.length = boolean ? 4 : 5;
+    *node = (struct sk_ast_node) {
+        .type = SK_AST_LITERAL,
+        .as.literal = (struct sk_ast_literal) {
+            .token = token,
+        },
+    };
+}
+
+static void replace_with_empty_block(struct sk_ast_node *node)
+{
+    *node = (struct sk_ast_node) {
+        .type = SK_AST_BLOCK,
+    };
+    sk_ast_node_array_init(&node->as.block.contents);
+}
@@ -0,0 +1,11 @@
+#ifndef SKARD_SK_FOLD_H
+#define SKARD_SK_FOLD_H
+
+#include "sk_ast.h"
+
+// Simplifies a checked AST in place before it is compiled. Number and Boolean literal subexpressions are evaluated,
+// exact identities such as `x * 1` and `!!b` are removed, `&&`/`||` with a constant operand are short-circuited and
+// `if`/`while` statements with a constant condition are pruned. The program must have passed the checker.
+void sk_fold_program(struct sk_ast_node *node);
+
+#endif // SKARD_SK_FOLD_H
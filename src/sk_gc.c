@@ -0,0 +1,575 @@
+#include "sk_gc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sk_memory.h"
+
+// Nursery objects start at multiples of this, which suits the size_t and pointer fields of every object.
+#define GC_ALIGNMENT sizeof(void *)
+
+#define GC_MIN_STRING_CAPACITY 16
+
+// Takes the place of a string that died in the intern table. Only its address is used.
+static struct sk_object string_tombstone;
+#define GC_STRING_TOMBSTONE ((struct sk_object_string *)&string_tombstone)
+
+static size_t align(size_t size);
+static struct sk_object *allocate_old(struct sk_heap *heap, size_t size);
+static struct sk_object_string **find_string_entry(const struct sk_heap *heap, const struct sk_object_string *string);
+static void resize_strings(struct sk_heap *heap);
+static void update_young_strings(struct sk_heap *heap);
+static void remove_white_strings(struct sk_heap *heap);
+static void push_gray(struct sk_heap *heap, struct sk_object *object);
+static void trace_object(struct sk_heap *heap, struct sk_object *object);
+static struct sk_object *promote(struct sk_heap *heap, struct sk_object *object);
+static void mark_roots(struct sk_heap *heap);
+static void evacuate_nursery(struct sk_heap *heap);
+static void grow_old_generation(struct sk_heap *heap, size_t size);
+static void start_cycle(struct sk_heap *heap);
+static void finish_marking(struct sk_heap *heap);
+static void sweep_object(struct sk_heap *heap);
+static void free_objects(struct sk_object *object);
+static size_t elapsed_us(clock_t start);
+static void record_pause(struct sk_heap *heap, clock_t start);
+
+void sk_heap_init(struct sk_heap *heap)
+{
+    heap->nursery = NULL;
+    heap->nursery_top = NULL;
+    heap->objects = NULL;
+    heap->unswept = NULL;
+    heap->bytes_allocated = 0;
+    heap->next_gc = SK_GC_INITIAL_THRESHOLD;
+    heap->growth_factor = SK_GC_DEFAULT_GROWTH_FACTOR;
+    heap->strings = NULL;
+    heap->string_capacity = 0;
+    heap->string_count = 0;
+    heap->gray = NULL;
+    heap->gray_count = 0;
+    heap->gray_capacity = 0;
+    heap->scratch = NULL;
+    heap->scratch_capacity = 0;
+    heap->phase = SK_GC_IDLE;
+    heap->cycle = SK_GC_CYCLE_IDLE;
+    heap->incremental = false;
+    heap->step_objects = SK_GC_DEFAULT_STEP_OBJECTS;
+    heap->max_pause_us = SK_GC_DEFAULT_MAX_PAUSE_US;
+    heap->root_count = 0;
+    memset(&heap->stats, 0, sizeof heap->stats);
+}
+
+void sk_heap_free(struct sk_heap *heap)
+{
+    free_objects(heap->objects);
+    free_objects(heap->unswept);
+    sk_free(heap->nursery);
+    sk_free(heap->strings);
+    sk_free(heap->gray);
+    sk_free(heap->scratch);
+    sk_heap_init(heap);
+}
+
+void sk_heap_add_roots(struct sk_heap *heap, const struct sk_gc_roots roots)
+{
+    if (heap->root_count >= SK_GC_MAX_ROOT_SETS) {
+        fprintf(stderr, "Too many garbage collector root sets.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    heap->roots[heap->root_count++] = roots;
+}
+
+void sk_heap_remove_roots(struct sk_heap *heap, const void *data)
+{
+    for (size_t i = 0; i < heap->root_count; i++) {
+        if (heap->roots[i].data == data) {
+            heap->roots[i] = heap->roots[--heap->root_count];
+            return;
+        }
+    }
+}
+
+struct sk_object *sk_heap_allocate(
+    struct sk_heap *heap,
+    const enum sk_object_type type,
+    const enum sk_gc_generation generation,
+    const size_t size)
+{
+#ifdef SK_GC_STRESS
+    sk_gc_collect(heap);
+#else
+    sk_gc_step(heap);
+#endif
+
+    struct sk_object *object;
+    const size_t aligned = align(size);
+    if (generation == SK_GC_YOUNG && aligned <= SK_GC_MAX_YOUNG_SIZE) {
+        if (heap->nursery == NULL) {
+            heap->nursery = sk_allocs(SK_GC_NURSERY_SIZE);
+            heap->nursery_top = heap->nursery;
+        }
+
+        if ((size_t)(heap->nursery + SK_GC_NURSERY_SIZE - heap->nursery_top) < aligned) {
+            sk_gc_collect_young(heap);
+        }
+
+        object = (struct sk_object *)heap->nursery_top;
+        heap->nursery_top += aligned;
+        object->next = NULL;
+        object->marked = false;
+    } else {
+        grow_old_generation(heap, size);
+        object = allocate_old(heap, size);
+        object->marked = heap->cycle == SK_GC_CYCLE_MARKING;
+    }
+
+    object->type = type;
+    return object;
+}
+
+size_t sk_heap_size(const struct sk_heap *heap)
+{
+    return heap->bytes_allocated + (size_t)(heap->nursery_top - heap->nursery);
+}
+
+struct sk_gc_stats sk_heap_stats(const struct sk_heap *heap)
+{
+    struct sk_gc_stats stats = heap->stats;
+    stats.live_bytes = sk_heap_size(heap);
+    return stats;
+}
+
+bool sk_heap_is_young(const struct sk_heap *heap, const struct sk_object *object)
+{
+    const uint8_t *address = (const uint8_t *)object;
+    return heap->nursery != NULL && address >= heap->nursery && address < heap->nursery + SK_GC_NURSERY_SIZE;
+}
+
+struct sk_object_string *sk_heap_find_string(
+    const struct sk_heap *heap,
+    const char *chars,
+    const size_t length,
+    const uint32_t hash)
+{
+    if (heap->string_capacity == 0) {
+        return NULL;
+    }
+
+    const size_t mask = heap->string_capacity - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        struct sk_object_string *string = heap->strings[i];
+        if (string == NULL) {
+            return NULL;
+        }
+
+        if (string != GC_STRING_TOMBSTONE && string->hash == hash && string->length == length &&
+            memcmp(string->chars, chars, length) == 0) {
+            return string;
+        }
+    }
+}
+
+void sk_heap_add_string(struct sk_heap *heap, struct sk_object_string *string)
+{
+    if ((heap->string_count + 1) * 4 > heap->string_capacity * 3) {
+        resize_strings(heap);
+    }
+
+    const size_t mask = heap->string_capacity - 1;
+    size_t i = string->hash & mask;
+    while (heap->strings[i] != NULL && heap->strings[i] != GC_STRING_TOMBSTONE) {
+        i = (i + 1) & mask;
+    }
+
+    if (heap->strings[i] == NULL) {
+        heap->string_count++;
+    }
+
+    heap->strings[i] = string;
+}
+
+char *sk_heap_scratch(struct sk_heap *heap, const size_t size)
+{
+    if (size >= heap->scratch_capacity) {
+        while (size >= heap->scratch_capacity) {
+            heap->scratch_capacity = sk_grow(heap->scratch_capacity);
+        }
+
+        heap->scratch = sk_realloc(heap->scratch, heap->scratch_capacity);
+    }
+
+    return heap->scratch;
+}
+
+// In a minor collection marking a young object promotes it, unless an earlier reference already did, and points the
+// reference at the copy. Old objects are left alone. In a major collection marking grays a white old object. Young
+// objects are skipped; the nursery is evacuated before marking finishes.
+void sk_gc_mark_object(struct sk_heap *heap, struct sk_object **object)
+{
+    if (heap->phase == SK_GC_MINOR) {
+        if (sk_heap_is_young(heap, *object)) {
+            *object = promote(heap, *object);
+        }
+
+        return;
+    }
+
+    if (!sk_heap_is_young(heap, *object) && !(*object)->marked) {
+        (*object)->marked = true;
+        push_gray(heap, *object);
+    }
+}
+
+void sk_gc_mark_value(struct sk_heap *heap, struct sk_value *value)
+{
+    if (sk_is_object(*value)) {
+        struct sk_object *object = sk_as_object(*value);
+        sk_gc_mark_object(heap, &object);
+        *value = sk_object_value(object);
+    }
+}
+
+void sk_gc_step(struct sk_heap *heap)
+{
+    if (heap->cycle == SK_GC_CYCLE_IDLE) {
+        return;
+    }
+
+    const clock_t start = clock();
+    heap->phase = SK_GC_MAJOR;
+
+    // The clock is only read every few objects; reading it is slower than tracing a string.
+    for (size_t work = 1; work <= heap->step_objects && heap->cycle != SK_GC_CYCLE_IDLE; work++) {
+        if (heap->cycle == SK_GC_CYCLE_SWEEPING) {
+            sweep_object(heap);
+        } else if (heap->gray_count > 0) {
+            trace_object(heap, heap->gray[--heap->gray_count]);
+        } else {
+            finish_marking(heap);
+        }
+
+        if (work % 32 == 0 && elapsed_us(start) >= heap->max_pause_us) {
+            break;
+        }
+    }
+
+    heap->phase = SK_GC_IDLE;
+    heap->stats.steps++;
+    record_pause(heap, start);
+}
+
+void sk_gc_collect_young(struct sk_heap *heap)
+{
+    const clock_t start = clock();
+
+    evacuate_nursery(heap);
+
+    heap->stats.minor_collections++;
+    record_pause(heap, start);
+
+    grow_old_generation(heap, 0);
+}
+
+void sk_gc_collect(struct sk_heap *heap)
+{
+    const clock_t start = clock();
+
+    while (heap->cycle == SK_GC_CYCLE_SWEEPING) {
+        sweep_object(heap);
+    }
+
+    if (heap->cycle == SK_GC_CYCLE_IDLE) {
+        start_cycle(heap);
+    }
+
+    heap->phase = SK_GC_MAJOR;
+    finish_marking(heap);
+    while (heap->cycle == SK_GC_CYCLE_SWEEPING) {
+        sweep_object(heap);
+    }
+
+    heap->phase = SK_GC_IDLE;
+    record_pause(heap, start);
+}
+
+static size_t align(const size_t size)
+{
+    return (size + GC_ALIGNMENT - 1) / GC_ALIGNMENT * GC_ALIGNMENT;
+}
+
+static struct sk_object *allocate_old(struct sk_heap *heap, const size_t size)
+{
+    struct sk_object *object = sk_allocs(size);
+    object->next = heap->objects;
+    heap->objects = object;
+    heap->bytes_allocated += size;
+    return object;
+}
+
+// The slot of a string the table holds.
+static struct sk_object_string **find_string_entry(const struct sk_heap *heap, const struct sk_object_string *string)
+{
+    const size_t mask = heap->string_capacity - 1;
+    size_t i = string->hash & mask;
+    while (heap->strings[i] != string) {
+        i = (i + 1) & mask;
+    }
+
+    return &heap->strings[i];
+}
+
+// Rehashes the live strings into a table at most half full, which also drops the tombstones.
+static void resize_strings(struct sk_heap *heap)
+{
+    size_t live = 0;
+    for (size_t i = 0; i < heap->string_capacity; i++) {
+        if (heap->strings[i] != NULL && heap->strings[i] != GC_STRING_TOMBSTONE) {
+            live++;
+        }
+    }
+
+    size_t capacity = GC_MIN_STRING_CAPACITY;
+    while ((live + 1) * 2 > capacity) {
+        capacity *= 2;
+    }
+
+    struct sk_object_string **strings = sk_realloc((struct sk_object_string **)NULL, capacity);
+    for (size_t i = 0; i < capacity; i++) {
+        strings[i] = NULL;
+    }
+
+    const size_t mask = capacity - 1;
+    for (size_t i = 0; i < heap->string_capacity; i++) {
+        struct sk_object_string *string = heap->strings[i];
+        if (string == NULL || string == GC_STRING_TOMBSTONE) {
+            continue;
+        }
+
+        size_t j = string->hash & mask;
+        while (strings[j] != NULL) {
+            j = (j + 1) & mask;
+        }
+
+        strings[j] = string;
+    }
+
+    sk_free(heap->strings);
+    heap->strings = strings;
+    heap->string_capacity = capacity;
+    heap->string_count = live;
+}
+
+// Points the table at the copies of the promoted young strings and forgets the others. Runs after promotion, while the
+// nursery still holds the originals and their forwarding addresses.
+static void update_young_strings(struct sk_heap *heap)
+{
+    uint8_t *address = heap->nursery;
+    while (address < heap->nursery_top) {
+        struct sk_object *object = (struct sk_object *)address;
+        address += align(sk_object_size(object));
+        if (object->type == SK_OBJECT_STRING) {
+            struct sk_object_string **entry = find_string_entry(heap, (struct sk_object_string *)object);
+            *entry = object->marked ? (struct sk_object_string *)object->next : GC_STRING_TOMBSTONE;
+        }
+    }
+}
+
+// Forgets the old strings that marking did not reach, before sweeping frees them.
+static void remove_white_strings(struct sk_heap *heap)
+{
+    for (size_t i = 0; i < heap->string_capacity; i++) {
+        struct sk_object_string *string = heap->strings[i];
+        if (string != NULL && string != GC_STRING_TOMBSTONE && !string->obj.marked) {
+            heap->strings[i] = GC_STRING_TOMBSTONE;
+        }
+    }
+}
+
+static void push_gray(struct sk_heap *heap, struct sk_object *object)
+{
+    if (heap->gray_count >= heap->gray_capacity) {
+        heap->gray_capacity = sk_grow(heap->gray_capacity);
+        heap->gray = sk_realloc(heap->gray, heap->gray_capacity);
+    }
+
+    heap->gray[heap->gray_count++] = object;
+}
+
+// Marks or promotes everything `object` refers to, which turns a gray object black. Strings refer to nothing else, so
+// there is nothing to do yet.
+static void trace_object(struct sk_heap *heap, struct sk_object *object)
+{
+    (void)heap;
+
+    switch (object->type) {
+        case SK_OBJECT_STRING:
+            break;
+    }
+}
+
+// Copies a young object into the old generation and leaves the address of the copy in the original, which is flagged
+// by its mark: a nursery object is only ever marked once it has been promoted.
+static struct sk_object *promote(struct sk_heap *heap, struct sk_object *object)
+{
+    if (object->marked) {
+        return object->next;
+    }
+
+    const size_t size = sk_object_size(object);
+    struct sk_object *copy = allocate_old(heap, size);
+    struct sk_object *next = copy->next;
+    memcpy(copy, object, size);
+    copy->next = next;
+
+    object->marked = true;
+    object->next = copy;
+
+    heap->stats.promoted_objects++;
+    heap->stats.promoted_bytes += size;
+    trace_object(heap, copy);
+
+    // Promoted while marking, the copy becomes gray, so that its old references get marked as well.
+    copy->marked = heap->cycle == SK_GC_CYCLE_MARKING;
+    if (copy->marked) {
+        push_gray(heap, copy);
+    }
+
+    return copy;
+}
+
+static void mark_roots(struct sk_heap *heap)
+{
+    for (size_t i = 0; i < heap->root_count; i++) {
+        heap->roots[i].mark(heap, heap->roots[i].data);
+    }
+}
+
+// Promotes the young objects that are still reachable and empties the nursery.
+static void evacuate_nursery(struct sk_heap *heap)
+{
+    const enum sk_gc_phase phase = heap->phase;
+    heap->phase = SK_GC_MINOR;
+    const size_t promoted_bytes = heap->stats.promoted_bytes;
+
+    mark_roots(heap);
+    heap->phase = phase;
+    update_young_strings(heap);
+
+    // Promoted sizes are not rounded up to the alignment, so this also counts the padding of the survivors as freed.
+    const size_t used = (size_t)(heap->nursery_top - heap->nursery);
+    heap->stats.young_freed_bytes += used - (heap->stats.promoted_bytes - promoted_bytes);
+#ifdef SK_GC_STRESS
+    // A young object that a missing root kept out of the old generation is now garbage rather than still readable.
+    if (used > 0) {
+        memset(heap->nursery, 0xAB, used);
+    }
+#endif
+    heap->nursery_top = heap->nursery;
+}
+
+// Starts a major cycle when `size` more bytes would take the old generation past its threshold. An incremental cycle
+// only grays the roots now; any other one runs to completion.
+static void grow_old_generation(struct sk_heap *heap, const size_t size)
+{
+    if (heap->cycle != SK_GC_CYCLE_IDLE || heap->bytes_allocated + size <= heap->next_gc) {
+        return;
+    }
+
+    if (!heap->incremental) {
+        sk_gc_collect(heap);
+        return;
+    }
+
+    const clock_t start = clock();
+    start_cycle(heap);
+    heap->stats.steps++;
+    record_pause(heap, start);
+}
+
+static void start_cycle(struct sk_heap *heap)
+{
+    heap->cycle = SK_GC_CYCLE_MARKING;
+    heap->phase = SK_GC_MAJOR;
+    mark_roots(heap);
+    heap->phase = SK_GC_IDLE;
+}
+
+// Ends marking atomically: the young objects still reachable are promoted gray, the roots are marked again in case
+// the mutator moved a white object into them, and everything gray is traced. The strings left white leave the intern
+// table, and the old objects move to `unswept`.
+static void finish_marking(struct sk_heap *heap)
+{
+    evacuate_nursery(heap);
+
+    heap->phase = SK_GC_MAJOR;
+    mark_roots(heap);
+    while (heap->gray_count > 0) {
+        trace_object(heap, heap->gray[--heap->gray_count]);
+    }
+
+    remove_white_strings(heap);
+    heap->unswept = heap->objects;
+    heap->objects = NULL;
+    heap->cycle = SK_GC_CYCLE_SWEEPING;
+}
+
+// Frees the next unswept object if it is white, or clears its mark and keeps it. The cycle ends with the last one.
+static void sweep_object(struct sk_heap *heap)
+{
+    struct sk_object *object = heap->unswept;
+    if (object == NULL) {
+        const size_t threshold = heap->bytes_allocated * heap->growth_factor;
+        heap->next_gc = threshold > SK_GC_INITIAL_THRESHOLD ? threshold : SK_GC_INITIAL_THRESHOLD;
+        heap->cycle = SK_GC_CYCLE_IDLE;
+        heap->stats.major_collections++;
+        return;
+    }
+
+    heap->unswept = object->next;
+    if (object->marked) {
+        object->marked = false;
+        object->next = heap->objects;
+        heap->objects = object;
+        return;
+    }
+
+    const size_t size = sk_object_size(object);
+    heap->bytes_allocated -= size;
+    heap->stats.freed_objects++;
+    heap->stats.freed_bytes += size;
+    sk_free(object);
+}
+
+static void free_objects(struct sk_object *object)
+{
+    while (object != NULL) {
+        struct sk_object *next = object->next;
+        sk_free(object);
+        object = next;
+    }
+}
+
+static size_t elapsed_us(const clock_t start)
+{
+    return (size_t)((double)(clock() - start) * 1000000.0 / CLOCKS_PER_SEC);
+}
+
+static void record_pause(struct sk_heap *heap, const clock_t start)
+{
+    const size_t pause_us = elapsed_us(start);
+    heap->stats.pauses++;
+    heap->stats.total_pause_us += pause_us;
+    if (pause_us > heap->stats.max_pause_us) {
+        heap->stats.max_pause_us = pause_us;
+    }
+
+    size_t bucket = 0;
+    for (size_t limit = 1; bucket < SK_GC_PAUSE_BUCKETS - 1 && pause_us >= limit; limit *= 10) {
+        bucket++;
+    }
+
+    heap->stats.pause_histogram[bucket]++;
+}
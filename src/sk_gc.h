@@ -0,0 +1,166 @@
+#ifndef SKARD_SK_GC_H
+#define SKARD_SK_GC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sk_object.h"
+#include "sk_value.h"
+
+// Heap objects are allocated through an sk_heap and reclaimed by a precise, generational collector. The heap knows
+// nothing about the values that refer to its objects: whoever holds such values registers a root set, whose `mark`
+// callback passes each of them to sk_gc_mark_value or sk_gc_mark_object. Both may move a young object and update the
+// reference, so the callbacks pass the location of the value rather than the value itself.
+//
+// Young objects are bump-allocated in a nursery of SK_GC_NURSERY_SIZE bytes. When it is full, a minor collection
+// copies the young objects reachable from the roots into the old generation and empties the nursery, without looking
+// at any old object. That is only correct while no object refers to another: objects with references need a write
+// barrier that records the old objects they are stored into. The old generation is a list of individually allocated
+// objects reclaimed by tri-color mark-sweep: marked objects on the gray stack are gray, other marked objects black
+// and unmarked ones white. A major cycle starts when promotions or old allocations take it past `next_gc`;
+// afterwards the threshold is set to `growth_factor` times the bytes that survived, but never below
+// SK_GC_INITIAL_THRESHOLD.
+//
+// A major cycle runs to completion at once unless the heap is `incremental`. Then it only grays the roots when it
+// starts, and every allocation and every sk_gc_step call does a slice of the work: up to `step_objects` objects are
+// traced or swept, and the slice ends early once it has taken `max_pause_us`. When the gray stack runs empty, the
+// nursery is evacuated and the roots, which change without a barrier, are marked again before sweeping starts. Old
+// objects allocated while marking are black.
+#define SK_GC_NURSERY_SIZE ((size_t)256 << 10)
+// Larger objects would fill the nursery too quickly; they are allocated old.
+#define SK_GC_MAX_YOUNG_SIZE (SK_GC_NURSERY_SIZE / 16)
+#define SK_GC_INITIAL_THRESHOLD ((size_t)1 << 20)
+#define SK_GC_DEFAULT_GROWTH_FACTOR 2
+#define SK_GC_DEFAULT_STEP_OBJECTS 256
+#define SK_GC_DEFAULT_MAX_PAUSE_US 1000
+// A program and the VM running it register one root set each.
+#define SK_GC_MAX_ROOT_SETS 4
+// Bucket 0 counts pauses under 1 us, bucket i those under 10^i us and the last one all longer pauses.
+#define SK_GC_PAUSE_BUCKETS 7
+
+struct sk_heap;
+
+struct sk_gc_roots {
+    void *data;
+    void (*mark)(struct sk_heap *heap, void *data);
+};
+
+struct sk_gc_stats {
+    size_t minor_collections;
+    size_t major_collections;
+    // Slices of incremental major cycles.
+    size_t steps;
+    // Young objects that survived a minor collection and moved to the old generation.
+    size_t promoted_objects;
+    size_t promoted_bytes;
+    // Nursery bytes that minor collections reclaimed without copying.
+    size_t young_freed_bytes;
+    // Old objects that major collections swept.
+    size_t freed_objects;
+    size_t freed_bytes;
+    // Every minor collection, whole major cycle and incremental slice is one pause. Their times are measured in
+    // processor time, so unlike the counts they differ from run to run.
+    size_t pauses;
+    size_t total_pause_us;
+    size_t max_pause_us;
+    size_t pause_histogram[SK_GC_PAUSE_BUCKETS];
+    // Bytes the heap holds in both generations, filled in by sk_heap_stats.
+    size_t live_bytes;
+};
+
+enum sk_gc_phase {
+    SK_GC_IDLE,
+    SK_GC_MINOR,
+    SK_GC_MAJOR,
+};
+
+enum sk_gc_cycle {
+    SK_GC_CYCLE_IDLE,
+    SK_GC_CYCLE_MARKING,
+    SK_GC_CYCLE_SWEEPING,
+};
+
+struct sk_heap {
+    // Allocated on the first young allocation.
+    uint8_t *nursery;
+    uint8_t *nursery_top;
+    // Old objects, and the bytes they take up. While sweeping, the objects that still have to be swept are on
+    // `unswept` and `objects` only holds the survivors and the objects allocated since.
+    struct sk_object *objects;
+    struct sk_object *unswept;
+    size_t bytes_allocated;
+    size_t next_gc;
+    size_t growth_factor;
+    // Interned strings, as an open-addressing set probed linearly from their hash. The references are weak: the
+    // collector replaces a promoted string by its copy and a dead one by a tombstone, which keeps later probes going.
+    struct sk_object_string **strings;
+    size_t string_capacity;
+    // Live strings and tombstones.
+    size_t string_count;
+    // Marked objects whose references have not been marked yet.
+    struct sk_object **gray;
+    size_t gray_count;
+    size_t gray_capacity;
+    // Returned by sk_heap_scratch.
+    char *scratch;
+    size_t scratch_capacity;
+    // How sk_gc_mark_object treats the objects it is given right now.
+    enum sk_gc_phase phase;
+    enum sk_gc_cycle cycle;
+    bool incremental;
+    size_t step_objects;
+    size_t max_pause_us;
+    struct sk_gc_roots roots[SK_GC_MAX_ROOT_SETS];
+    size_t root_count;
+    struct sk_gc_stats stats;
+};
+
+void sk_heap_init(struct sk_heap *heap);
+// Frees every object, reachable or not.
+void sk_heap_free(struct sk_heap *heap);
+
+void sk_heap_add_roots(struct sk_heap *heap, struct sk_gc_roots roots);
+// Removes the root set registered with `data`.
+void sk_heap_remove_roots(struct sk_heap *heap, const void *data);
+
+// Allocates an object of `size` bytes, header included, in `generation`, collecting first when the nursery is full or
+// the old generation has grown enough. The new object is not reachable from any root yet, so the caller must make it
+// reachable before allocating again.
+struct sk_object *sk_heap_allocate(
+    struct sk_heap *heap,
+    enum sk_object_type type,
+    enum sk_gc_generation generation,
+    size_t size);
+
+// Bytes the heap holds in both generations.
+size_t sk_heap_size(const struct sk_heap *heap);
+// The statistics so far, along with the current size of the heap.
+struct sk_gc_stats sk_heap_stats(const struct sk_heap *heap);
+bool sk_heap_is_young(const struct sk_heap *heap, const struct sk_object *object);
+
+// The interned string with these contents and hash, or NULL.
+struct sk_object_string *sk_heap_find_string(
+    const struct sk_heap *heap,
+    const char *chars,
+    size_t length,
+    uint32_t hash);
+// Interns a string whose contents are not interned yet.
+void sk_heap_add_string(struct sk_heap *heap, struct sk_object_string *string);
+// A buffer of at least `size` bytes, valid until the next call, in which a new object's contents can be put together
+// before the allocation moves the objects they come from.
+char *sk_heap_scratch(struct sk_heap *heap, size_t size);
+
+void sk_gc_mark_object(struct sk_heap *heap, struct sk_object **object);
+void sk_gc_mark_value(struct sk_heap *heap, struct sk_value *value);
+
+// Does one slice of an incremental major cycle, if one is running. The roots must be up to date.
+void sk_gc_step(struct sk_heap *heap);
+
+// Promotes the reachable young objects and empties the nursery.
+void sk_gc_collect_young(struct sk_heap *heap);
+
+// Runs a minor collection followed by a whole major cycle, finishing the running one first.
+void sk_gc_collect(struct sk_heap *heap);
+
+#endif // SKARD_SK_GC_H
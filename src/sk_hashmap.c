@@ -14,7 +14,6 @@ static struct sk_hashmap_entry *find(
     size_t capacity,
     const char *key,
     size_t key_len);
-static uint32_t hash(const char *key, size_t key_len);
 
 void sk_hashmap_init(struct sk_hashmap *hashmap)
 {
@@ -63,6 +62,18 @@ bool sk_hashmap_get(const struct sk_hashmap *hashmap, const char *key, const siz
     return true;
 }
 
+// 32-bit FNV-1a hash, by Glenn Fowler, Landon Curt Noll, and Kiem-Phong Vo.
+uint32_t sk_hashmap_hash(const char *key, const size_t key_len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < key_len; i++) {
+        hash ^= (uint8_t)key[i];
+        hash *= 16777619;
+    }
+
+    return hash;
+}
+
 static void adjust_capacity(struct sk_hashmap *hashmap, const size_t new_capacity)
 {
     assert(new_capacity > 0);
@@ -100,7 +111,7 @@ static struct sk_hashmap_entry *find(
     const char *key,
     const size_t key_len)
 {
-    uint32_t index = hash(key, key_len) % capacity;
+    uint32_t index = sk_hashmap_hash(key, key_len) % capacity;
     for (;;) {
         struct sk_hashmap_entry *entry = &entries[index];
         if (entry->key == NULL || (entry->key_len == key_len && memcmp(entry->key, key, key_len) == 0)) {
@@ -110,15 +121,3 @@ static struct sk_hashmap_entry *find(
         index = (index + 1) % capacity;
     }
 }
-
-// 32-bit FNV-1a hash, by Glenn Fowler, Landon Curt Noll, and Kiem-Phong Vo.
-static uint32_t hash(const char *key, const size_t key_len)
-{
-    uint32_t hash = 2166136261u;
-    for (size_t i = 0; i < key_len; i++) {
-        hash ^= (uint8_t)key[i];
-        hash *= 16777619;
-    }
-
-    return hash;
-}
@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 struct sk_hashmap_entry {
     const char *key;
@@ -21,5 +22,6 @@ void sk_hashmap_free(struct sk_hashmap *hashmap);
 
 bool sk_hashmap_set(struct sk_hashmap *hashmap, const char *key, size_t key_len, void *value);
 bool sk_hashmap_get(const struct sk_hashmap *hashmap, const char *key, size_t key_len, void **value);
+uint32_t sk_hashmap_hash(const char *key, size_t key_len);
 
 #endif // SKARD_SK_HASHMAP_H
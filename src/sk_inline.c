@@ -0,0 +1,194 @@
+#include "sk_inline.h"
+
+#include "sk_checker.h"
+#include "sk_memory.h"
+
+struct inliner {
+    // The expression to inline for each function, indexed by fnptr, or NULL when the function does not qualify.
+    const struct sk_ast_node **expressions;
+    size_t count;
+};
+
+static void find_candidates(struct inliner *inliner, const struct sk_ast_program *program, size_t threshold);
+static const struct sk_ast_node *inlinable_expression(const struct sk_ast_fn *fn, size_t threshold);
+static bool measure_expression(const struct sk_ast_node *node, size_t threshold, size_t *size);
+
+static void inline_statement(const struct inliner *inliner, struct sk_ast_node *node);
+static void inline_statements(const struct inliner *inliner, const struct sk_ast_node_array *nodes);
+static void inline_expression(const struct inliner *inliner, struct sk_ast_node *node);
+static void inline_expressions(const struct inliner *inliner, const struct sk_ast_node_array *nodes);
+static void inline_call(const struct inliner *inliner, struct sk_ast_node *node);
+
+void sk_inline_program(struct sk_ast_node *node, const size_t threshold)
+{
+    const struct sk_ast_program *program = &node->as.program;
+    if (threshold == 0 || program->declarations.count == 0) {
+        return;
+    }
+
+    struct inliner inliner;
+    find_candidates(&inliner, program, threshold);
+
+    for (size_t i = 0; i < program->declarations.count; i++) {
+        const struct sk_ast_node *declaration = program->declarations.nodes[i];
+        if (declaration->type == SK_AST_FN) {
+            inline_statement(&inliner, declaration->as.fn.body);
+        }
+    }
+
+    sk_free(inliner.expressions);
+}
+
+static void find_candidates(struct inliner *inliner, const struct sk_ast_program *program, const size_t threshold)
+{
+    // Function pointers are numbered in declaration order, so there are no more of them than declarations.
+    inliner->count = program->declarations.count;
+    inliner->expressions = sk_allocs(inliner->count * sizeof *inliner->expressions);
+    for (size_t i = 0; i < inliner->count; i++) {
+        inliner->expressions[i] = NULL;
+    }
+
+    for (size_t i = 0; i < program->declarations.count; i++) {
+        const struct sk_ast_node *declaration = program->declarations.nodes[i];
+        if (declaration->type != SK_AST_FN) {
+            continue;
+        }
+
+        const struct sk_ast_fn *fn = &declaration->as.fn;
+        const sk_fnptr fnptr = fn->symbol->as.fn_overloads.overloads.fnptr;
+        if (fnptr < inliner->count) {
+            inliner->expressions[fnptr] = inlinable_expression(fn, threshold);
+        }
+    }
+}
+
+static const struct sk_ast_node *inlinable_expression(const struct sk_ast_fn *fn, const size_t threshold)
+{
+    const struct sk_ast_node *body = fn->body;
+    if (body->type != SK_AST_BLOCK || body->as.block.contents.count != 1) {
+        return NULL;
+    }
+
+    const struct sk_ast_node *statement = body->as.block.contents.nodes[0];
+    if (statement->type != SK_AST_RETURN || statement->as.returnn.expression == NULL) {
+        return NULL;
+    }
+
+    size_t size = 0;
+    const struct sk_ast_node *expression = statement->as.returnn.expression;
+    return measure_expression(expression, threshold, &size) ? expression : NULL;
+}
+
+// Counts the nodes of an expression into `size`. Fails on calls and assignments, and once the count passes the
+// threshold.
+static bool measure_expression(const struct sk_ast_node *node, const size_t threshold, size_t *size)
+{
+    if (++*size > threshold) {
+        return false;
+    }
+
+    switch (node->type) {
+        case SK_AST_LITERAL:
+        case SK_AST_IDENTIFIER:
+            return true;
+        case SK_AST_UNARY:
+            return measure_expression(node->as.unary.expression, threshold, size);
+        case SK_AST_BINARY:
+            return measure_expression(node->as.binary.left, threshold, size) &&
+                measure_expression(node->as.binary.right, threshold, size);
+        default:
+            return false;
+    }
+}
+
+static void inline_statement(const struct inliner *inliner, struct sk_ast_node *node)
+{
+    switch (node->type) {
+        case SK_AST_BLOCK:
+            inline_statements(inliner, &node->as.block.contents);
+            break;
+        case SK_AST_LET:
+            if (node->as.let.has_initializer) {
+                inline_expression(inliner, node->as.let.expression);
+            }
+            break;
+        case SK_AST_IF:
+            inline_expression(inliner, node->as.ifn.condition);
+            inline_statement(inliner, node->as.ifn.then_branch);
+            if (node->as.ifn.else_branch != NULL) {
+                inline_statement(inliner, node->as.ifn.else_branch);
+            }
+            break;
+        case SK_AST_WHILE:
+            inline_expression(inliner, node->as.whilen.condition);
+            inline_statement(inliner, node->as.whilen.body);
+            break;
+        case SK_AST_RETURN:
+            if (node->as.returnn.expression != NULL) {
+                inline_expression(inliner, node->as.returnn.expression);
+            }
+            break;
+        case SK_AST_PRINT:
+            inline_expressions(inliner, &node->as.print.args);
+            break;
+        case SK_AST_EXPR_STMT:
+            inline_expression(inliner, node->as.expr_stmt.expression);
+            break;
+        default:
+            break;
+    }
+}
+
+static void inline_statements(const struct inliner *inliner, const struct sk_ast_node_array *nodes)
+{
+    for (size_t i = 0; i < nodes->count; i++) {
+        inline_statement(inliner, nodes->nodes[i]);
+    }
+}
+
+static void inline_expression(const struct inliner *inliner, struct sk_ast_node *node)
+{
+    switch (node->type) {
+        case SK_AST_UNARY:
+            inline_expression(inliner, node->as.unary.expression);
+            break;
+        case SK_AST_BINARY:
+            inline_expression(inliner, node->as.binary.left);
+            inline_expression(inliner, node->as.binary.right);
+            break;
+        case SK_AST_CALL:
+            inline_call(inliner, node);
+            break;
+        case SK_AST_ASSIGN:
+            inline_expression(inliner, node->as.assign.expression);
+            break;
+        default:
+            break;
+    }
+}
+
+static void inline_expressions(const struct inliner *inliner, const struct sk_ast_node_array *nodes)
+{
+    for (size_t i = 0; i < nodes->count; i++) {
+        inline_expression(inliner, nodes->nodes[i]);
+    }
+}
+
+static void inline_call(const struct inliner *inliner, struct sk_ast_node *node)
+{
+    struct sk_ast_call *call = &node->as.call;
+    inline_expression(inliner, call->callee);
+    inline_expressions(inliner, &call->args);
+
+    // Only a function named directly is known at compile time; calls through a local holding a function stay calls.
+    const struct sk_ast_node *callee = call->callee;
+    if (callee->type != SK_AST_IDENTIFIER || callee->as.identifier.symbol == NULL ||
+        callee->as.identifier.symbol->type != SK_SYMBOL_FN_OVERLOADS) {
+        return;
+    }
+
+    const sk_fnptr fnptr = callee->as.identifier.symbol->as.fn_overloads.overloads.fnptr;
+    if (fnptr < inliner->count) {
+        call->inlined = inliner->expressions[fnptr];
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef SKARD_SK_INLINE_H
+#define SKARD_SK_INLINE_H
+
+#include <stddef.h>
+
+#include "sk_ast.h"
+
+#define SK_INLINE_DEFAULT_THRESHOLD 16
+
+// Marks direct calls to small leaf functions for expansion at the call site. A function qualifies when its body is a
+// single `return` of an expression built from literals, identifiers and operators with at most `threshold` nodes, so
+// it can neither call, assign nor recurse. The compilers evaluate the arguments into locals past the caller's own and
+// compile the callee's expression against them in place of the call. A threshold of 0 inlines nothing. The program
+// must have passed the checker.
+void sk_inline_program(struct sk_ast_node *node, size_t threshold);
+
+#endif // SKARD_SK_INLINE_H
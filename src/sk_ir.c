@@ -0,0 +1,2427 @@
+#include "sk_ir.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "sk_checker.h"
+#include "sk_memory.h"
+
+// State of a block during SSA construction. `definitions` holds, per variable, the value the block assigned or read
+// last, or SK_IR_NONE. A block is sealed once all its predecessors are known; reads in an unsealed block create phis
+// whose operands are filled in when it is sealed.
+struct block_state {
+    size_t *definitions;
+    bool sealed;
+};
+
+struct incomplete_phi {
+    size_t block;
+    size_t variable;
+    size_t phi;
+};
+
+struct ir_builder {
+    struct sk_ir_function *function;
+    size_t current;
+    size_t variable_count;
+    struct block_state *states;
+    size_t state_capacity;
+    struct incomplete_phi *incomplete;
+    size_t incomplete_capacity;
+    size_t incomplete_count;
+    // Trivial phis found during construction forward to the value they stand for.
+    size_t *replacements;
+    size_t replacement_capacity;
+    // Values of the callee's parameters while an inlined call's expression is built.
+    const size_t *inline_arguments;
+};
+
+static void push_index(size_t **array, size_t *count, size_t *capacity, size_t index);
+
+static void function_free(struct sk_ir_function *function);
+static size_t append_instruction(
+    struct sk_ir_function *function,
+    size_t block,
+    enum sk_ir_opcode opcode,
+    enum sk_type_kind type);
+static size_t append_const(struct sk_ir_function *function, size_t block, sk_number number);
+static void move_instruction(struct sk_ir_function *function, size_t instruction, size_t block, size_t position);
+static size_t phi_count(const struct sk_ir_function *function, size_t block);
+static size_t add_block(struct ir_builder *builder);
+static size_t add_instruction(
+    struct ir_builder *builder,
+    size_t block,
+    enum sk_ir_opcode opcode,
+    enum sk_type_kind type);
+static size_t add_const(struct ir_builder *builder, size_t block, struct sk_value constant, enum sk_type_kind type);
+static size_t add_phi(struct ir_builder *builder, size_t block, enum sk_type_kind type);
+static void add_operand(struct sk_ir_function *function, size_t instruction, size_t operand);
+static void add_edge(struct sk_ir_function *function, size_t from, size_t to);
+static void terminate(struct ir_builder *builder, struct sk_ir_terminator terminator);
+static bool is_terminated(const struct ir_builder *builder);
+
+static void write_variable(struct ir_builder *builder, size_t variable, size_t block, size_t value);
+static size_t read_variable(struct ir_builder *builder, size_t variable, size_t block, enum sk_type_kind type);
+static size_t read_variable_recursive(
+    struct ir_builder *builder,
+    size_t variable,
+    size_t block,
+    enum sk_type_kind type);
+static size_t add_phi_operands(struct ir_builder *builder, size_t variable, size_t phi);
+static size_t try_remove_trivial_phi(struct ir_builder *builder, size_t phi);
+static size_t resolve(const struct ir_builder *builder, size_t value);
+static void seal_block(struct ir_builder *builder, size_t block);
+static void finish_function(struct ir_builder *builder);
+
+static void build_function(struct sk_ir_program *program, const struct sk_ast_node *node);
+static void build_statement(struct ir_builder *builder, const struct sk_ast_node *node);
+static void build_if(struct ir_builder *builder, const struct sk_ast_node *node);
+static void build_while(struct ir_builder *builder, const struct sk_ast_node *node);
+static void build_print(struct ir_builder *builder, const struct sk_ast_node *node);
+static size_t build_expression(struct ir_builder *builder, const struct sk_ast_node *node);
+static size_t build_literal(struct ir_builder *builder, const struct sk_ast_literal *literal);
+static size_t build_identifier(struct ir_builder *builder, const struct sk_ast_identifier *identifier);
+static size_t build_unary(struct ir_builder *builder, const struct sk_ast_unary *unary);
+static size_t build_binary(struct ir_builder *builder, const struct sk_ast_binary *binary);
+static size_t build_short_circuit(struct ir_builder *builder, const struct sk_ast_binary *binary);
+static size_t build_call(struct ir_builder *builder, const struct sk_ast_call *call);
+static enum sk_type_kind call_type(const struct sk_ast_node *callee);
+
+static size_t reverse_postorder(const struct sk_ir_function *function, size_t *order);
+static void count_uses(const struct sk_ir_function *function, size_t *use_counts);
+static void replace_uses(struct sk_ir_function *function, size_t value, size_t replacement);
+static void remove_instruction(struct sk_ir_function *function, size_t instruction);
+static void remove_edge(struct sk_ir_function *function, size_t block, size_t edge);
+static void remove_block(struct sk_ir_function *function, size_t block);
+
+// A natural loop entered only through a jump from `preheader` and closed by the single back-edge from `latch`, which
+// is the shape `while` statements are built with.
+struct loop {
+    size_t header;
+    size_t preheader;
+    size_t latch;
+    // Whether each block of the function belongs to the loop.
+    bool *body;
+};
+
+static size_t *find_dominators(const struct sk_ir_function *function, const size_t *order, size_t count);
+static bool dominates(const size_t *dominators, size_t dominator, size_t block);
+static size_t find_loops(const struct sk_ir_function *function, const size_t *order, size_t count, struct loop **loops);
+static void free_loops(struct loop *loops, size_t count);
+static bool is_invariant_operand(const struct sk_ir_function *function, const struct loop *loop, size_t value);
+static bool is_hoistable(const struct sk_ir_function *function, const struct loop *loop, size_t value);
+static bool hoist_invariants(
+    struct sk_ir_function *function,
+    const struct loop *loop,
+    const size_t *order,
+    size_t count);
+static bool reduce_induction_variable(struct sk_ir_function *function, const struct loop *loop, size_t phi);
+static bool is_small_integer(const struct sk_ir_function *function, size_t value, sk_number *number);
+static size_t other_operand(const struct sk_ir_instruction *instruction, size_t operand);
+
+static bool lower_function(const struct sk_ir_function *function, struct sk_program *bytecode);
+
+static void print_function(const struct sk_ir_program *program, const struct sk_ir_function *function);
+static void print_instruction(
+    const struct sk_ir_program *program,
+    const struct sk_ir_function *function,
+    size_t value);
+static void print_function_name(const struct sk_ir_program *program, sk_fnptr fnptr);
+static const char *type_name(enum sk_type_kind type);
+
+const struct sk_ir_pass sk_ir_default_passes[] = {
+    {"simplify-cfg", sk_ir_simplify_cfg},
+    {"trivial-phis", sk_ir_remove_trivial_phis},
+    {"licm", sk_ir_hoist_loop_invariants},
+    {"strength-reduction", sk_ir_reduce_strength},
+    {"dce", sk_ir_eliminate_dead_code},
+};
+
+const size_t sk_ir_default_pass_count = sizeof sk_ir_default_passes / sizeof sk_ir_default_passes[0];
+
+void sk_ir_program_init(struct sk_ir_program *program)
+{
+    program->functions = NULL;
+    program->capacity = 0;
+    program->count = 0;
+}
+
+void sk_ir_program_free(struct sk_ir_program *program)
+{
+    for (size_t i = 0; i < program->count; i++) {
+        function_free(&program->functions[i]);
+    }
+
+    sk_free(program->functions);
+    sk_ir_program_init(program);
+}
+
+static void push_index(size_t **array, size_t *count, size_t *capacity, const size_t index)
+{
+    if (*count >= *capacity) {
+        *capacity = sk_grow(*capacity);
+        *array = sk_realloc(*array, *capacity);
+    }
+
+    (*array)[(*count)++] = index;
+}
+
+static void function_free(struct sk_ir_function *function)
+{
+    for (size_t i = 0; i < function->block_count; i++) {
+        sk_free(function->blocks[i].instructions);
+        sk_free(function->blocks[i].predecessors);
+    }
+
+    for (size_t i = 0; i < function->instruction_count; i++) {
+        sk_free(function->instructions[i].operands);
+    }
+
+    sk_free(function->blocks);
+    sk_free(function->instructions);
+}
+
+// Adds an instruction at the end of `block`.
+static size_t append_instruction(
+    struct sk_ir_function *function,
+    const size_t block,
+    const enum sk_ir_opcode opcode,
+    const enum sk_type_kind type)
+{
+    if (function->instruction_count >= function->instruction_capacity) {
+        function->instruction_capacity = sk_grow(function->instruction_capacity);
+        function->instructions = sk_realloc(function->instructions, function->instruction_capacity);
+    }
+
+    const size_t instruction = function->instruction_count++;
+    function->instructions[instruction] = (struct sk_ir_instruction) {
+        .opcode = opcode,
+        .type = type,
+        .block = block,
+        .removed = false,
+        .operands = NULL,
+        .operand_count = 0,
+        .operand_capacity = 0,
+        .constant = sk_nothing_value(),
+        .chars = NULL,
+        .length = 0,
+        .index = 0,
+    };
+
+    struct sk_ir_block *ir_block = &function->blocks[block];
+    push_index(&ir_block->instructions, &ir_block->instruction_count, &ir_block->instruction_capacity, instruction);
+    return instruction;
+}
+
+static size_t append_const(struct sk_ir_function *function, const size_t block, const sk_number number)
+{
+    const size_t instruction = append_instruction(function, block, SK_IR_CONST, SK_TYPE_NUMBER);
+    function->instructions[instruction].constant = sk_number_value(number);
+    return instruction;
+}
+
+// Takes the instruction out of its block and inserts it into `block` before the instruction at `position`.
+static void move_instruction(
+    struct sk_ir_function *function,
+    const size_t instruction,
+    const size_t block,
+    const size_t position)
+{
+    struct sk_ir_block *from = &function->blocks[function->instructions[instruction].block];
+    size_t kept = 0;
+    for (size_t i = 0; i < from->instruction_count; i++) {
+        if (from->instructions[i] != instruction) {
+            from->instructions[kept++] = from->instructions[i];
+        }
+    }
+
+    from->instruction_count = kept;
+
+    struct sk_ir_block *to = &function->blocks[block];
+    push_index(&to->instructions, &to->instruction_count, &to->instruction_capacity, instruction);
+    memmove(
+        &to->instructions[position + 1],
+        &to->instructions[position],
+        (to->instruction_count - 1 - position) * sizeof *to->instructions);
+    to->instructions[position] = instruction;
+    function->instructions[instruction].block = block;
+}
+
+static size_t phi_count(const struct sk_ir_function *function, const size_t block)
+{
+    const struct sk_ir_block *ir_block = &function->blocks[block];
+    size_t count = 0;
+    while (count < ir_block->instruction_count &&
+        function->instructions[ir_block->instructions[count]].opcode == SK_IR_PHI) {
+        count++;
+    }
+
+    return count;
+}
+
+bool sk_ir_has_side_effects(const enum sk_ir_opcode opcode)
+{
+    return opcode == SK_IR_CALL || opcode == SK_IR_CALL_DIRECT || opcode == SK_IR_PRINT;
+}
+
+// Construction follows Braun et al., "Simple and Efficient Construction of Static Single Assignment Form": locals are
+// looked up through the blocks on demand instead of computing dominance frontiers first.
+
+void sk_ir_build(struct sk_ir_program *program, const struct sk_ast_node *node)
+{
+    const struct sk_ast_program *ast = &node->as.program;
+    for (size_t i = 0; i < ast->declarations.count; i++) {
+        if (ast->declarations.nodes[i]->type == SK_AST_FN) {
+            build_function(program, ast->declarations.nodes[i]);
+        }
+    }
+}
+
+static size_t add_block(struct ir_builder *builder)
+{
+    struct sk_ir_function *function = builder->function;
+    if (function->block_count >= function->block_capacity) {
+        function->block_capacity = sk_grow(function->block_capacity);
+        function->blocks = sk_realloc(function->blocks, function->block_capacity);
+    }
+
+    if (function->block_count >= builder->state_capacity) {
+        builder->state_capacity = sk_grow(builder->state_capacity);
+        builder->states = sk_realloc(builder->states, builder->state_capacity);
+    }
+
+    const size_t block = function->block_count++;
+    function->blocks[block] = (struct sk_ir_block) {
+        .instructions = NULL,
+        .instruction_count = 0,
+        .instruction_capacity = 0,
+        .predecessors = NULL,
+        .predecessor_count = 0,
+        .predecessor_capacity = 0,
+        .terminator = {SK_IR_TERMINATOR_NONE, SK_IR_NONE, {SK_IR_NONE, SK_IR_NONE}},
+        .removed = false,
+    };
+
+    struct block_state *state = &builder->states[block];
+    state->definitions = sk_allocs(builder->variable_count * sizeof *state->definitions);
+    for (size_t i = 0; i < builder->variable_count; i++) {
+        state->definitions[i] = SK_IR_NONE;
+    }
+
+    state->sealed = false;
+    return block;
+}
+
+static size_t add_instruction(
+    struct ir_builder *builder,
+    const size_t block,
+    const enum sk_ir_opcode opcode,
+    const enum sk_type_kind type)
+{
+    if (builder->function->instruction_count >= builder->replacement_capacity) {
+        builder->replacement_capacity = sk_grow(builder->replacement_capacity);
+        builder->replacements = sk_realloc(builder->replacements, builder->replacement_capacity);
+    }
+
+    const size_t instruction = append_instruction(builder->function, block, opcode, type);
+    builder->replacements[instruction] = SK_IR_NONE;
+    return instruction;
+}
+
+static size_t add_const(
+    struct ir_builder *builder,
+    const size_t block,
+    const struct sk_value constant,
+    const enum sk_type_kind type)
+{
+    const size_t instruction = add_instruction(builder, block, SK_IR_CONST, type);
+    builder->function->instructions[instruction].constant = constant;
+    return instruction;
+}
+
+// Phis go before the other instructions of their block.
+static size_t add_phi(struct ir_builder *builder, const size_t block, const enum sk_type_kind type)
+{
+    const size_t position = phi_count(builder->function, block);
+    const size_t phi = add_instruction(builder, block, SK_IR_PHI, type);
+    move_instruction(builder->function, phi, block, position);
+    return phi;
+}
+
+static void add_operand(struct sk_ir_function *function, const size_t instruction, const size_t operand)
+{
+    struct sk_ir_instruction *ir_instruction = &function->instructions[instruction];
+    push_index(&ir_instruction->operands, &ir_instruction->operand_count, &ir_instruction->operand_capacity, operand);
+}
+
+static void add_edge(struct sk_ir_function *function, const size_t from, const size_t to)
+{
+    struct sk_ir_block *block = &function->blocks[to];
+    push_index(&block->predecessors, &block->predecessor_count, &block->predecessor_capacity, from);
+}
+
+static void terminate(struct ir_builder *builder, const struct sk_ir_terminator terminator)
+{
+    builder->function->blocks[builder->current].terminator = terminator;
+    if (terminator.kind == SK_IR_JUMP || terminator.kind == SK_IR_BRANCH) {
+        add_edge(builder->function, builder->current, terminator.targets[0]);
+    }
+
+    if (terminator.kind == SK_IR_BRANCH) {
+        add_edge(builder->function, builder->current, terminator.targets[1]);
+    }
+}
+
+static bool is_terminated(const struct ir_builder *builder)
+{
+    return builder->function->blocks[builder->current].terminator.kind != SK_IR_TERMINATOR_NONE;
+}
+
+static void write_variable(struct ir_builder *builder, const size_t variable, const size_t block, const size_t value)
+{
+    builder->states[block].definitions[variable] = value;
+}
+
+static size_t read_variable(
+    struct ir_builder *builder,
+    const size_t variable,
+    const size_t block,
+    const enum sk_type_kind type)
+{
+    const size_t value = builder->states[block].definitions[variable];
+    if (value != SK_IR_NONE) {
+        return resolve(builder, value);
+    }
+
+    return read_variable_recursive(builder, variable, block, type);
+}
+
+static size_t read_variable_recursive(
+    struct ir_builder *builder,
+    const size_t variable,
+    const size_t block,
+    const enum sk_type_kind type)
+{
+    const struct sk_ir_block *ir_block = &builder->function->blocks[block];
+    size_t value;
+    if (!builder->states[block].sealed) {
+        value = add_phi(builder, block, type);
+        if (builder->incomplete_count >= builder->incomplete_capacity) {
+            builder->incomplete_capacity = sk_grow(builder->incomplete_capacity);
+            builder->incomplete = sk_realloc(builder->incomplete, builder->incomplete_capacity);
+        }
+
+        builder->incomplete[builder->incomplete_count++] = (struct incomplete_phi) {block, variable, value};
+    } else if (ir_block->predecessor_count == 0) {
+        // Locals start out as nothing, and so does a local read in unreachable code.
+        value = add_const(builder, block, sk_nothing_value(), SK_TYPE_NOTHING);
+    } else if (ir_block->predecessor_count == 1) {
+        value = read_variable(builder, variable, ir_block->predecessors[0], type);
+    } else {
+        // The phi is recorded first so that a loop leading back here finds it.
+        value = add_phi(builder, block, type);
+        write_variable(builder, variable, block, value);
+        value = add_phi_operands(builder, variable, value);
+    }
+
+    write_variable(builder, variable, block, value);
+    return value;
+}
+
+static size_t add_phi_operands(struct ir_builder *builder, const size_t variable, const size_t phi)
+{
+    struct sk_ir_function *function = builder->function;
+    const size_t block = function->instructions[phi].block;
+    const enum sk_type_kind type = function->instructions[phi].type;
+    for (size_t i = 0; i < function->blocks[block].predecessor_count; i++) {
+        const size_t operand = read_variable(builder, variable, function->blocks[block].predecessors[i], type);
+        add_operand(function, phi, operand);
+    }
+
+    return try_remove_trivial_phi(builder, phi);
+}
+
+static size_t try_remove_trivial_phi(struct ir_builder *builder, const size_t phi)
+{
+    struct sk_ir_function *function = builder->function;
+    size_t same = SK_IR_NONE;
+    for (size_t i = 0; i < function->instructions[phi].operand_count; i++) {
+        const size_t operand = resolve(builder, function->instructions[phi].operands[i]);
+        if (operand == same || operand == phi) {
+            continue;
+        }
+
+        if (same != SK_IR_NONE) {
+            return phi;
+        }
+
+        same = operand;
+    }
+
+    if (same == SK_IR_NONE) {
+        same = add_const(builder, function->instructions[phi].block, sk_nothing_value(), SK_TYPE_NOTHING);
+    }
+
+    builder->replacements[phi] = same;
+    function->instructions[phi].removed = true;
+    return same;
+}
+
+static size_t resolve(const struct ir_builder *builder, size_t value)
+{
+    while (builder->replacements[value] != SK_IR_NONE) {
+        value = builder->replacements[value];
+    }
+
+    return value;
+}
+
+static void seal_block(struct ir_builder *builder, const size_t block)
+{
+    struct incomplete_phi *pending = NULL;
+    size_t pending_count = 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < builder->incomplete_count; i++) {
+        if (builder->incomplete[i].block == block) {
+            pending = sk_realloc(pending, pending_count + 1);
+            pending[pending_count++] = builder->incomplete[i];
+        } else {
+            builder->incomplete[kept++] = builder->incomplete[i];
+        }
+    }
+
+    builder->incomplete_count = kept;
+    builder->states[block].sealed = true;
+    for (size_t i = 0; i < pending_count; i++) {
+        add_phi_operands(builder, pending[i].variable, pending[i].phi);
+    }
+
+    sk_free(pending);
+}
+
+// Points every use at the values that forwarded phis stand for, drops those phis from their blocks and removes the
+// phis that only became trivial later.
+static void finish_function(struct ir_builder *builder)
+{
+    struct sk_ir_function *function = builder->function;
+    for (size_t i = 0; i < function->instruction_count; i++) {
+        struct sk_ir_instruction *instruction = &function->instructions[i];
+        for (size_t j = 0; j < instruction->operand_count; j++) {
+            instruction->operands[j] = resolve(builder, instruction->operands[j]);
+        }
+    }
+
+    for (size_t i = 0; i < function->block_count; i++) {
+        struct sk_ir_block *block = &function->blocks[i];
+        if (block->terminator.value != SK_IR_NONE) {
+            block->terminator.value = resolve(builder, block->terminator.value);
+        }
+
+        size_t kept = 0;
+        for (size_t j = 0; j < block->instruction_count; j++) {
+            if (!function->instructions[block->instructions[j]].removed) {
+                block->instructions[kept++] = block->instructions[j];
+            }
+        }
+
+        block->instruction_count = kept;
+    }
+
+    sk_ir_remove_trivial_phis(function);
+}
+
+static void build_function(struct sk_ir_program *program, const struct sk_ast_node *node)
+{
+    const struct sk_ast_fn *fn = &node->as.fn;
+    const struct sk_symbol_function *symbol = &fn->symbol->as.fn_overloads.overloads;
+
+    if (program->count >= program->capacity) {
+        program->capacity = sk_grow(program->capacity);
+        program->functions = sk_realloc(program->functions, program->capacity);
+    }
+
+    struct sk_ir_function *function = &program->functions[program->count++];
+    *function = (struct sk_ir_function) {
+        .name = fn->name,
+        .fnptr = symbol->fnptr,
+        .parameter_count = fn->parameters.count,
+        .blocks = NULL,
+        .block_count = 0,
+        .block_capacity = 0,
+        .instructions = NULL,
+        .instruction_count = 0,
+        .instruction_capacity = 0,
+    };
+
+    struct ir_builder builder = {
+        .function = function,
+        .current = 0,
+        .variable_count = fn->locals_count,
+        .states = NULL,
+        .state_capacity = 0,
+        .incomplete = NULL,
+        .incomplete_capacity = 0,
+        .incomplete_count = 0,
+        .replacements = NULL,
+        .replacement_capacity = 0,
+        .inline_arguments = NULL,
+    };
+
+    builder.current = add_block(&builder);
+    seal_block(&builder, builder.current);
+
+    const struct sk_type_array *parameter_types = &symbol->type->as.function.parameters;
+    for (size_t i = 0; i < fn->parameters.count; i++) {
+        const enum sk_type_kind type = parameter_types->types[i].kind;
+        const size_t parameter = add_instruction(&builder, builder.current, SK_IR_PARAMETER, type);
+        function->instructions[parameter].index = i;
+        write_variable(&builder, i, builder.current, parameter);
+    }
+
+    build_statement(&builder, fn->body);
+    if (!is_terminated(&builder)) {
+        const size_t nothing = add_const(&builder, builder.current, sk_nothing_value(), SK_TYPE_NOTHING);
+        terminate(&builder, (struct sk_ir_terminator) {SK_IR_RETURN, nothing, {SK_IR_NONE, SK_IR_NONE}});
+    }
+
+    finish_function(&builder);
+
+    for (size_t i = 0; i < function->block_count; i++) {
+        sk_free(builder.states[i].definitions);
+    }
+
+    sk_free(builder.states);
+    sk_free(builder.incomplete);
+    sk_free(builder.replacements);
+}
+
+static void build_statement(struct ir_builder *builder, const struct sk_ast_node *node)
+{
+    switch (node->type) {
+        case SK_AST_BLOCK:
+            for (size_t i = 0; i < node->as.block.contents.count; i++) {
+                build_statement(builder, node->as.block.contents.nodes[i]);
+            }
+            break;
+        case SK_AST_LET: {
+            const struct sk_ast_let *let = &node->as.let;
+            const size_t value = let->expression != NULL
+                ? build_expression(builder, let->expression)
+                : add_const(builder, builder->current, sk_nothing_value(), SK_TYPE_NOTHING);
+            write_variable(builder, let->symbol->as.local.slot, builder->current, value);
+            break;
+        }
+        case SK_AST_IF:
+            build_if(builder, node);
+            break;
+        case SK_AST_WHILE:
+            build_while(builder, node);
+            break;
+        case SK_AST_PRINT:
+            build_print(builder, node);
+            break;
+        case SK_AST_RETURN: {
+            const struct sk_ast_node *expression = node->as.returnn.expression;
+            const size_t value = expression != NULL
+                ? build_expression(builder, expression)
+                : add_const(builder, builder->current, sk_nothing_value(), SK_TYPE_NOTHING);
+            terminate(builder, (struct sk_ir_terminator) {SK_IR_RETURN, value, {SK_IR_NONE, SK_IR_NONE}});
+
+            // Whatever follows the return goes into a block that nothing jumps to.
+            builder->current = add_block(builder);
+            seal_block(builder, builder->current);
+            break;
+        }
+        case SK_AST_EXPR_STMT:
+            build_expression(builder, node->as.expr_stmt.expression);
+            break;
+        default:
+            break;
+    }
+}
+
+static void build_if(struct ir_builder *builder, const struct sk_ast_node *node)
+{
+    const struct sk_ast_if *ifn = &node->as.ifn;
+    const size_t condition = build_expression(builder, ifn->condition);
+
+    const size_t then_block = add_block(builder);
+    const size_t else_block = ifn->else_branch != NULL ? add_block(builder) : SK_IR_NONE;
+    const size_t merge_block = add_block(builder);
+    terminate(
+        builder,
+        (struct sk_ir_terminator) {
+            SK_IR_BRANCH,
+            condition,
+            {then_block, else_block != SK_IR_NONE ? else_block : merge_block},
+        });
+
+    seal_block(builder, then_block);
+    builder->current = then_block;
+    build_statement(builder, ifn->then_branch);
+    if (!is_terminated(builder)) {
+        terminate(builder, (struct sk_ir_terminator) {SK_IR_JUMP, SK_IR_NONE, {merge_block, SK_IR_NONE}});
+    }
+
+    if (else_block != SK_IR_NONE) {
+        seal_block(builder, else_block);
+        builder->current = else_block;
+        build_statement(builder, ifn->else_branch);
+        if (!is_terminated(builder)) {
+            terminate(builder, (struct sk_ir_terminator) {SK_IR_JUMP, SK_IR_NONE, {merge_block, SK_IR_NONE}});
+        }
+    }
+
+    seal_block(builder, merge_block);
+    builder->current = merge_block;
+}
+
+// The header stays unsealed until the body has been built, since the back-edge is its last predecessor.
+static void build_while(struct ir_builder *builder, const struct sk_ast_node *node)
+{
+    const struct sk_ast_while *whilen = &node->as.whilen;
+    const size_t header = add_block(builder);
+    terminate(builder, (struct sk_ir_terminator) {SK_IR_JUMP, SK_IR_NONE, {header, SK_IR_NONE}});
+
+    builder->current = header;
+    const size_t condition = build_expression(builder, whilen->condition);
+    const size_t body = add_block(builder);
+    const size_t exit = add_block(builder);
+    terminate(builder, (struct sk_ir_terminator) {SK_IR_BRANCH, condition, {body, exit}});
+
+    seal_block(builder, body);
+    builder->current = body;
+    build_statement(builder, whilen->body);
+    if (!is_terminated(builder)) {
+        terminate(builder, (struct sk_ir_terminator) {SK_IR_JUMP, SK_IR_NONE, {header, SK_IR_NONE}});
+    }
+
+    seal_block(builder, header);
+    seal_block(builder, exit);
+    builder->current = exit;
+}
+
+// Arguments are evaluated from the last one to the template, as in the stack compiler.
+static void build_print(struct ir_builder *builder, const struct sk_ast_node *node)
+{
+    const struct sk_ast_print *print = &node->as.print;
+    if (print->args.count == 0) {
+        return;
+    }
+
+    size_t *values = sk_allocs(print->args.count * sizeof *values);
+    for (size_t i = print->args.count; i > 0; i--) {
+        values[print->args.count - i] = build_expression(builder, print->args.nodes[i - 1]);
+    }
+
+    const size_t instruction = add_instruction(builder, builder->current, SK_IR_PRINT, SK_TYPE_NOTHING);
+    for (size_t i = 0; i < print->args.count; i++) {
+        add_operand(builder->function, instruction, values[i]);
+    }
+
+    sk_free(values);
+}
+
+static size_t build_expression(struct ir_builder *builder, const struct sk_ast_node *node)
+{
+    switch (node->type) {
+        case SK_AST_LITERAL:
+            return build_literal(builder, &node->as.literal);
+        case SK_AST_IDENTIFIER:
+            return build_identifier(builder, &node->as.identifier);
+        case SK_AST_UNARY:
+            return build_unary(builder, &node->as.unary);
+        case SK_AST_BINARY:
+            return build_binary(builder, &node->as.binary);
+        case SK_AST_CALL:
+            return build_call(builder, &node->as.call);
+        case SK_AST_ASSIGN: {
+            const struct sk_ast_assign *assign = &node->as.assign;
+            const size_t value = build_expression(builder, assign->expression);
+            write_variable(builder, assign->symbol->as.local.slot, builder->current, value);
+            return value;
+        }
+        default:
+            return add_const(builder, builder->current, sk_nothing_value(), SK_TYPE_NOTHING);
+    }
+}
+
+static size_t build_literal(struct ir_builder *builder, const struct sk_ast_literal *literal)
+{
+    switch (literal->token.type) {
+        case SK_TOKEN_TRUE:
+            return add_const(builder, builder->current, sk_boolean_true, SK_TYPE_BOOLEAN);
+        case SK_TOKEN_FALSE:
+            return add_const(builder, builder->current, sk_boolean_false, SK_TYPE_BOOLEAN);
+        case SK_TOKEN_NUMBER:
+            return add_const(
+                builder,
+                builder->current,
+                sk_number_value(sk_ast_literal_number(literal)),
+                SK_TYPE_NUMBER);
+        case SK_TOKEN_STRING: {
+            const size_t instruction = add_instruction(builder, builder->current, SK_IR_STRING, SK_TYPE_STRING);
+            builder->function->instructions[instruction].chars = literal->token.start + 1;
+            builder->function->instructions[instruction].length = literal->token.length - 2;
+            return instruction;
+        }
+        default:
+            return add_const(builder, builder->current, sk_nothing_value(), SK_TYPE_NOTHING);
+    }
+}
+
+static size_t build_identifier(struct ir_builder *builder, const struct sk_ast_identifier *identifier)
+{
+    const struct sk_symbol *symbol = identifier->symbol;
+    if (symbol->type == SK_SYMBOL_FN_OVERLOADS) {
+        return add_const(
+            builder,
+            builder->current,
+            sk_fnptr_value(symbol->as.fn_overloads.overloads.fnptr),
+            SK_TYPE_FUNCTION);
+    }
+
+    if (builder->inline_arguments != NULL) {
+        return builder->inline_arguments[symbol->as.local.slot];
+    }
+
+    return read_variable(builder, symbol->as.local.slot, builder->current, symbol->as.local.type->kind);
+}
+
+static size_t build_unary(struct ir_builder *builder, const struct sk_ast_unary *unary)
+{
+    const size_t operand = build_expression(builder, unary->expression);
+
+    enum sk_ir_opcode opcode;
+    enum sk_type_kind type;
+    switch (unary->operator.type) {
+        case SK_TOKEN_MINUS:
+            opcode = SK_IR_NNEG;
+            type = SK_TYPE_NUMBER;
+            break;
+        case SK_TOKEN_NOT:
+            opcode = SK_IR_NOT;
+            type = SK_TYPE_BOOLEAN;
+            break;
+        default:
+            // Unary plus leaves the operand as it is.
+            return operand;
+    }
+
+    const size_t instruction = add_instruction(builder, builder->current, opcode, type);
+    add_operand(builder->function, instruction, operand);
+    return instruction;
+}
+
+static size_t build_binary(struct ir_builder *builder, const struct sk_ast_binary *binary)
+{
+    if (binary->operator.type == SK_TOKEN_AND || binary->operator.type == SK_TOKEN_OR) {
+        return build_short_circuit(builder, binary);
+    }
+
+    const size_t left = build_expression(builder, binary->left);
+    const size_t right = build_expression(builder, binary->right);
+
+    enum sk_ir_opcode opcode;
+    enum sk_type_kind type = SK_TYPE_BOOLEAN;
+    switch (binary->operator.type) {
+        case SK_TOKEN_PLUS:
+            opcode = binary->number_operands ? SK_IR_NADD : SK_IR_CONCAT;
+            type = binary->number_operands ? SK_TYPE_NUMBER : SK_TYPE_STRING;
+            break;
+        case SK_TOKEN_MINUS:
+            opcode = SK_IR_NSUB;
+            type = SK_TYPE_NUMBER;
+            break;
+        case SK_TOKEN_STAR:
+            opcode = SK_IR_NMUL;
+            type = SK_TYPE_NUMBER;
+            break;
+        case SK_TOKEN_SLASH:
+            opcode = SK_IR_NDIV;
+            type = SK_TYPE_NUMBER;
+            break;
+        case SK_TOKEN_LESS:
+            opcode = SK_IR_NLESS;
+            break;
+        case SK_TOKEN_LESS_EQ:
+            opcode = SK_IR_NLESS_EQUAL;
+            break;
+        case SK_TOKEN_GREATER:
+            opcode = SK_IR_NGREATER;
+            break;
+        case SK_TOKEN_GREATER_EQ:
+            opcode = SK_IR_NGREATER_EQUAL;
+            break;
+        case SK_TOKEN_EQUAL:
+            opcode = binary->number_operands ? SK_IR_NEQUAL : SK_IR_EQUAL;
+            break;
+        default:
+            opcode = binary->number_operands ? SK_IR_NNOT_EQUAL : SK_IR_NOT_EQUAL;
+            break;
+    }
+
+    const size_t instruction = add_instruction(builder, builder->current, opcode, type);
+    add_operand(builder->function, instruction, left);
+    add_operand(builder->function, instruction, right);
+    return instruction;
+}
+
+// `a && b` and `a || b` only evaluate `b` when `a` does not decide the result. Both paths meet in a block whose phi
+// takes `a` from the block that tested it and `b` from the block that computed it.
+static size_t build_short_circuit(struct ir_builder *builder, const struct sk_ast_binary *binary)
+{
+    const size_t left = build_expression(builder, binary->left);
+    const size_t right_block = add_block(builder);
+    const size_t merge_block = add_block(builder);
+    const bool is_and = binary->operator.type == SK_TOKEN_AND;
+    terminate(
+        builder,
+        (struct sk_ir_terminator) {
+            SK_IR_BRANCH,
+            left,
+            {is_and ? right_block : merge_block, is_and ? merge_block : right_block},
+        });
+
+    seal_block(builder, right_block);
+    builder->current = right_block;
+    const size_t right = build_expression(builder, binary->right);
+    terminate(builder, (struct sk_ir_terminator) {SK_IR_JUMP, SK_IR_NONE, {merge_block, SK_IR_NONE}});
+
+    seal_block(builder, merge_block);
+    builder->current = merge_block;
+    const size_t phi = add_phi(builder, merge_block, SK_TYPE_BOOLEAN);
+    add_operand(builder->function, phi, left);
+    add_operand(builder->function, phi, right);
+    return phi;
+}
+
+static size_t build_call(struct ir_builder *builder, const struct sk_ast_call *call)
+{
+    if (call->inlined != NULL) {
+        // Inlined expressions cannot assign, so the callee's parameters are simply the argument values.
+        size_t *arguments = sk_allocs((call->args.count + 1) * sizeof *arguments);
+        for (size_t i = 0; i < call->args.count; i++) {
+            arguments[i] = build_expression(builder, call->args.nodes[i]);
+        }
+
+        const size_t *inline_arguments = builder->inline_arguments;
+        builder->inline_arguments = arguments;
+        const size_t value = build_expression(builder, call->inlined);
+        builder->inline_arguments = inline_arguments;
+
+        sk_free(arguments);
+        return value;
+    }
+
+    const struct sk_ast_node *callee = call->callee;
+    const bool direct = callee->type == SK_AST_IDENTIFIER &&
+        callee->as.identifier.symbol->type == SK_SYMBOL_FN_OVERLOADS;
+
+    size_t *operands = sk_allocs((call->args.count + 1) * sizeof *operands);
+    size_t operand_count = 0;
+    if (!direct) {
+        operands[operand_count++] = build_expression(builder, callee);
+    }
+
+    for (size_t i = 0; i < call->args.count; i++) {
+        operands[operand_count++] = build_expression(builder, call->args.nodes[i]);
+    }
+
+    const size_t instruction = add_instruction(
+        builder,
+        builder->current,
+        direct ? SK_IR_CALL_DIRECT : SK_IR_CALL,
+        call_type(callee));
+    if (direct) {
+        const struct sk_symbol *symbol = callee->as.identifier.symbol;
+        builder->function->instructions[instruction].index = symbol->as.fn_overloads.overloads.fnptr;
+    }
+
+    for (size_t i = 0; i < operand_count; i++) {
+        add_operand(builder->function, instruction, operands[i]);
+    }
+
+    sk_free(operands);
+    return instruction;
+}
+
+// The result type is known when the callee is named; other callees are typed by the checker only in the AST.
+static enum sk_type_kind call_type(const struct sk_ast_node *callee)
+{
+    if (callee->type != SK_AST_IDENTIFIER) {
+        return SK_TYPE_UNKNOWN;
+    }
+
+    const struct sk_symbol *symbol = callee->as.identifier.symbol;
+    const struct sk_type *type = symbol->type == SK_SYMBOL_FN_OVERLOADS
+        ? symbol->as.fn_overloads.overloads.type
+        : symbol->as.local.type;
+    return type->kind == SK_TYPE_FUNCTION ? type->as.function.return_type->kind : SK_TYPE_UNKNOWN;
+}
+
+// Fills `order` with the reachable blocks in reverse postorder and returns their number. Successors are visited in
+// reverse so that a branch's first target is laid out right after it.
+static size_t reverse_postorder(const struct sk_ir_function *function, size_t *order)
+{
+    bool *visited = sk_allocs(function->block_count * sizeof *visited);
+    memset(visited, 0, function->block_count * sizeof *visited);
+
+    // Depth-first search with an explicit stack of blocks and the number of successors visited so far.
+    size_t *stack = sk_allocs(2 * function->block_count * sizeof *stack);
+    size_t depth = 0;
+    size_t count = 0;
+    stack[depth++] = 0;
+    stack[depth++] = 0;
+    visited[0] = true;
+
+    while (depth > 0) {
+        const size_t block = stack[depth - 2];
+        const struct sk_ir_terminator *terminator = &function->blocks[block].terminator;
+        const size_t successor_count = terminator->kind == SK_IR_BRANCH ? 2 : terminator->kind == SK_IR_JUMP ? 1 : 0;
+        const size_t visited_count = stack[depth - 1];
+
+        if (visited_count == successor_count) {
+            order[count++] = block;
+            depth -= 2;
+            continue;
+        }
+
+        stack[depth - 1]++;
+        const size_t successor = terminator->targets[successor_count - 1 - visited_count];
+        if (!visited[successor]) {
+            visited[successor] = true;
+            stack[depth++] = successor;
+            stack[depth++] = 0;
+        }
+    }
+
+    for (size_t i = 0; i < count / 2; i++) {
+        const size_t swap = order[i];
+        order[i] = order[count - 1 - i];
+        order[count - 1 - i] = swap;
+    }
+
+    sk_free(stack);
+    sk_free(visited);
+    return count;
+}
+
+static void count_uses(const struct sk_ir_function *function, size_t *use_counts)
+{
+    memset(use_counts, 0, function->instruction_count * sizeof *use_counts);
+    for (size_t i = 0; i < function->block_count; i++) {
+        const struct sk_ir_block *block = &function->blocks[i];
+        if (block->removed) {
+            continue;
+        }
+
+        for (size_t j = 0; j < block->instruction_count; j++) {
+            const struct sk_ir_instruction *instruction = &function->instructions[block->instructions[j]];
+            for (size_t k = 0; k < instruction->operand_count; k++) {
+                use_counts[instruction->operands[k]]++;
+            }
+        }
+
+        if (block->terminator.value != SK_IR_NONE) {
+            use_counts[block->terminator.value]++;
+        }
+    }
+}
+
+static void replace_uses(struct sk_ir_function *function, const size_t value, const size_t replacement)
+{
+    for (size_t i = 0; i < function->instruction_count; i++) {
+        struct sk_ir_instruction *instruction = &function->instructions[i];
+        for (size_t j = 0; j < instruction->operand_count; j++) {
+            if (instruction->operands[j] == value) {
+                instruction->operands[j] = replacement;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < function->block_count; i++) {
+        if (function->blocks[i].terminator.value == value) {
+            function->blocks[i].terminator.value = replacement;
+        }
+    }
+}
+
+static void remove_instruction(struct sk_ir_function *function, const size_t instruction)
+{
+    struct sk_ir_block *block = &function->blocks[function->instructions[instruction].block];
+    size_t kept = 0;
+    for (size_t i = 0; i < block->instruction_count; i++) {
+        if (block->instructions[i] != instruction) {
+            block->instructions[kept++] = block->instructions[i];
+        }
+    }
+
+    block->instruction_count = kept;
+    function->instructions[instruction].removed = true;
+}
+
+// Removes the incoming edge `edge` of `block` and the matching operand of each of its phis.
+static void remove_edge(struct sk_ir_function *function, const size_t block, const size_t edge)
+{
+    struct sk_ir_block *ir_block = &function->blocks[block];
+    for (size_t i = 0; i < ir_block->instruction_count; i++) {
+        struct sk_ir_instruction *phi = &function->instructions[ir_block->instructions[i]];
+        if (phi->opcode != SK_IR_PHI) {
+            break;
+        }
+
+        memmove(
+            &phi->operands[edge],
+            &phi->operands[edge + 1],
+            (phi->operand_count - edge - 1) * sizeof *phi->operands);
+        phi->operand_count--;
+    }
+
+    memmove(
+        &ir_block->predecessors[edge],
+        &ir_block->predecessors[edge + 1],
+        (ir_block->predecessor_count - edge - 1) * sizeof *ir_block->predecessors);
+    ir_block->predecessor_count--;
+}
+
+// Removes the block together with its outgoing edges, and the matching operands of the successors' phis.
+static void remove_block(struct sk_ir_function *function, const size_t block)
+{
+    struct sk_ir_block *ir_block = &function->blocks[block];
+    for (size_t i = 0; i < ir_block->instruction_count; i++) {
+        function->instructions[ir_block->instructions[i]].removed = true;
+    }
+
+    ir_block->instruction_count = 0;
+    ir_block->removed = true;
+
+    const struct sk_ir_terminator terminator = ir_block->terminator;
+    const size_t successor_count = terminator.kind == SK_IR_BRANCH ? 2 : terminator.kind == SK_IR_JUMP ? 1 : 0;
+    for (size_t i = 0; i < successor_count; i++) {
+        const struct sk_ir_block *successor = &function->blocks[terminator.targets[i]];
+        size_t edge = 0;
+        while (successor->predecessors[edge] != block) {
+            edge++;
+        }
+
+        remove_edge(function, terminator.targets[i], edge);
+    }
+
+    ir_block->terminator = (struct sk_ir_terminator) {SK_IR_TERMINATOR_NONE, SK_IR_NONE, {SK_IR_NONE, SK_IR_NONE}};
+}
+
+bool sk_ir_simplify_cfg(struct sk_ir_function *function)
+{
+    bool changed = false;
+
+    // A branch on a constant becomes a jump to the target it always takes.
+    for (size_t i = 0; i < function->block_count; i++) {
+        struct sk_ir_block *block = &function->blocks[i];
+        if (block->removed || block->terminator.kind != SK_IR_BRANCH) {
+            continue;
+        }
+
+        const struct sk_ir_instruction *condition = &function->instructions[block->terminator.value];
+        if (condition->opcode != SK_IR_CONST || condition->type != SK_TYPE_BOOLEAN) {
+            continue;
+        }
+
+        const size_t taken = block->terminator.targets[sk_as_boolean(condition->constant) ? 0 : 1];
+        const size_t dropped = block->terminator.targets[sk_as_boolean(condition->constant) ? 1 : 0];
+
+        // The dropped edge is the last one of the two from this block into `dropped`.
+        const struct sk_ir_block *target = &function->blocks[dropped];
+        size_t edge = target->predecessor_count;
+        do {
+            edge--;
+        } while (target->predecessors[edge] != i);
+
+        remove_edge(function, dropped, edge);
+
+        block->terminator = (struct sk_ir_terminator) {SK_IR_JUMP, SK_IR_NONE, {taken, SK_IR_NONE}};
+        changed = true;
+    }
+
+    size_t *order = sk_allocs(function->block_count * sizeof *order);
+    const size_t reachable_count = reverse_postorder(function, order);
+    bool *reachable = sk_allocs(function->block_count * sizeof *reachable);
+    memset(reachable, 0, function->block_count * sizeof *reachable);
+    for (size_t i = 0; i < reachable_count; i++) {
+        reachable[order[i]] = true;
+    }
+
+    for (size_t i = 0; i < function->block_count; i++) {
+        if (!reachable[i] && !function->blocks[i].removed) {
+            remove_block(function, i);
+            changed = true;
+        }
+    }
+
+    sk_free(reachable);
+    sk_free(order);
+    return changed;
+}
+
+bool sk_ir_remove_trivial_phis(struct sk_ir_function *function)
+{
+    bool changed = false;
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        for (size_t i = 0; i < function->instruction_count; i++) {
+            const struct sk_ir_instruction *phi = &function->instructions[i];
+            if (phi->removed || phi->opcode != SK_IR_PHI) {
+                continue;
+            }
+
+            size_t same = SK_IR_NONE;
+            bool trivial = true;
+            for (size_t j = 0; j < phi->operand_count && trivial; j++) {
+                if (phi->operands[j] == same || phi->operands[j] == i) {
+                    continue;
+                }
+
+                trivial = same == SK_IR_NONE;
+                same = phi->operands[j];
+            }
+
+            // A phi without operands other than itself only exists in unreachable code, which is removed anyway.
+            if (!trivial || same == SK_IR_NONE) {
+                continue;
+            }
+
+            replace_uses(function, i, same);
+            remove_instruction(function, i);
+            progress = true;
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+// Marks the instructions with side effects and the values of terminators as live, then everything they use, and
+// removes the rest.
+bool sk_ir_eliminate_dead_code(struct sk_ir_function *function)
+{
+    bool *live = sk_allocs(function->instruction_count * sizeof *live);
+    memset(live, 0, function->instruction_count * sizeof *live);
+    size_t *worklist = sk_allocs((function->instruction_count + 1) * sizeof *worklist);
+    size_t worklist_count = 0;
+
+    for (size_t i = 0; i < function->block_count; i++) {
+        const struct sk_ir_block *block = &function->blocks[i];
+        if (block->removed) {
+            continue;
+        }
+
+        for (size_t j = 0; j < block->instruction_count; j++) {
+            const size_t instruction = block->instructions[j];
+            if (sk_ir_has_side_effects(function->instructions[instruction].opcode)) {
+                live[instruction] = true;
+                worklist[worklist_count++] = instruction;
+            }
+        }
+
+        const size_t value = block->terminator.value;
+        if (value != SK_IR_NONE && !live[value]) {
+            live[value] = true;
+            worklist[worklist_count++] = value;
+        }
+    }
+
+    while (worklist_count > 0) {
+        const struct sk_ir_instruction *instruction = &function->instructions[worklist[--worklist_count]];
+        for (size_t i = 0; i < instruction->operand_count; i++) {
+            const size_t operand = instruction->operands[i];
+            if (!live[operand]) {
+                live[operand] = true;
+                worklist[worklist_count++] = operand;
+            }
+        }
+    }
+
+    bool changed = false;
+    for (size_t i = 0; i < function->block_count; i++) {
+        struct sk_ir_block *block = &function->blocks[i];
+        size_t kept = 0;
+        for (size_t j = 0; j < block->instruction_count; j++) {
+            if (live[block->instructions[j]]) {
+                block->instructions[kept++] = block->instructions[j];
+            } else {
+                function->instructions[block->instructions[j]].removed = true;
+                changed = true;
+            }
+        }
+
+        block->instruction_count = kept;
+    }
+
+    sk_free(worklist);
+    sk_free(live);
+    return changed;
+}
+
+// Immediate dominators by the iterative algorithm of Cooper, Harvey and Kennedy, "A Simple, Fast Dominance
+// Algorithm". `order` holds the reachable blocks in reverse postorder; unreachable blocks get SK_IR_NONE and the entry
+// block dominates itself.
+static size_t *find_dominators(const struct sk_ir_function *function, const size_t *order, const size_t count)
+{
+    size_t *numbers = sk_allocs((function->block_count + 1) * sizeof *numbers);
+    size_t *dominators = sk_allocs((function->block_count + 1) * sizeof *dominators);
+    for (size_t i = 0; i < function->block_count; i++) {
+        dominators[i] = SK_IR_NONE;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        numbers[order[i]] = i;
+    }
+
+    dominators[order[0]] = order[0];
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < count; i++) {
+            const struct sk_ir_block *block = &function->blocks[order[i]];
+            size_t dominator = SK_IR_NONE;
+            for (size_t j = 0; j < block->predecessor_count; j++) {
+                size_t predecessor = block->predecessors[j];
+                if (dominators[predecessor] == SK_IR_NONE) {
+                    continue;
+                }
+
+                if (dominator == SK_IR_NONE) {
+                    dominator = predecessor;
+                    continue;
+                }
+
+                while (predecessor != dominator) {
+                    while (numbers[predecessor] > numbers[dominator]) {
+                        predecessor = dominators[predecessor];
+                    }
+
+                    while (numbers[dominator] > numbers[predecessor]) {
+                        dominator = dominators[dominator];
+                    }
+                }
+            }
+
+            if (dominators[order[i]] != dominator) {
+                dominators[order[i]] = dominator;
+                changed = true;
+            }
+        }
+    }
+
+    sk_free(numbers);
+    return dominators;
+}
+
+static bool dominates(const size_t *dominators, const size_t dominator, size_t block)
+{
+    while (block != dominator && dominators[block] != block) {
+        block = dominators[block];
+    }
+
+    return block == dominator;
+}
+
+// Finds the loops of the function, inner loops before the loops around them. Loops of any other shape are skipped.
+static size_t find_loops(
+    const struct sk_ir_function *function,
+    const size_t *order,
+    const size_t count,
+    struct loop **loops)
+{
+    size_t *dominators = find_dominators(function, order, count);
+    size_t *worklist = sk_allocs((function->block_count + 1) * sizeof *worklist);
+    size_t loop_count = 0;
+    *loops = NULL;
+
+    // A header comes after the headers of the loops around it in reverse postorder.
+    for (size_t i = count; i > 0; i--) {
+        const size_t header = order[i - 1];
+        const struct sk_ir_block *block = &function->blocks[header];
+        if (block->predecessor_count != 2) {
+            continue;
+        }
+
+        size_t latch = SK_IR_NONE;
+        size_t preheader = SK_IR_NONE;
+        for (size_t j = 0; j < 2; j++) {
+            const size_t predecessor = block->predecessors[j];
+            if (dominators[predecessor] != SK_IR_NONE && dominates(dominators, header, predecessor)) {
+                latch = predecessor;
+            } else {
+                preheader = predecessor;
+            }
+        }
+
+        if (latch == SK_IR_NONE || preheader == SK_IR_NONE ||
+            function->blocks[preheader].terminator.kind != SK_IR_JUMP) {
+            continue;
+        }
+
+        bool *body = sk_allocs(function->block_count * sizeof *body);
+        memset(body, 0, function->block_count * sizeof *body);
+        body[header] = true;
+
+        // The body is everything that reaches the latch without passing through the header.
+        size_t worklist_count = 0;
+        if (!body[latch]) {
+            body[latch] = true;
+            worklist[worklist_count++] = latch;
+        }
+
+        while (worklist_count > 0) {
+            const struct sk_ir_block *member = &function->blocks[worklist[--worklist_count]];
+            for (size_t j = 0; j < member->predecessor_count; j++) {
+                if (!body[member->predecessors[j]]) {
+                    body[member->predecessors[j]] = true;
+                    worklist[worklist_count++] = member->predecessors[j];
+                }
+            }
+        }
+
+        *loops = sk_realloc(*loops, loop_count + 1);
+        (*loops)[loop_count++] = (struct loop) {header, preheader, latch, body};
+    }
+
+    sk_free(worklist);
+    sk_free(dominators);
+    return loop_count;
+}
+
+static void free_loops(struct loop *loops, const size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        sk_free(loops[i].body);
+    }
+
+    sk_free(loops);
+}
+
+// Constants are the same value wherever they are defined, so they count as invariant even inside the loop.
+static bool is_invariant_operand(const struct sk_ir_function *function, const struct loop *loop, const size_t value)
+{
+    const struct sk_ir_instruction *instruction = &function->instructions[value];
+    return instruction->opcode == SK_IR_CONST || instruction->opcode == SK_IR_STRING || !loop->body[instruction->block];
+}
+
+static bool is_hoistable(const struct sk_ir_function *function, const struct loop *loop, const size_t value)
+{
+    const struct sk_ir_instruction *instruction = &function->instructions[value];
+    switch (instruction->opcode) {
+        case SK_IR_CONST:
+        case SK_IR_STRING:
+        case SK_IR_PARAMETER:
+        case SK_IR_PHI:
+            return false;
+        default:
+            break;
+    }
+
+    if (sk_ir_has_side_effects(instruction->opcode)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < instruction->operand_count; i++) {
+        if (!is_invariant_operand(function, loop, instruction->operands[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Moves the invariant instructions of the loop, and the constants they use, to the end of the preheader. Blocks are
+// visited in reverse postorder, so the operands of an instruction are hoisted before it.
+static bool hoist_invariants(
+    struct sk_ir_function *function,
+    const struct loop *loop,
+    const size_t *order,
+    const size_t count)
+{
+    bool changed = false;
+    for (size_t i = 0; i < count; i++) {
+        const size_t block = order[i];
+        if (!loop->body[block]) {
+            continue;
+        }
+
+        // Hoisting takes instructions out of the block, so the scan starts over after each one.
+        size_t position = 0;
+        while (position < function->blocks[block].instruction_count) {
+            const size_t value = function->blocks[block].instructions[position];
+            if (!is_hoistable(function, loop, value)) {
+                position++;
+                continue;
+            }
+
+            const struct sk_ir_instruction *instruction = &function->instructions[value];
+            const struct sk_ir_block *preheader = &function->blocks[loop->preheader];
+            for (size_t j = 0; j < instruction->operand_count; j++) {
+                const size_t operand = instruction->operands[j];
+                if (loop->body[function->instructions[operand].block]) {
+                    move_instruction(function, operand, loop->preheader, preheader->instruction_count);
+                }
+            }
+
+            move_instruction(function, value, loop->preheader, preheader->instruction_count);
+            position = 0;
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+bool sk_ir_hoist_loop_invariants(struct sk_ir_function *function)
+{
+    size_t *order = sk_allocs((function->block_count + 1) * sizeof *order);
+    const size_t count = reverse_postorder(function, order);
+    struct loop *loops;
+    const size_t loop_count = find_loops(function, order, count, &loops);
+
+    bool changed = false;
+    for (size_t i = 0; i < loop_count; i++) {
+        changed = hoist_invariants(function, &loops[i], order, count) || changed;
+    }
+
+    free_loops(loops, loop_count);
+    sk_free(order);
+    return changed;
+}
+
+// Integers up to this magnitude multiply to exact doubles, so the reduced variable takes exactly the values the
+// products would have had as long as those stay below 2^53.
+#define REDUCTION_LIMIT 1048576.0
+
+static bool is_small_integer(const struct sk_ir_function *function, const size_t value, sk_number *number)
+{
+    const struct sk_ir_instruction *instruction = &function->instructions[value];
+    if (instruction->opcode != SK_IR_CONST || !sk_is_number(instruction->constant)) {
+        return false;
+    }
+
+    // Negative zero would give products a sign the sums do not have.
+    *number = sk_as_number(instruction->constant);
+    return *number >= -REDUCTION_LIMIT && *number <= REDUCTION_LIMIT && *number == (sk_number)(int32_t)*number &&
+        (*number != 0 || 1 / *number > 0);
+}
+
+static size_t other_operand(const struct sk_ir_instruction *instruction, const size_t operand)
+{
+    return instruction->operands[0] == operand ? instruction->operands[1] : instruction->operands[0];
+}
+
+// Rewrites an induction variable `i = phi [start, i + step]` that is only used by its increment, by multiplications
+// with the same positive constant `k` and by comparisons with constants into one that counts `i * k` directly: the
+// start, the step and the constants compared with are multiplied by `k` and the multiplications disappear. The
+// comparisons keep their results because multiplying by a positive number preserves order.
+static bool reduce_induction_variable(struct sk_ir_function *function, const struct loop *loop, const size_t phi)
+{
+    const struct sk_ir_instruction *variable = &function->instructions[phi];
+    const struct sk_ir_block *header = &function->blocks[loop->header];
+    const size_t entry = header->predecessors[0] == loop->preheader ? 0 : 1;
+    if (variable->opcode != SK_IR_PHI || variable->type != SK_TYPE_NUMBER) {
+        return false;
+    }
+
+    sk_number start;
+    sk_number step;
+    const size_t next = variable->operands[1 - entry];
+    const struct sk_ir_instruction *increment = &function->instructions[next];
+    if (!is_small_integer(function, variable->operands[entry], &start) || increment->operand_count != 2 ||
+        !(increment->opcode == SK_IR_NADD || (increment->opcode == SK_IR_NSUB && increment->operands[0] == phi)) ||
+        (increment->operands[0] != phi && increment->operands[1] != phi) ||
+        !is_small_integer(function, other_operand(increment, phi), &step)) {
+        return false;
+    }
+
+    size_t *use_counts = sk_allocs((function->instruction_count + 1) * sizeof *use_counts);
+    count_uses(function, use_counts);
+    const bool increment_used_once = use_counts[next] == 1;
+    size_t uses = use_counts[phi];
+    sk_free(use_counts);
+    if (!increment_used_once) {
+        return false;
+    }
+
+    // Every use other than the increment has to be a multiplication or a comparison. The users are collected first
+    // because replacing the multiplications adds uses of the variable.
+    size_t *users = sk_allocs((uses + 1) * sizeof *users);
+    size_t user_count = 0;
+    sk_number factor = 0;
+    for (size_t i = 0; i < function->instruction_count && user_count <= uses; i++) {
+        const struct sk_ir_instruction *user = &function->instructions[i];
+        if (user->removed || i == next || user->operand_count != 2 ||
+            (user->operands[0] != phi && user->operands[1] != phi)) {
+            continue;
+        }
+
+        sk_number number;
+        bool reducible = user->operands[0] != user->operands[1] &&
+            is_small_integer(function, other_operand(user, phi), &number);
+        if (reducible && user->opcode == SK_IR_NMUL) {
+            reducible = number > 0 && (factor == 0 || number == factor);
+            factor = number;
+        } else if (reducible) {
+            reducible = user->opcode >= SK_IR_NLESS && user->opcode <= SK_IR_NNOT_EQUAL;
+        }
+
+        if (!reducible) {
+            sk_free(users);
+            return false;
+        }
+
+        users[user_count++] = i;
+    }
+
+    // The increment is the one use left over.
+    if (factor == 0 || user_count + 1 != uses) {
+        sk_free(users);
+        return false;
+    }
+
+    users[user_count++] = next;
+    for (size_t i = 0; i < user_count; i++) {
+        struct sk_ir_instruction *user = &function->instructions[users[i]];
+        if (user->opcode == SK_IR_NMUL) {
+            replace_uses(function, users[i], phi);
+            remove_instruction(function, users[i]);
+            continue;
+        }
+
+        const size_t operand = user->operands[0] == phi ? 1 : 0;
+        const sk_number number = sk_as_number(function->instructions[user->operands[operand]].constant);
+        user->operands[operand] = append_const(function, loop->preheader, number * factor);
+    }
+
+    function->instructions[phi].operands[entry] = append_const(function, loop->preheader, start * factor);
+    sk_free(users);
+    return true;
+}
+
+// Replaces multiplications of induction variables by a constant with the induction variable itself, stepping by the
+// constant times the original step. An interpreter pays the same dispatch for a multiplication as for an addition,
+// so the rewrite only applies when the original counter disappears with it.
+bool sk_ir_reduce_strength(struct sk_ir_function *function)
+{
+    size_t *order = sk_allocs((function->block_count + 1) * sizeof *order);
+    const size_t count = reverse_postorder(function, order);
+    struct loop *loops;
+    const size_t loop_count = find_loops(function, order, count, &loops);
+
+    bool changed = false;
+    for (size_t i = 0; i < loop_count; i++) {
+        const size_t phis = phi_count(function, loops[i].header);
+        for (size_t j = 0; j < phis; j++) {
+            const size_t phi = function->blocks[loops[i].header].instructions[j];
+            changed = reduce_induction_variable(function, &loops[i], phi) || changed;
+        }
+    }
+
+    free_loops(loops, loop_count);
+    sk_free(order);
+    return changed;
+}
+
+void sk_ir_run_passes(struct sk_ir_program *program, const struct sk_ir_pass *passes, const size_t count)
+{
+    for (size_t i = 0; i < program->count; i++) {
+        bool changed = true;
+        for (size_t round = 0; changed && round < SK_IR_MAX_PASS_ROUNDS; round++) {
+            changed = false;
+            for (size_t j = 0; j < count; j++) {
+                changed = passes[j].run(&program->functions[i]) || changed;
+            }
+        }
+    }
+}
+
+// Where the bytecode of a value is emitted.
+enum placement {
+    // Never emitted: unused values without side effects.
+    PLACEMENT_NONE,
+    // Constants are pushed again at every use.
+    PLACEMENT_REMATERIALIZED,
+    // Computed at its only use, straight onto the operand stack.
+    PLACEMENT_SUNK,
+    // Computed in place and stored to its slot. Parameters and phis have a slot but no code of their own.
+    PLACEMENT_SLOT,
+    // Computed in place for its side effects; a value is popped right away.
+    PLACEMENT_EFFECT,
+};
+
+struct jump_patch {
+    size_t position;
+    size_t block;
+};
+
+struct lowering {
+    const struct sk_ir_function *function;
+    struct sk_program *program;
+    struct sk_chunk *chunk;
+    enum placement *placements;
+    size_t *slots;
+    size_t *block_offsets;
+    struct jump_patch *patches;
+    size_t patch_capacity;
+    size_t patch_count;
+    bool has_error;
+};
+
+static void place_values(struct lowering *lowering);
+static bool is_edge_operand(const struct sk_ir_function *function, size_t value, size_t phi);
+static bool is_number_slot(const struct lowering *lowering, size_t value);
+static void lowering_error(struct lowering *lowering, const char *message);
+static void emit_with_operand(struct lowering *lowering, uint8_t opcode, size_t operand, const char *overflow_message);
+static void emit_jump_to(struct lowering *lowering, size_t block);
+static size_t emit_forward_jump(struct lowering *lowering, uint8_t opcode);
+static bool emit_compare_jump(struct lowering *lowering, size_t value, bool jump_if, size_t *position);
+static void patch_forward_jump(struct lowering *lowering, size_t position, size_t target);
+static void emit_value(struct lowering *lowering, size_t value);
+static void emit_operation(struct lowering *lowering, size_t value, bool tail);
+static void emit_block(struct lowering *lowering, size_t block, size_t next_block);
+static void emit_edge(struct lowering *lowering, size_t from, size_t to, bool last_edge);
+
+bool sk_ir_lower(const struct sk_ir_program *program, struct sk_program *bytecode)
+{
+    sk_program_init(bytecode);
+
+    bool lowered = true;
+    for (size_t i = 0; i < program->count && lowered; i++) {
+        lowered = lower_function(&program->functions[i], bytecode);
+    }
+
+    return lowered;
+}
+
+static bool lower_function(const struct sk_ir_function *function, struct sk_program *bytecode)
+{
+    struct sk_compiled_function *compiled = sk_program_add_function(bytecode, function->fnptr);
+    struct lowering lowering = {
+        .function = function,
+        .program = bytecode,
+        .chunk = &compiled->chunk,
+        .placements = sk_allocs((function->instruction_count + 1) * sizeof *lowering.placements),
+        .slots = sk_allocs((function->instruction_count + 1) * sizeof *lowering.slots),
+        .block_offsets = sk_allocs((function->block_count + 1) * sizeof *lowering.block_offsets),
+        .patches = NULL,
+        .patch_capacity = 0,
+        .patch_count = 0,
+        .has_error = false,
+    };
+
+    place_values(&lowering);
+
+    size_t locals_count = function->parameter_count;
+    for (size_t i = 0; i < function->instruction_count; i++) {
+        lowering.slots[i] = SK_IR_NONE;
+        if (lowering.placements[i] != PLACEMENT_SLOT) {
+            continue;
+        }
+
+        const struct sk_ir_instruction *instruction = &function->instructions[i];
+        lowering.slots[i] = instruction->opcode == SK_IR_PARAMETER ? instruction->index : locals_count++;
+    }
+
+    size_t *order = sk_allocs((function->block_count + 1) * sizeof *order);
+    const size_t block_count = reverse_postorder(function, order);
+    for (size_t i = 0; i < function->block_count; i++) {
+        lowering.block_offsets[i] = SK_IR_NONE;
+    }
+
+    for (size_t i = 0; i < block_count && !lowering.has_error; i++) {
+        lowering.block_offsets[order[i]] = lowering.chunk->count;
+        emit_block(&lowering, order[i], i + 1 < block_count ? order[i + 1] : SK_IR_NONE);
+    }
+
+    for (size_t i = 0; i < lowering.patch_count && !lowering.has_error; i++) {
+        patch_forward_jump(&lowering, lowering.patches[i].position, lowering.block_offsets[lowering.patches[i].block]);
+    }
+
+    compiled->chunk.locals_count = locals_count;
+    compiled->chunk.frame_size = locals_count + sk_chunk_max_stack_depth(&compiled->chunk);
+    compiled->parameter_count = function->parameter_count;
+    if (function->name.length == 4 && memcmp(function->name.start, "main", 4) == 0) {
+        lowering.program->entry = function->fnptr;
+    }
+
+    const bool lowered = !lowering.has_error;
+    sk_free(order);
+    sk_free(lowering.patches);
+    sk_free(lowering.block_offsets);
+    sk_free(lowering.slots);
+    sk_free(lowering.placements);
+    return lowered;
+}
+
+// Decides where each value is emitted. A value without side effects that is used once, by a later instruction or the
+// terminator of its own block, is computed right where it is used: values never change, so moving the computation
+// is always safe. A call is only moved into its user when no other code runs in between, which keeps the order of
+// side effects.
+static void place_values(struct lowering *lowering)
+{
+    const struct sk_ir_function *function = lowering->function;
+    const size_t count = function->instruction_count;
+    size_t *use_counts = sk_allocs((count + 1) * sizeof *use_counts);
+    size_t *users = sk_allocs((count + 1) * sizeof *users);
+    size_t *positions = sk_allocs((count + 1) * sizeof *positions);
+    count_uses(function, use_counts);
+
+    // The terminator of a block counts as the position after its last instruction, and its user index is `count`.
+    for (size_t i = 0; i < count; i++) {
+        users[i] = SK_IR_NONE;
+        lowering->placements[i] = PLACEMENT_NONE;
+    }
+
+    for (size_t i = 0; i < function->block_count; i++) {
+        const struct sk_ir_block *block = &function->blocks[i];
+        for (size_t j = 0; j < block->instruction_count; j++) {
+            const size_t instruction = block->instructions[j];
+            positions[instruction] = j;
+            for (size_t k = 0; k < function->instructions[instruction].operand_count; k++) {
+                users[function->instructions[instruction].operands[k]] = instruction;
+            }
+        }
+
+        if (block->terminator.value != SK_IR_NONE) {
+            users[block->terminator.value] = count;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const struct sk_ir_instruction *instruction = &function->instructions[i];
+        if (instruction->removed) {
+            continue;
+        }
+
+        const size_t user = users[i];
+        const bool local_use = use_counts[i] == 1 &&
+            (user == count || (function->instructions[user].block == instruction->block &&
+                function->instructions[user].opcode != SK_IR_PHI) ||
+                is_edge_operand(function, i, user));
+
+        switch (instruction->opcode) {
+            case SK_IR_CONST:
+            case SK_IR_STRING:
+                lowering->placements[i] = PLACEMENT_REMATERIALIZED;
+                break;
+            case SK_IR_PARAMETER:
+            case SK_IR_PHI:
+                lowering->placements[i] = use_counts[i] > 0 ? PLACEMENT_SLOT : PLACEMENT_NONE;
+                break;
+            case SK_IR_CALL:
+            case SK_IR_CALL_DIRECT:
+            case SK_IR_PRINT:
+                lowering->placements[i] = use_counts[i] > 0 ? PLACEMENT_SLOT : PLACEMENT_EFFECT;
+                break;
+            default:
+                lowering->placements[i] = use_counts[i] == 0 ? PLACEMENT_NONE
+                    : local_use ? PLACEMENT_SUNK
+                    : PLACEMENT_SLOT;
+                break;
+        }
+    }
+
+    // Calls are considered from the end of each block so that whether their user stays in place is already known.
+    for (size_t i = 0; i < function->block_count; i++) {
+        const struct sk_ir_block *block = &function->blocks[i];
+        for (size_t j = block->instruction_count; j > 0; j--) {
+            const size_t call = block->instructions[j - 1];
+            const enum sk_ir_opcode opcode = function->instructions[call].opcode;
+            if ((opcode != SK_IR_CALL && opcode != SK_IR_CALL_DIRECT) || use_counts[call] != 1) {
+                continue;
+            }
+
+            const size_t user = users[call];
+            size_t end;
+            if (user == count) {
+                end = block->instruction_count;
+            } else if (function->instructions[user].block == i && function->instructions[user].opcode != SK_IR_PHI &&
+                lowering->placements[user] != PLACEMENT_SUNK) {
+                end = positions[user];
+            } else {
+                continue;
+            }
+
+            bool adjacent = true;
+            for (size_t k = j; k < end && adjacent; k++) {
+                const size_t between = block->instructions[k];
+                adjacent = !sk_ir_has_side_effects(function->instructions[between].opcode) &&
+                    lowering->placements[between] != PLACEMENT_SLOT;
+            }
+
+            if (adjacent) {
+                lowering->placements[call] = PLACEMENT_SUNK;
+            }
+        }
+    }
+
+    sk_free(positions);
+    sk_free(users);
+    sk_free(use_counts);
+}
+
+// Whether `value` is an operand of `phi` for the edge from its own block. Such a value is computed on that edge, with
+// the other phi operands.
+static bool is_edge_operand(const struct sk_ir_function *function, const size_t value, const size_t phi)
+{
+    const struct sk_ir_instruction *instruction = &function->instructions[phi];
+    if (instruction->opcode != SK_IR_PHI) {
+        return false;
+    }
+
+    const struct sk_ir_block *block = &function->blocks[instruction->block];
+    for (size_t i = 0; i < instruction->operand_count; i++) {
+        if (instruction->operands[i] == value && block->predecessors[i] == function->instructions[value].block) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Compare-and-branch instructions only have one-byte slot operands.
+static bool is_number_slot(const struct lowering *lowering, const size_t value)
+{
+    return lowering->placements[value] == PLACEMENT_SLOT && lowering->slots[value] <= UINT8_MAX &&
+        lowering->function->instructions[value].type == SK_TYPE_NUMBER;
+}
+
+static void lowering_error(struct lowering *lowering, const char *message)
+{
+    if (!lowering->has_error) {
+        fprintf(stderr, "%s\n", message);
+    }
+
+    lowering->has_error = true;
+}
+
+static void emit_with_operand(
+    struct lowering *lowering,
+    const uint8_t opcode,
+    const size_t operand,
+    const char *overflow_message)
+{
+    if (!sk_chunk_add_with_operand(lowering->chunk, opcode, operand)) {
+        lowering_error(lowering, overflow_message);
+    }
+}
+
+static void emit_jump_to(struct lowering *lowering, const size_t block)
+{
+    const size_t target = lowering->block_offsets[block];
+    if (target == SK_IR_NONE) {
+        const size_t position = emit_forward_jump(lowering, SK_OP_JMP);
+        if (lowering->patch_count >= lowering->patch_capacity) {
+            lowering->patch_capacity = sk_grow(lowering->patch_capacity);
+            lowering->patches = sk_realloc(lowering->patches, lowering->patch_capacity);
+        }
+
+        lowering->patches[lowering->patch_count++] = (struct jump_patch) {position, block};
+        return;
+    }
+
+    const size_t offset = lowering->chunk->count + 3 - target;
+    if (offset > UINT16_MAX) {
+        lowering_error(lowering, "Too long jump.");
+        return;
+    }
+
+    sk_chunk_add(lowering->chunk, SK_OP_JMP_BACK);
+    sk_chunk_add(lowering->chunk, (offset >> 8) & 0xFF);
+    sk_chunk_add(lowering->chunk, offset & 0xFF);
+}
+
+static size_t emit_forward_jump(struct lowering *lowering, const uint8_t opcode)
+{
+    sk_chunk_add(lowering->chunk, opcode);
+    sk_chunk_add(lowering->chunk, 0xFF);
+    sk_chunk_add(lowering->chunk, 0xFF);
+    return lowering->chunk->count - 2;
+}
+
+static void patch_forward_jump(struct lowering *lowering, const size_t position, const size_t target)
+{
+    const size_t offset = target - position - 2;
+    if (offset > UINT16_MAX) {
+        lowering_error(lowering, "Too long jump.");
+        return;
+    }
+
+    lowering->chunk->code[position] = (offset >> 8) & 0xFF;
+    lowering->chunk->code[position + 1] = offset & 0xFF;
+}
+
+// Emits a single compare-and-branch instruction for a comparison sunk into a branch, when it compares a Number slot
+// with another one or with a number constant, like the stack compiler does for `if` and `while` tests. The jump is
+// taken when the comparison equals `jump_if`; its offset is left to patch_forward_jump.
+static bool emit_compare_jump(struct lowering *lowering, const size_t value, const bool jump_if, size_t *position)
+{
+    // The LOCALS instructions that jump when each comparison holds and when it does not. `<=` and `>=` are the
+    // negated strict comparisons.
+    static const uint8_t jumps[][2] = {
+        [SK_IR_NLESS] = {SK_OP_JMP_IF_NOT_LESS_LOCALS, SK_OP_JMP_IF_LESS_LOCALS},
+        [SK_IR_NLESS_EQUAL] = {SK_OP_JMP_IF_GREATER_LOCALS, SK_OP_JMP_IF_NOT_GREATER_LOCALS},
+        [SK_IR_NGREATER] = {SK_OP_JMP_IF_NOT_GREATER_LOCALS, SK_OP_JMP_IF_GREATER_LOCALS},
+        [SK_IR_NGREATER_EQUAL] = {SK_OP_JMP_IF_LESS_LOCALS, SK_OP_JMP_IF_NOT_LESS_LOCALS},
+        [SK_IR_NEQUAL] = {SK_OP_JMP_IF_NOT_EQUAL_LOCALS, SK_OP_JMP_IF_EQUAL_LOCALS},
+        [SK_IR_NNOT_EQUAL] = {SK_OP_JMP_IF_EQUAL_LOCALS, SK_OP_JMP_IF_NOT_EQUAL_LOCALS},
+    };
+    static const enum sk_ir_opcode mirrored[] = {
+        [SK_IR_NLESS] = SK_IR_NGREATER,
+        [SK_IR_NLESS_EQUAL] = SK_IR_NGREATER_EQUAL,
+        [SK_IR_NGREATER] = SK_IR_NLESS,
+        [SK_IR_NGREATER_EQUAL] = SK_IR_NLESS_EQUAL,
+        [SK_IR_NEQUAL] = SK_IR_NEQUAL,
+        [SK_IR_NNOT_EQUAL] = SK_IR_NNOT_EQUAL,
+    };
+
+    const struct sk_ir_instruction *instruction = &lowering->function->instructions[value];
+    if (lowering->placements[value] != PLACEMENT_SUNK || instruction->opcode < SK_IR_NLESS ||
+        instruction->opcode > SK_IR_NNOT_EQUAL) {
+        return false;
+    }
+
+    enum sk_ir_opcode opcode = instruction->opcode;
+    size_t left = instruction->operands[0];
+    size_t right = instruction->operands[1];
+
+    // `1 < x` is tested as `x > 1`.
+    if (!is_number_slot(lowering, left) && is_number_slot(lowering, right)) {
+        left = instruction->operands[1];
+        right = instruction->operands[0];
+        opcode = mirrored[opcode];
+    }
+
+    if (!is_number_slot(lowering, left)) {
+        return false;
+    }
+
+    const struct sk_ir_instruction *constant = &lowering->function->instructions[right];
+    uint8_t jump = jumps[opcode][jump_if ? 1 : 0];
+    uint8_t operand;
+    if (is_number_slot(lowering, right)) {
+        operand = (uint8_t)lowering->slots[right];
+    } else if (constant->opcode == SK_IR_CONST && sk_is_number(constant->constant)) {
+        // Look the constant up first so that a test that cannot use the one-byte form adds nothing to the pool.
+        struct sk_constant_table *constants = &lowering->program->constants;
+        size_t index;
+        if (!sk_constant_table_find(constants, constant->constant, &index)) {
+            if (constants->values.count > UINT8_MAX) {
+                return false;
+            }
+
+            index = sk_constant_table_add(constants, constant->constant);
+        }
+
+        if (index > UINT8_MAX) {
+            return false;
+        }
+
+        // The LOCAL_CONST forms are declared in the same order as the LOCALS forms.
+        jump += SK_OP_JMP_IF_LESS_LOCAL_CONST - SK_OP_JMP_IF_LESS_LOCALS;
+        operand = (uint8_t)index;
+    } else {
+        return false;
+    }
+
+    sk_chunk_add(lowering->chunk, jump);
+    sk_chunk_add(lowering->chunk, (uint8_t)lowering->slots[left]);
+    sk_chunk_add(lowering->chunk, operand);
+    sk_chunk_add(lowering->chunk, 0xFF);
+    sk_chunk_add(lowering->chunk, 0xFF);
+    *position = lowering->chunk->count - 2;
+    return true;
+}
+
+// Pushes a value that has already been computed, or computes it now if it was sunk into this use.
+static void emit_value(struct lowering *lowering, const size_t value)
+{
+    const struct sk_ir_instruction *instruction = &lowering->function->instructions[value];
+    switch (lowering->placements[value]) {
+        case PLACEMENT_REMATERIALIZED:
+            if (instruction->opcode == SK_IR_STRING) {
+                const size_t index = sk_constant_table_add_string(
+                    &lowering->program->constants,
+                    &lowering->program->heap,
+                    instruction->chars,
+                    instruction->length);
+                emit_with_operand(lowering, SK_OP_CONST, index, "Too many constants.");
+            } else if (instruction->constant.bits == SK_VALUE_NOTHING) {
+                sk_chunk_add(lowering->chunk, SK_OP_NOTHING);
+            } else if (instruction->constant.bits == SK_VALUE_TRUE) {
+                sk_chunk_add(lowering->chunk, SK_OP_TRUE);
+            } else if (instruction->constant.bits == SK_VALUE_FALSE) {
+                sk_chunk_add(lowering->chunk, SK_OP_FALSE);
+            } else {
+                const size_t index = sk_constant_table_add(&lowering->program->constants, instruction->constant);
+                emit_with_operand(lowering, SK_OP_CONST, index, "Too many constants.");
+            }
+            break;
+        case PLACEMENT_SUNK:
+            emit_operation(lowering, value, false);
+            break;
+        default:
+            emit_with_operand(lowering, SK_OP_LOAD_LOCAL, lowering->slots[value], "Too many local variables.");
+            break;
+    }
+}
+
+// Pushes the operands of an instruction and emits it. `tail` turns a call into a tail call.
+static void emit_operation(struct lowering *lowering, const size_t value, const bool tail)
+{
+    static const uint8_t opcodes[] = {
+        [SK_IR_NNEG] = SK_OP_NNEG,
+        [SK_IR_NADD] = SK_OP_NADD,
+        [SK_IR_NSUB] = SK_OP_NSUB,
+        [SK_IR_NMUL] = SK_OP_NMUL,
+        [SK_IR_NDIV] = SK_OP_NDIV,
+        [SK_IR_CONCAT] = SK_OP_CONCAT,
+        [SK_IR_NLESS] = SK_OP_NLESS,
+        [SK_IR_NLESS_EQUAL] = SK_OP_NLESS_EQUAL,
+        [SK_IR_NGREATER] = SK_OP_NGREATER,
+        [SK_IR_NGREATER_EQUAL] = SK_OP_NGREATER_EQUAL,
+        [SK_IR_NEQUAL] = SK_OP_NEQUAL,
+        [SK_IR_NNOT_EQUAL] = SK_OP_NNOT_EQUAL,
+        [SK_IR_EQUAL] = SK_OP_EQUAL,
+        [SK_IR_NOT_EQUAL] = SK_OP_NOT_EQUAL,
+        [SK_IR_NOT] = SK_OP_NOT,
+    };
+
+    const struct sk_ir_instruction *instruction = &lowering->function->instructions[value];
+    const size_t count = instruction->operand_count;
+
+    // Direct calls need a function number and an argument count that fit their operands.
+    const bool direct = instruction->opcode == SK_IR_CALL_DIRECT && instruction->index <= UINT16_MAX &&
+        count <= UINT8_MAX;
+    if (instruction->opcode == SK_IR_CALL_DIRECT && !direct) {
+        const size_t index = sk_constant_table_add(&lowering->program->constants, sk_fnptr_value(instruction->index));
+        emit_with_operand(lowering, SK_OP_CONST, index, "Too many constants.");
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        emit_value(lowering, instruction->operands[i]);
+    }
+
+    switch (instruction->opcode) {
+        case SK_IR_CALL:
+            emit_with_operand(lowering, tail ? SK_OP_TAIL_CALL : SK_OP_CALL, count - 1, "Too many arguments.");
+            break;
+        case SK_IR_CALL_DIRECT:
+            if (!direct) {
+                emit_with_operand(lowering, tail ? SK_OP_TAIL_CALL : SK_OP_CALL, count, "Too many arguments.");
+                break;
+            }
+
+            sk_chunk_add(lowering->chunk, tail ? SK_OP_TAIL_CALL_DIRECT : SK_OP_CALL_DIRECT);
+            sk_chunk_add(lowering->chunk, (instruction->index >> 8) & 0xFF);
+            sk_chunk_add(lowering->chunk, instruction->index & 0xFF);
+            sk_chunk_add(lowering->chunk, (uint8_t)count);
+            break;
+        case SK_IR_PRINT:
+            if (count - 1 > UINT8_MAX) {
+                lowering_error(lowering, "Too many print arguments.");
+                break;
+            }
+
+            sk_chunk_add(lowering->chunk, SK_OP_PRINT);
+            sk_chunk_add(lowering->chunk, (uint8_t)(count - 1));
+            sk_chunk_add(lowering->chunk, (SK_PRINT_CACHE_NONE >> 8) & 0xFF);
+            sk_chunk_add(lowering->chunk, SK_PRINT_CACHE_NONE & 0xFF);
+            break;
+        default:
+            sk_chunk_add(lowering->chunk, opcodes[instruction->opcode]);
+            break;
+    }
+}
+
+static void emit_block(struct lowering *lowering, const size_t block, const size_t next_block)
+{
+    const struct sk_ir_block *ir_block = &lowering->function->blocks[block];
+    for (size_t i = 0; i < ir_block->instruction_count; i++) {
+        const size_t value = ir_block->instructions[i];
+        if (lowering->function->instructions[value].opcode == SK_IR_PHI ||
+            lowering->function->instructions[value].opcode == SK_IR_PARAMETER) {
+            continue;
+        }
+
+        switch (lowering->placements[value]) {
+            case PLACEMENT_SLOT:
+                emit_operation(lowering, value, false);
+                emit_with_operand(lowering, SK_OP_STORE_LOCAL, lowering->slots[value], "Too many local variables.");
+                break;
+            case PLACEMENT_EFFECT:
+                emit_operation(lowering, value, false);
+                if (lowering->function->instructions[value].opcode != SK_IR_PRINT) {
+                    sk_chunk_add(lowering->chunk, SK_OP_POP);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    const struct sk_ir_terminator *terminator = &ir_block->terminator;
+    switch (terminator->kind) {
+        case SK_IR_RETURN: {
+            const struct sk_ir_instruction *value = &lowering->function->instructions[terminator->value];
+            if (lowering->placements[terminator->value] == PLACEMENT_SUNK &&
+                (value->opcode == SK_IR_CALL || value->opcode == SK_IR_CALL_DIRECT)) {
+                emit_operation(lowering, terminator->value, true);
+                break;
+            }
+
+            emit_value(lowering, terminator->value);
+            sk_chunk_add(lowering->chunk, SK_OP_RETURN);
+            break;
+        }
+        case SK_IR_JUMP:
+            emit_edge(lowering, block, terminator->targets[0], false);
+            if (terminator->targets[0] != next_block) {
+                emit_jump_to(lowering, terminator->targets[0]);
+            }
+            break;
+        case SK_IR_BRANCH: {
+            // The edge to the block laid out next comes last so that it can fall through. JMP_TRUE and JMP_FALSE
+            // leave the condition on the stack, so both edges start with a POP.
+            const bool then_next = terminator->targets[0] == next_block;
+            const size_t first = terminator->targets[then_next ? 1 : 0];
+            const size_t second = terminator->targets[then_next ? 0 : 1];
+
+            // A compare-and-branch instruction leaves nothing on the stack.
+            size_t compare_jump;
+            if (emit_compare_jump(lowering, terminator->value, then_next, &compare_jump)) {
+                emit_edge(lowering, block, first, !then_next);
+                emit_jump_to(lowering, first);
+                patch_forward_jump(lowering, compare_jump, lowering->chunk->count);
+                emit_edge(lowering, block, second, then_next);
+                if (second != next_block) {
+                    emit_jump_to(lowering, second);
+                }
+                break;
+            }
+
+            emit_value(lowering, terminator->value);
+            const size_t second_jump = emit_forward_jump(lowering, then_next ? SK_OP_JMP_TRUE : SK_OP_JMP_FALSE);
+            sk_chunk_add(lowering->chunk, SK_OP_POP);
+            emit_edge(lowering, block, first, !then_next);
+            emit_jump_to(lowering, first);
+
+            patch_forward_jump(lowering, second_jump, lowering->chunk->count);
+            sk_chunk_add(lowering->chunk, SK_OP_POP);
+            emit_edge(lowering, block, second, then_next);
+            if (second != next_block) {
+                emit_jump_to(lowering, second);
+            }
+            break;
+        }
+        case SK_IR_TERMINATOR_NONE:
+            break;
+    }
+}
+
+// Assigns the phis of `to` their operands for the edge from `from`, as one parallel copy: all operands are pushed
+// before any phi is stored, so phis that read each other see the values from before the edge. `last_edge` picks the
+// later of two edges between the same blocks, which only a branch with equal targets has.
+static void emit_edge(struct lowering *lowering, const size_t from, const size_t to, const bool last_edge)
+{
+    const struct sk_ir_function *function = lowering->function;
+    const struct sk_ir_block *block = &function->blocks[to];
+
+    size_t edge = SK_IR_NONE;
+    for (size_t i = 0; i < block->predecessor_count; i++) {
+        if (block->predecessors[i] == from && (edge == SK_IR_NONE || last_edge)) {
+            edge = i;
+        }
+    }
+
+    size_t copy_count = 0;
+    for (size_t i = 0; i < block->instruction_count; i++) {
+        const size_t phi = block->instructions[i];
+        if (function->instructions[phi].opcode != SK_IR_PHI) {
+            break;
+        }
+
+        if (lowering->placements[phi] == PLACEMENT_SLOT && function->instructions[phi].operands[edge] != phi) {
+            emit_value(lowering, function->instructions[phi].operands[edge]);
+            copy_count++;
+        }
+    }
+
+    for (size_t i = block->instruction_count; i > 0 && copy_count > 0; i--) {
+        const size_t phi = block->instructions[i - 1];
+        if (function->instructions[phi].opcode != SK_IR_PHI || lowering->placements[phi] != PLACEMENT_SLOT ||
+            function->instructions[phi].operands[edge] == phi) {
+            continue;
+        }
+
+        emit_with_operand(lowering, SK_OP_STORE_LOCAL, lowering->slots[phi], "Too many local variables.");
+        copy_count--;
+    }
+}
+
+void sk_ir_print(const struct sk_ir_program *program)
+{
+    for (size_t i = 0; i < program->count; i++) {
+        if (i > 0) {
+            printf("\n");
+        }
+
+        print_function(program, &program->functions[i]);
+    }
+}
+
+static void print_function(const struct sk_ir_program *program, const struct sk_ir_function *function)
+{
+    printf("fn %.*s:\n", (int)function->name.length, function->name.start);
+
+    size_t *order = sk_allocs((function->block_count + 1) * sizeof *order);
+    const size_t count = reverse_postorder(function, order);
+    for (size_t i = 0; i < count; i++) {
+        const struct sk_ir_block *block = &function->blocks[order[i]];
+        printf("  b%zu:", order[i]);
+        for (size_t j = 0; j < block->predecessor_count; j++) {
+            printf("%s b%zu", j == 0 ? " <-" : ",", block->predecessors[j]);
+        }
+
+        printf("\n");
+        for (size_t j = 0; j < block->instruction_count; j++) {
+            print_instruction(program, function, block->instructions[j]);
+        }
+
+        const struct sk_ir_terminator *terminator = &block->terminator;
+        switch (terminator->kind) {
+            case SK_IR_JUMP:
+                printf("    jump b%zu\n", terminator->targets[0]);
+                break;
+            case SK_IR_BRANCH:
+                printf(
+                    "    branch v%zu, b%zu, b%zu\n",
+                    terminator->value,
+                    terminator->targets[0],
+                    terminator->targets[1]);
+                break;
+            case SK_IR_RETURN:
+                printf("    return v%zu\n", terminator->value);
+                break;
+            case SK_IR_TERMINATOR_NONE:
+                break;
+        }
+    }
+
+    sk_free(order);
+}
+
+static void print_instruction(
+    const struct sk_ir_program *program,
+    const struct sk_ir_function *function,
+    const size_t value)
+{
+    static const char *const names[] = {
+        [SK_IR_CONST] = "const",
+        [SK_IR_STRING] = "const",
+        [SK_IR_PARAMETER] = "parameter",
+        [SK_IR_PHI] = "phi",
+        [SK_IR_NNEG] = "nneg",
+        [SK_IR_NADD] = "nadd",
+        [SK_IR_NSUB] = "nsub",
+        [SK_IR_NMUL] = "nmul",
+        [SK_IR_NDIV] = "ndiv",
+        [SK_IR_CONCAT] = "concat",
+        [SK_IR_NLESS] = "nless",
+        [SK_IR_NLESS_EQUAL] = "nless_equal",
+        [SK_IR_NGREATER] = "ngreater",
+        [SK_IR_NGREATER_EQUAL] = "ngreater_equal",
+        [SK_IR_NEQUAL] = "nequal",
+        [SK_IR_NNOT_EQUAL] = "nnot_equal",
+        [SK_IR_EQUAL] = "equal",
+        [SK_IR_NOT_EQUAL] = "not_equal",
+        [SK_IR_NOT] = "not",
+        [SK_IR_CALL] = "call",
+        [SK_IR_CALL_DIRECT] = "call",
+        [SK_IR_PRINT] = "print",
+    };
+
+    const struct sk_ir_instruction *instruction = &function->instructions[value];
+    const struct sk_ir_block *block = &function->blocks[instruction->block];
+
+    printf("    ");
+    if (instruction->opcode != SK_IR_PRINT) {
+        printf("v%zu: %s = ", value, type_name(instruction->type));
+    }
+
+    printf("%s", names[instruction->opcode]);
+    switch (instruction->opcode) {
+        case SK_IR_CONST: {
+            const struct sk_value constant = instruction->constant;
+            if (sk_is_number(constant)) {
+                printf(" %g", sk_as_number(constant));
+            } else if (sk_is_boolean(constant)) {
+                printf(" %s", sk_as_boolean(constant) ? "true" : "false");
+            } else if (sk_is_fnptr(constant)) {
+                printf(" ");
+                print_function_name(program, sk_as_fnptr(constant));
+            } else {
+                printf(" nothing");
+            }
+            break;
+        }
+        case SK_IR_STRING:
+            printf(" \"%.*s\"", (int)instruction->length, instruction->chars);
+            break;
+        case SK_IR_PARAMETER:
+            printf(" %zu", instruction->index);
+            break;
+        case SK_IR_CALL_DIRECT:
+            printf(" ");
+            print_function_name(program, instruction->index);
+            break;
+        default:
+            break;
+    }
+
+    for (size_t i = 0; i < instruction->operand_count; i++) {
+        const bool separate = i > 0 || instruction->opcode == SK_IR_CALL_DIRECT;
+        printf("%s v%zu", separate ? "," : "", instruction->operands[i]);
+        if (instruction->opcode == SK_IR_PHI) {
+            printf(" (b%zu)", block->predecessors[i]);
+        }
+    }
+
+    printf("\n");
+}
+
+static void print_function_name(const struct sk_ir_program *program, const sk_fnptr fnptr)
+{
+    for (size_t i = 0; i < program->count; i++) {
+        if (program->functions[i].fnptr == fnptr) {
+            printf("@%.*s", (int)program->functions[i].name.length, program->functions[i].name.start);
+            return;
+        }
+    }
+
+    printf("@%zu", fnptr);
+}
+
+static const char *type_name(const enum sk_type_kind type)
+{
+    switch (type) {
+        case SK_TYPE_NOTHING:
+            return "Nothing";
+        case SK_TYPE_NUMBER:
+            return "Number";
+        case SK_TYPE_BOOLEAN:
+            return "Boolean";
+        case SK_TYPE_STRING:
+            return "String";
+        case SK_TYPE_FUNCTION:
+            return "Function";
+        default:
+            return "Unknown";
+    }
+}
@@ -0,0 +1,157 @@
+#ifndef SKARD_SK_IR_H
+#define SKARD_SK_IR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "sk_ast.h"
+#include "sk_type.h"
+#include "sk_vm.h"
+
+// SSA form of a checked AST. Every function is a graph of basic blocks; every instruction defines at most one value,
+// named by its index in the function's instruction array, and every value is defined exactly once. Locals become
+// values when they are read: the checker's slots are the variables of the construction, and joins of different
+// definitions become phi instructions. Removed instructions and blocks keep their index and are only flagged.
+
+#define SK_IR_NONE ((size_t)-1)
+
+enum sk_ir_opcode {
+    // `constant` holds the value; strings are SK_IR_STRING.
+    SK_IR_CONST,
+    // `chars`/`length` hold the contents of a string literal.
+    SK_IR_STRING,
+    // `index` is the parameter's position.
+    SK_IR_PARAMETER,
+    // One operand per predecessor of the block, in the order of its `predecessors`.
+    SK_IR_PHI,
+
+    SK_IR_NNEG,
+    SK_IR_NADD,
+    SK_IR_NSUB,
+    SK_IR_NMUL,
+    SK_IR_NDIV,
+    SK_IR_CONCAT,
+
+    // Same semantics as the stack VM instructions of the same name.
+    SK_IR_NLESS,
+    SK_IR_NLESS_EQUAL,
+    SK_IR_NGREATER,
+    SK_IR_NGREATER_EQUAL,
+    SK_IR_NEQUAL,
+    SK_IR_NNOT_EQUAL,
+    SK_IR_EQUAL,
+    SK_IR_NOT_EQUAL,
+    SK_IR_NOT,
+
+    // The callee followed by the arguments.
+    SK_IR_CALL,
+    // Calls the function `index` with the operands as arguments.
+    SK_IR_CALL_DIRECT,
+    // The values in the order the stack VM pops them last: the last argument first and the template last.
+    SK_IR_PRINT,
+};
+
+struct sk_ir_instruction {
+    enum sk_ir_opcode opcode;
+    enum sk_type_kind type;
+    size_t block;
+    bool removed;
+    size_t *operands;
+    size_t operand_count;
+    size_t operand_capacity;
+
+    struct sk_value constant;
+    const char *chars;
+    size_t length;
+    size_t index;
+};
+
+enum sk_ir_terminator_kind {
+    // Only the block that is still being built has no terminator.
+    SK_IR_TERMINATOR_NONE,
+    SK_IR_JUMP,
+    // Goes to targets[0] when `value` is true and to targets[1] otherwise.
+    SK_IR_BRANCH,
+    SK_IR_RETURN,
+};
+
+struct sk_ir_terminator {
+    enum sk_ir_terminator_kind kind;
+    size_t value;
+    size_t targets[2];
+};
+
+struct sk_ir_block {
+    // Phis come first.
+    size_t *instructions;
+    size_t instruction_count;
+    size_t instruction_capacity;
+    // One entry per incoming edge.
+    size_t *predecessors;
+    size_t predecessor_count;
+    size_t predecessor_capacity;
+    struct sk_ir_terminator terminator;
+    bool removed;
+};
+
+struct sk_ir_function {
+    struct sk_token name;
+    sk_fnptr fnptr;
+    size_t parameter_count;
+    // Block 0 is the entry.
+    struct sk_ir_block *blocks;
+    size_t block_count;
+    size_t block_capacity;
+    struct sk_ir_instruction *instructions;
+    size_t instruction_count;
+    size_t instruction_capacity;
+};
+
+struct sk_ir_program {
+    struct sk_ir_function *functions;
+    size_t capacity;
+    size_t count;
+};
+
+void sk_ir_program_init(struct sk_ir_program *program);
+void sk_ir_program_free(struct sk_ir_program *program);
+
+// Builds the SSA form of a program that has passed the checker, after folding and inlining if they are enabled.
+void sk_ir_build(struct sk_ir_program *program, const struct sk_ast_node *node);
+
+// Whether an instruction does more than compute its value, so that it must stay where it is even when unused.
+bool sk_ir_has_side_effects(enum sk_ir_opcode opcode);
+
+// A pass rewrites one function in place and returns whether it changed anything.
+struct sk_ir_pass {
+    const char *name;
+    bool (*run)(struct sk_ir_function *function);
+};
+
+// Folds branches on constants and removes the blocks that become unreachable.
+bool sk_ir_simplify_cfg(struct sk_ir_function *function);
+// Replaces phis whose operands are all the same value, or the phi itself, by that value.
+bool sk_ir_remove_trivial_phis(struct sk_ir_function *function);
+// Moves instructions without side effects whose operands do not change inside a loop to the block before the loop.
+bool sk_ir_hoist_loop_invariants(struct sk_ir_function *function);
+// Turns multiplications of a loop counter by a constant into a counter that steps by the product instead.
+bool sk_ir_reduce_strength(struct sk_ir_function *function);
+// Removes instructions without side effects whose values are never used.
+bool sk_ir_eliminate_dead_code(struct sk_ir_function *function);
+
+extern const struct sk_ir_pass sk_ir_default_passes[];
+extern const size_t sk_ir_default_pass_count;
+
+// Runs the passes in order over every function, and the whole sequence again while any of them changes something, up
+// to SK_IR_MAX_PASS_ROUNDS times.
+#define SK_IR_MAX_PASS_ROUNDS 8
+void sk_ir_run_passes(struct sk_ir_program *program, const struct sk_ir_pass *passes, size_t count);
+
+// Lowers the functions to stack bytecode in `bytecode`, which is initialized here. Every value that outlives the
+// instruction using it gets a local slot; the rest is computed on the operand stack where it is used. Phis are
+// assigned on each incoming edge. Returns false, after reporting, when a function exceeds the bytecode limits.
+bool sk_ir_lower(const struct sk_ir_program *program, struct sk_program *bytecode);
+
+void sk_ir_print(const struct sk_ir_program *program);
+
+#endif // SKARD_SK_IR_H
@@ -0,0 +1,629 @@
+// mmap's MAP_ANONYMOUS is not part of C99.
+#define _DEFAULT_SOURCE
+
+#include "sk_jit.h"
+
+#include <string.h>
+
+#include "sk_memory.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define SK_JIT_AVAILABLE 1
+#include <sys/mman.h>
+#else
+#define SK_JIT_AVAILABLE 0
+#endif
+
+struct sk_jit_function {
+    // NULL until the function has been compiled.
+    uint8_t *code;
+    size_t code_size;
+    // Offset of each instruction's native code, indexed by bytecode offset. Zero where no instruction starts and for
+    // the instructions that are left to the interpreter.
+    uint32_t *entries;
+};
+
+#if SK_JIT_AVAILABLE
+
+// Native code is called with the frame's slots in rdi, the address of the stack pointer in rsi and the native address
+// to start at in rdx. It keeps the stack pointer in r8 and returns the instruction the interpreter continues with.
+typedef uint8_t *(*native_code)(struct sk_value *slots, struct sk_value **sp, const uint8_t *entry);
+
+struct code_buffer {
+    uint8_t *bytes;
+    size_t capacity;
+    size_t count;
+};
+
+// A rel32 operand at `position` that must reach the native code of the instruction at bytecode offset `target`.
+struct jump_patch {
+    size_t position;
+    size_t target;
+};
+
+struct jump_patches {
+    struct jump_patch *patches;
+    size_t capacity;
+    size_t count;
+};
+
+static void compile_function(
+    const struct sk_jit *jit,
+    const struct sk_compiled_function *function,
+    size_t *back_edges,
+    struct sk_jit_function *state);
+static bool compile_instruction(
+    struct code_buffer *buffer,
+    struct jump_patches *patches,
+    const struct sk_program *program,
+    size_t *back_edges,
+    const struct sk_chunk *chunk,
+    size_t offset);
+static bool patch_jumps(struct code_buffer *buffer, const struct jump_patches *patches, const uint32_t *targets);
+static uint8_t *install_code(const struct code_buffer *buffer);
+
+static void emit_bytes(struct code_buffer *buffer, const uint8_t *bytes, size_t count);
+static void emit_u32(struct code_buffer *buffer, uint32_t value);
+static void emit_u64(struct code_buffer *buffer, uint64_t value);
+static void emit_push_rax(struct code_buffer *buffer);
+static void emit_push_immediate(struct code_buffer *buffer, uint64_t bits);
+static void emit_slot(struct code_buffer *buffer, uint8_t opcode, uint8_t modrm, size_t slot);
+static void emit_number_operation(struct code_buffer *buffer, uint8_t operation);
+static void emit_number_comparison(
+    struct code_buffer *buffer,
+    uint8_t operands,
+    uint8_t setcc,
+    uint8_t other_setcc,
+    uint8_t combine);
+static void emit_boolean_result(struct code_buffer *buffer);
+static void emit_jump(struct code_buffer *buffer, struct jump_patches *patches, uint8_t opcode, size_t target);
+static void emit_long_jump(struct code_buffer *buffer, struct jump_patches *patches, uint8_t condition, size_t target);
+static void emit_compare_jump(
+    struct code_buffer *buffer,
+    struct jump_patches *patches,
+    const struct sk_program *program,
+    const uint8_t *instruction,
+    size_t target);
+static void emit_back_edge(
+    struct code_buffer *buffer,
+    struct jump_patches *patches,
+    const struct sk_program *program,
+    size_t *back_edges,
+    const uint8_t *instruction,
+    size_t target);
+static void emit_exit(struct code_buffer *buffer, const uint8_t *ip);
+
+#define emit_code(buffer, ...) \
+    emit_bytes((buffer), (const uint8_t[]) {__VA_ARGS__}, sizeof((const uint8_t[]) {__VA_ARGS__}))
+
+// Condition codes of the Jcc rel32 (0x0F 0x80+cc) and SETcc (0x0F 0x90+cc) instructions.
+#define CC_PARITY 0xA
+#define CC_NO_PARITY 0xB
+#define CC_EQUAL 0x4
+#define CC_NOT_EQUAL 0x5
+#define CC_BELOW_OR_EQUAL 0x6
+#define CC_ABOVE 0x7
+
+// ModRM bytes of `ucomisd xmm0, xmm1` and `ucomisd xmm1, xmm0`. Unordered operands set ZF, PF and CF, so comparing in
+// the order that turns the test into "above" makes it false for NaN, and "below or equal" true.
+#define UCOMISD_A_B 0xC1
+#define UCOMISD_B_A 0xC8
+
+#endif
+
+bool sk_jit_supported(void)
+{
+    return SK_JIT_AVAILABLE;
+}
+
+static bool tier_promote(void *data, const struct sk_compiled_function *function, struct sk_vm_profile *profile);
+static uint8_t *tier_enter(
+    void *data,
+    const struct sk_compiled_function *function,
+    uint8_t *ip,
+    struct sk_value *slots,
+    struct sk_value **sp);
+
+void sk_jit_init(struct sk_jit *jit, const struct sk_program *program)
+{
+    jit->program = program;
+    jit->functions = sk_allocs(program->functions.count * sizeof *jit->functions);
+    for (size_t i = 0; i < program->functions.count; i++) {
+        jit->functions[i] = (struct sk_jit_function) {
+            .code = NULL,
+            .code_size = 0,
+            .entries = NULL,
+        };
+    }
+}
+
+void sk_jit_free(struct sk_jit *jit)
+{
+    for (size_t i = 0; i < jit->program->functions.count; i++) {
+        struct sk_jit_function *function = &jit->functions[i];
+#if SK_JIT_AVAILABLE
+        if (function->code != NULL) {
+            munmap(function->code, function->code_size);
+        }
+#endif
+        sk_free(function->entries);
+    }
+
+    sk_free(jit->functions);
+    jit->functions = NULL;
+}
+
+struct sk_vm_tier sk_jit_tier(struct sk_jit *jit, const size_t threshold)
+{
+    return (struct sk_vm_tier) {
+        .data = jit,
+        .threshold = threshold,
+        .promote = tier_promote,
+        .enter = tier_enter,
+    };
+}
+
+bool sk_jit_compile(struct sk_jit *jit, const struct sk_compiled_function *function, size_t *back_edges)
+{
+    struct sk_jit_function *state = &jit->functions[function - jit->program->functions.functions];
+#if SK_JIT_AVAILABLE
+    if (state->code == NULL) {
+        compile_function(jit, function, back_edges, state);
+    }
+#else
+    (void)back_edges;
+#endif
+
+    return state->code != NULL;
+}
+
+uint8_t *sk_jit_enter(
+    const struct sk_jit *jit,
+    const struct sk_compiled_function *function,
+    const uint8_t *ip,
+    struct sk_value *slots,
+    struct sk_value **sp)
+{
+    const struct sk_jit_function *state = &jit->functions[function - jit->program->functions.functions];
+    if (state->code == NULL) {
+        return NULL;
+    }
+
+    const uint32_t entry = state->entries[ip - function->chunk.code];
+    if (entry == 0) {
+        return NULL;
+    }
+
+#if SK_JIT_AVAILABLE
+    native_code native;
+    memcpy(&native, &state->code, sizeof native);
+    return native(slots, sp, state->code + entry);
+#else
+    (void)slots;
+    (void)sp;
+    return NULL;
+#endif
+}
+
+static bool tier_promote(void *data, const struct sk_compiled_function *function, struct sk_vm_profile *profile)
+{
+    return sk_jit_compile(data, function, &profile->back_edges);
+}
+
+static uint8_t *tier_enter(
+    void *data,
+    const struct sk_compiled_function *function,
+    uint8_t *ip,
+    struct sk_value *slots,
+    struct sk_value **sp)
+{
+    return sk_jit_enter(data, function, ip, slots, sp);
+}
+
+#if SK_JIT_AVAILABLE
+
+static void compile_function(
+    const struct sk_jit *jit,
+    const struct sk_compiled_function *function,
+    size_t *back_edges,
+    struct sk_jit_function *state)
+{
+    const struct sk_chunk *chunk = &function->chunk;
+    struct code_buffer buffer = {NULL, 0, 0};
+    struct jump_patches patches = {NULL, 0, 0};
+    // Jumps may land on exits as well, so they are resolved against the native code of every instruction.
+    uint32_t *targets = sk_allocs((chunk->count + 1) * sizeof *targets);
+    uint32_t *entries = sk_allocs((chunk->count + 1) * sizeof *entries);
+    memset(targets, 0, (chunk->count + 1) * sizeof *targets);
+    memset(entries, 0, (chunk->count + 1) * sizeof *entries);
+
+    // mov r8, [rsi]; jmp rdx
+    emit_code(&buffer, 0x4C, 0x8B, 0x06, 0xFF, 0xE2);
+
+    for (size_t offset = 0; offset < chunk->count; offset += sk_opcode_length(chunk->code[offset])) {
+        const size_t start = buffer.count;
+        targets[offset] = (uint32_t)start;
+        if (compile_instruction(&buffer, &patches, jit->program, back_edges, chunk, offset)) {
+            entries[offset] = (uint32_t)start;
+        }
+    }
+
+    // Execution never falls off the end of a chunk, but an exit there keeps a bad jump from running into garbage.
+    targets[chunk->count] = (uint32_t)buffer.count;
+    emit_exit(&buffer, chunk->code + chunk->count);
+
+    if (buffer.count <= UINT32_MAX && patch_jumps(&buffer, &patches, targets)) {
+        state->code = install_code(&buffer);
+        state->code_size = buffer.count;
+    }
+
+    if (state->code != NULL) {
+        state->entries = entries;
+    } else {
+        sk_free(entries);
+    }
+
+    sk_free(targets);
+    sk_free(buffer.bytes);
+    sk_free(patches.patches);
+}
+
+// Emits the template of the instruction at `offset`. Instructions without a template become an exit to the
+// interpreter, and false is returned so that native code is never entered at them.
+static bool compile_instruction(
+    struct code_buffer *buffer,
+    struct jump_patches *patches,
+    const struct sk_program *program,
+    size_t *back_edges,
+    const struct sk_chunk *chunk,
+    const size_t offset)
+{
+    const uint8_t *instruction = chunk->code + offset;
+    const size_t length = sk_opcode_length(instruction[0]);
+    const size_t next = offset + length;
+    const size_t jump = length >= 3 ? (size_t)(instruction[length - 2] << 8 | instruction[length - 1]) : 0;
+    const struct sk_value *constants = program->constants.values.array;
+
+    switch (instruction[0]) {
+        case SK_OP_POP:
+            // sub r8, 8
+            emit_code(buffer, 0x49, 0x83, 0xE8, 0x08);
+            return true;
+        case SK_OP_NOTHING:
+            emit_push_immediate(buffer, SK_VALUE_NOTHING);
+            return true;
+        case SK_OP_TRUE:
+            emit_push_immediate(buffer, SK_VALUE_TRUE);
+            return true;
+        case SK_OP_FALSE:
+            emit_push_immediate(buffer, SK_VALUE_FALSE);
+            return true;
+        case SK_OP_CONST:
+            emit_push_immediate(buffer, constants[instruction[1]].bits);
+            return true;
+        case SK_OP_CONST_WIDE:
+            emit_push_immediate(buffer, constants[instruction[1] << 8 | instruction[2]].bits);
+            return true;
+        case SK_OP_LOAD_LOCAL:
+            // mov rax, [rdi + slot * 8]
+            emit_slot(buffer, 0x8B, 0x87, instruction[1]);
+            emit_push_rax(buffer);
+            return true;
+        case SK_OP_LOAD_LOCAL_WIDE:
+            emit_slot(buffer, 0x8B, 0x87, (size_t)(instruction[1] << 8 | instruction[2]));
+            emit_push_rax(buffer);
+            return true;
+        case SK_OP_STORE_LOCAL:
+        case SK_OP_STORE_LOCAL_WIDE: {
+            const size_t slot = length == 2 ? instruction[1] : (size_t)(instruction[1] << 8 | instruction[2]);
+            // sub r8, 8; mov rax, [r8]; mov [rdi + slot * 8], rax
+            emit_code(buffer, 0x49, 0x83, 0xE8, 0x08, 0x49, 0x8B, 0x00);
+            emit_slot(buffer, 0x89, 0x87, slot);
+            return true;
+        }
+        case SK_OP_NNEG:
+            // mov rax, [r8 - 8]; btc rax, 63; mov [r8 - 8], rax
+            emit_code(buffer, 0x49, 0x8B, 0x40, 0xF8, 0x48, 0x0F, 0xBA, 0xF8, 0x3F, 0x49, 0x89, 0x40, 0xF8);
+            return true;
+        case SK_OP_NADD:
+            emit_number_operation(buffer, 0x58);
+            return true;
+        case SK_OP_NSUB:
+            emit_number_operation(buffer, 0x5C);
+            return true;
+        case SK_OP_NMUL:
+            emit_number_operation(buffer, 0x59);
+            return true;
+        case SK_OP_NDIV:
+            emit_number_operation(buffer, 0x5E);
+            return true;
+        case SK_OP_NLESS:
+            emit_number_comparison(buffer, UCOMISD_B_A, CC_ABOVE, 0, 0);
+            return true;
+        case SK_OP_NLESS_EQUAL:
+            emit_number_comparison(buffer, UCOMISD_A_B, CC_BELOW_OR_EQUAL, 0, 0);
+            return true;
+        case SK_OP_NGREATER:
+            emit_number_comparison(buffer, UCOMISD_A_B, CC_ABOVE, 0, 0);
+            return true;
+        case SK_OP_NGREATER_EQUAL:
+            emit_number_comparison(buffer, UCOMISD_B_A, CC_BELOW_OR_EQUAL, 0, 0);
+            return true;
+        case SK_OP_NEQUAL:
+            // and al, cl
+            emit_number_comparison(buffer, UCOMISD_A_B, CC_EQUAL, CC_NO_PARITY, 0x20);
+            return true;
+        case SK_OP_NNOT_EQUAL:
+            // or al, cl
+            emit_number_comparison(buffer, UCOMISD_A_B, CC_NOT_EQUAL, CC_PARITY, 0x08);
+            return true;
+        case SK_OP_EQUAL:
+        case SK_OP_NOT_EQUAL: {
+            const uint8_t setcc = instruction[0] == SK_OP_EQUAL ? CC_EQUAL : CC_NOT_EQUAL;
+            // mov rax, [r8 - 16]; cmp rax, [r8 - 8]; setcc al
+            emit_code(buffer, 0x49, 0x8B, 0x40, 0xF0, 0x49, 0x3B, 0x40, 0xF8, 0x0F, 0x90 + setcc, 0xC0);
+            emit_boolean_result(buffer);
+            return true;
+        }
+        case SK_OP_NOT:
+            // xor qword [r8 - 8], 1
+            emit_code(buffer, 0x49, 0x83, 0x70, 0xF8, 0x01);
+            return true;
+        case SK_OP_JMP:
+            emit_jump(buffer, patches, 0xE9, next + jump);
+            return true;
+        case SK_OP_JMP_BACK:
+            emit_back_edge(buffer, patches, program, back_edges, instruction, next - jump);
+            return true;
+        case SK_OP_JMP_TRUE:
+        case SK_OP_JMP_FALSE:
+            // test byte [r8 - 8], 1
+            emit_code(buffer, 0x41, 0xF6, 0x40, 0xF8, 0x01);
+            emit_long_jump(buffer, patches, instruction[0] == SK_OP_JMP_TRUE ? CC_NOT_EQUAL : CC_EQUAL, next + jump);
+            return true;
+        default:
+            if (sk_opcode_is_compare_jump(instruction[0])) {
+                emit_compare_jump(buffer, patches, program, instruction, next + jump);
+                return true;
+            }
+
+            emit_exit(buffer, instruction);
+            return false;
+    }
+}
+
+static bool patch_jumps(struct code_buffer *buffer, const struct jump_patches *patches, const uint32_t *targets)
+{
+    for (size_t i = 0; i < patches->count; i++) {
+        const struct jump_patch *patch = &patches->patches[i];
+        const uint32_t target = targets[patch->target];
+        if (target == 0) {
+            return false;
+        }
+
+        const int64_t displacement = (int64_t)target - (int64_t)(patch->position + 4);
+        const uint32_t rel32 = (uint32_t)(int32_t)displacement;
+        memcpy(buffer->bytes + patch->position, &rel32, sizeof rel32);
+    }
+
+    return true;
+}
+
+// Copies the code into fresh pages that are made executable only after they have been written.
+static uint8_t *install_code(const struct code_buffer *buffer)
+{
+    void *code = mmap(NULL, buffer->count, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+        return NULL;
+    }
+
+    memcpy(code, buffer->bytes, buffer->count);
+    if (mprotect(code, buffer->count, PROT_READ | PROT_EXEC) != 0) {
+        munmap(code, buffer->count);
+        return NULL;
+    }
+
+    return code;
+}
+
+static void emit_bytes(struct code_buffer *buffer, const uint8_t *bytes, const size_t count)
+{
+    if (buffer->count + count > buffer->capacity) {
+        size_t capacity = buffer->capacity;
+        while (buffer->count + count > capacity) {
+            capacity = sk_grow(capacity);
+        }
+
+        buffer->bytes = sk_realloc(buffer->bytes, capacity);
+        buffer->capacity = capacity;
+    }
+
+    memcpy(buffer->bytes + buffer->count, bytes, count);
+    buffer->count += count;
+}
+
+static void emit_u32(struct code_buffer *buffer, const uint32_t value)
+{
+    emit_code(buffer, value & 0xFF, (value >> 8) & 0xFF, (value >> 16) & 0xFF, (value >> 24) & 0xFF);
+}
+
+static void emit_u64(struct code_buffer *buffer, const uint64_t value)
+{
+    emit_u32(buffer, (uint32_t)value);
+    emit_u32(buffer, (uint32_t)(value >> 32));
+}
+
+static void emit_push_rax(struct code_buffer *buffer)
+{
+    // mov [r8], rax; add r8, 8
+    emit_code(buffer, 0x49, 0x89, 0x00, 0x49, 0x83, 0xC0, 0x08);
+}
+
+static void emit_push_immediate(struct code_buffer *buffer, const uint64_t bits)
+{
+    // mov rax, imm64
+    emit_code(buffer, 0x48, 0xB8);
+    emit_u64(buffer, bits);
+    emit_push_rax(buffer);
+}
+
+// Emits `opcode` with a ModRM byte addressing [rdi + disp32], where the displacement is the slot's byte offset.
+static void emit_slot(struct code_buffer *buffer, const uint8_t opcode, const uint8_t modrm, const size_t slot)
+{
+    emit_code(buffer, 0x48, opcode, modrm);
+    emit_u32(buffer, (uint32_t)(slot * sizeof(struct sk_value)));
+}
+
+static void emit_number_operation(struct code_buffer *buffer, const uint8_t operation)
+{
+    // movsd xmm0, [r8 - 16]; movsd xmm1, [r8 - 8]; <operation>sd xmm0, xmm1; movsd [r8 - 16], xmm0; sub r8, 8
+    emit_code(buffer, 0xF2, 0x41, 0x0F, 0x10, 0x40, 0xF0, 0xF2, 0x41, 0x0F, 0x10, 0x48, 0xF8);
+    emit_code(buffer, 0xF2, 0x0F, operation, 0xC1);
+    emit_code(buffer, 0xF2, 0x41, 0x0F, 0x11, 0x40, 0xF0, 0x49, 0x83, 0xE8, 0x08);
+}
+
+// Compares the two numbers on top of the stack and replaces them with a Boolean. Equality needs a second condition
+// on the parity flag, which `combine` merges into the first.
+static void emit_number_comparison(
+    struct code_buffer *buffer,
+    const uint8_t operands,
+    const uint8_t setcc,
+    const uint8_t other_setcc,
+    const uint8_t combine)
+{
+    // movsd xmm0, [r8 - 16]; movsd xmm1, [r8 - 8]; ucomisd; setcc al
+    emit_code(buffer, 0xF2, 0x41, 0x0F, 0x10, 0x40, 0xF0, 0xF2, 0x41, 0x0F, 0x10, 0x48, 0xF8);
+    emit_code(buffer, 0x66, 0x0F, 0x2E, operands, 0x0F, 0x90 + setcc, 0xC0);
+    if (combine != 0) {
+        // setcc cl; <combine> al, cl
+        emit_code(buffer, 0x0F, 0x90 + other_setcc, 0xC1, combine, 0xC8);
+    }
+
+    emit_boolean_result(buffer);
+}
+
+// Turns al into a Boolean value in place of the two operands on top of the stack.
+static void emit_boolean_result(struct code_buffer *buffer)
+{
+    // movzx eax, al; mov rdx, SK_VALUE_FALSE; or rax, rdx; mov [r8 - 16], rax; sub r8, 8
+    emit_code(buffer, 0x0F, 0xB6, 0xC0, 0x48, 0xBA);
+    emit_u64(buffer, SK_VALUE_FALSE);
+    emit_code(buffer, 0x48, 0x09, 0xD0, 0x49, 0x89, 0x40, 0xF0, 0x49, 0x83, 0xE8, 0x08);
+}
+
+static void emit_jump(
+    struct code_buffer *buffer,
+    struct jump_patches *patches,
+    const uint8_t opcode,
+    const size_t target)
+{
+    emit_code(buffer, opcode);
+
+    if (patches->count >= patches->capacity) {
+        patches->capacity = sk_grow(patches->capacity);
+        patches->patches = sk_realloc(patches->patches, patches->capacity);
+    }
+
+    patches->patches[patches->count++] = (struct jump_patch) {buffer->count, target};
+    emit_u32(buffer, 0);
+}
+
+static void emit_long_jump(
+    struct code_buffer *buffer,
+    struct jump_patches *patches,
+    const uint8_t condition,
+    const size_t target)
+{
+    emit_code(buffer, 0x0F);
+    emit_jump(buffer, patches, 0x80 + condition, target);
+}
+
+static void emit_compare_jump(
+    struct code_buffer *buffer,
+    struct jump_patches *patches,
+    const struct sk_program *program,
+    const uint8_t *instruction,
+    const size_t target)
+{
+    // The LOCAL_CONST forms are declared in the same order as the LOCALS forms.
+    const bool constant = instruction[0] >= SK_OP_JMP_IF_LESS_LOCAL_CONST;
+    const uint8_t opcode = constant ? instruction[0] - (SK_OP_JMP_IF_LESS_LOCAL_CONST - SK_OP_JMP_IF_LESS_LOCALS)
+                                    : instruction[0];
+
+    // movsd xmm0, [rdi + a * 8]
+    emit_code(buffer, 0xF2, 0x0F, 0x10, 0x87);
+    emit_u32(buffer, (uint32_t)(instruction[1] * sizeof(struct sk_value)));
+    if (constant) {
+        // mov rax, imm64; movq xmm1, rax
+        emit_code(buffer, 0x48, 0xB8);
+        emit_u64(buffer, program->constants.values.array[instruction[2]].bits);
+        emit_code(buffer, 0x66, 0x48, 0x0F, 0x6E, 0xC8);
+    } else {
+        // movsd xmm1, [rdi + b * 8]
+        emit_code(buffer, 0xF2, 0x0F, 0x10, 0x8F);
+        emit_u32(buffer, (uint32_t)(instruction[2] * sizeof(struct sk_value)));
+    }
+
+    switch (opcode) {
+        case SK_OP_JMP_IF_LESS_LOCALS:
+            emit_code(buffer, 0x66, 0x0F, 0x2E, UCOMISD_B_A);
+            emit_long_jump(buffer, patches, CC_ABOVE, target);
+            break;
+        case SK_OP_JMP_IF_NOT_LESS_LOCALS:
+            emit_code(buffer, 0x66, 0x0F, 0x2E, UCOMISD_B_A);
+            emit_long_jump(buffer, patches, CC_BELOW_OR_EQUAL, target);
+            break;
+        case SK_OP_JMP_IF_GREATER_LOCALS:
+            emit_code(buffer, 0x66, 0x0F, 0x2E, UCOMISD_A_B);
+            emit_long_jump(buffer, patches, CC_ABOVE, target);
+            break;
+        case SK_OP_JMP_IF_NOT_GREATER_LOCALS:
+            emit_code(buffer, 0x66, 0x0F, 0x2E, UCOMISD_A_B);
+            emit_long_jump(buffer, patches, CC_BELOW_OR_EQUAL, target);
+            break;
+        case SK_OP_JMP_IF_EQUAL_LOCALS:
+            // jp over the following 6-byte je
+            emit_code(buffer, 0x66, 0x0F, 0x2E, UCOMISD_A_B, 0x7A, 0x06);
+            emit_long_jump(buffer, patches, CC_EQUAL, target);
+            break;
+        default:
+            emit_code(buffer, 0x66, 0x0F, 0x2E, UCOMISD_A_B);
+            emit_long_jump(buffer, patches, CC_PARITY, target);
+            emit_long_jump(buffer, patches, CC_NOT_EQUAL, target);
+            break;
+    }
+}
+
+// Counts the back-edge in the function's profile and jumps to the loop header, unless an incremental collection is
+// running. Then the interpreter takes the back-edge instead, which also does a slice of the collection, and enters
+// native code again at the header.
+static void emit_back_edge(
+    struct code_buffer *buffer,
+    struct jump_patches *patches,
+    const struct sk_program *program,
+    size_t *back_edges,
+    const uint8_t *instruction,
+    const size_t target)
+{
+    // mov rax, &heap.cycle; cmp byte [rax], SK_GC_CYCLE_IDLE; jne over the 19 bytes up to the exit
+    emit_code(buffer, 0x48, 0xB8);
+    emit_u64(buffer, (uint64_t)(uintptr_t)&program->heap.cycle);
+    emit_code(buffer, 0x80, 0x38, SK_GC_CYCLE_IDLE, 0x75, 0x13);
+    // mov rax, back_edges; add qword [rax], 1; jmp target
+    emit_code(buffer, 0x48, 0xB8);
+    emit_u64(buffer, (uint64_t)(uintptr_t)back_edges);
+    emit_code(buffer, 0x48, 0x83, 0x00, 0x01);
+    emit_jump(buffer, patches, 0xE9, target);
+    emit_exit(buffer, instruction);
+}
+
+// Leaves native code so that the interpreter executes the instruction at `ip`.
+static void emit_exit(struct code_buffer *buffer, const uint8_t *ip)
+{
+    // mov [rsi], r8; mov rax, ip; ret
+    emit_code(buffer, 0x4C, 0x89, 0x06, 0x48, 0xB8);
+    emit_u64(buffer, (uint64_t)(uintptr_t)ip);
+    emit_code(buffer, 0xC3);
+}
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef SKARD_SK_JIT_H
+#define SKARD_SK_JIT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sk_vm.h"
+
+// Calls and loop back-edges of a function before the VM has it compiled to native code.
+#define SK_JIT_DEFAULT_THRESHOLD 1000
+
+// Baseline JIT for the stack VM, available on x86-64 Linux. A hot function is translated instruction by instruction
+// into fixed machine code templates that work on the interpreter's own frame: the locals at `slots` and the operands
+// on the value stack. Native code can therefore be entered at any instruction and left at any instruction. Calls,
+// returns and prints leave it, and so do loop back-edges while an incremental collection is running; the interpreter
+// executes them and enters native code again at the next function entry, loop back-edge or return into a compiled
+// function. The JIT plugs into the VM as its tier.
+struct sk_jit_function;
+
+struct sk_jit {
+    const struct sk_program *program;
+    struct sk_jit_function *functions;
+};
+
+bool sk_jit_supported(void);
+void sk_jit_init(struct sk_jit *jit, const struct sk_program *program);
+void sk_jit_free(struct sk_jit *jit);
+
+// A VM tier that compiles functions once they have been entered `threshold` times.
+struct sk_vm_tier sk_jit_tier(struct sk_jit *jit, size_t threshold);
+
+// Compiles `function` unless it already is. Its native code counts the loop back-edges it takes in `back_edges`, which
+// must outlive it. Returns false when it cannot be compiled.
+bool sk_jit_compile(struct sk_jit *jit, const struct sk_compiled_function *function, size_t *back_edges);
+
+// Runs the native code of `function` from `ip` if it has been compiled. Native code moves `sp` like the interpreter
+// would. Returns the instruction the interpreter continues with, or NULL when no native code ran.
+uint8_t *sk_jit_enter(
+    const struct sk_jit *jit,
+    const struct sk_compiled_function *function,
+    const uint8_t *ip,
+    struct sk_value *slots,
+    struct sk_value **sp);
+
+#endif // SKARD_SK_JIT_H
@@ -1,22 +1,223 @@
 #include "sk_memory.h"
 
+#include <assert.h>
+#include <setjmp.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+// Every block starts with a header that records where it came from, so that it can be resized, freed and counted
+// without the caller knowing its size. The header is padded to SK_MEMORY_ALIGNMENT, so that the block after it is as
+// aligned as the allocator's.
+struct allocation_header {
+    const struct sk_allocator *allocator;
+    size_t size;
+    enum sk_memory_subsystem subsystem;
+};
+
+#define HEADER_SIZE                                                                                                    \
+    ((sizeof(struct allocation_header) + SK_MEMORY_ALIGNMENT - 1) / SK_MEMORY_ALIGNMENT * SK_MEMORY_ALIGNMENT)
+
+static void *default_allocate(void *user_data, size_t size);
+static void *default_reallocate(void *user_data, void *ptr, size_t old_size, size_t new_size);
+static void default_free(void *user_data, void *ptr, size_t size);
+static bool reserve(enum sk_memory_subsystem subsystem, size_t old_size, size_t new_size);
+static void fail(void);
+
+const struct sk_allocator sk_default_allocator = {
+    .allocate = default_allocate,
+    .reallocate = default_reallocate,
+    .free = default_free,
+    .user_data = NULL,
+};
+
+static const struct sk_allocator *current_allocator = &sk_default_allocator;
+static enum sk_memory_subsystem current_subsystem = SK_MEMORY_OTHER;
+static struct sk_memory_stats stats[SK_MEMORY_SUBSYSTEM_COUNT];
+static size_t total_bytes = 0;
+static size_t limit = 0;
+static jmp_buf *recovery = NULL;
+static struct sk_memory_cleanup *cleanups = NULL;
+// The newest cleanup pushed before the current protected body started, which a failure leaves alone.
+static struct sk_memory_cleanup *protected_cleanups = NULL;
+
+void sk_memory_use(const struct sk_allocator *allocator, const enum sk_memory_subsystem subsystem)
+{
+    current_allocator = allocator;
+    current_subsystem = subsystem;
+}
+
+void sk_memory_set_limit(const size_t new_limit)
+{
+    limit = new_limit;
+}
+
+const struct sk_memory_stats *sk_memory_stats(const enum sk_memory_subsystem subsystem)
+{
+    return &stats[subsystem];
+}
+
+const char *sk_memory_subsystem_name(const enum sk_memory_subsystem subsystem)
+{
+    switch (subsystem) {
+        case SK_MEMORY_OTHER:
+            return "other";
+        case SK_MEMORY_PARSER:
+            return "parser";
+        case SK_MEMORY_CHECKER:
+            return "checker";
+        case SK_MEMORY_COMPILER:
+            return "compiler";
+        case SK_MEMORY_VM:
+            return "vm";
+        case SK_MEMORY_SUBSYSTEM_COUNT:
+            break;
+    }
+
+    return "unknown";
+}
+
+bool sk_memory_protect(void (*body)(void *data), void *data)
+{
+    jmp_buf *volatile previous = recovery;
+    struct sk_memory_cleanup *volatile previous_cleanups = protected_cleanups;
+    jmp_buf buffer;
+    if (setjmp(buffer) != 0) {
+        recovery = previous;
+        protected_cleanups = previous_cleanups;
+        return false;
+    }
+
+    recovery = &buffer;
+    protected_cleanups = cleanups;
+    body(data);
+    recovery = previous;
+    protected_cleanups = previous_cleanups;
+    return true;
+}
+
+void sk_memory_push_cleanup(struct sk_memory_cleanup *cleanup)
+{
+    cleanup->previous = cleanups;
+    cleanups = cleanup;
+}
+
+void sk_memory_pop_cleanup(const struct sk_memory_cleanup *cleanup)
+{
+    assert(cleanups == cleanup);
+    cleanups = cleanup->previous;
+}
+
 void *sk_reallocate(void *ptr, const size_t new_size)
 {
+    if (ptr == NULL && new_size == 0) {
+        return NULL;
+    }
+
+    if (ptr == NULL) {
+        if (!reserve(current_subsystem, 0, new_size)) {
+            fail();
+        }
+
+        struct allocation_header *header = current_allocator->allocate(
+            current_allocator->user_data,
+            HEADER_SIZE + new_size);
+        if (header == NULL) {
+            reserve(current_subsystem, new_size, 0);
+            fprintf(stderr, "Not enough memory.\n");
+            fail();
+        }
+
+        header->allocator = current_allocator;
+        header->size = new_size;
+        header->subsystem = current_subsystem;
+        stats[current_subsystem].allocations++;
+        return (uint8_t *)header + HEADER_SIZE;
+    }
+
+    struct allocation_header *header = (struct allocation_header *)((uint8_t *)ptr - HEADER_SIZE);
+    const struct sk_allocator *allocator = header->allocator;
+    const enum sk_memory_subsystem subsystem = header->subsystem;
+    const size_t old_size = header->size;
+
     if (new_size == 0) {
-        free(ptr);
+        reserve(subsystem, old_size, 0);
+        allocator->free(allocator->user_data, header, HEADER_SIZE + old_size);
         return NULL;
     }
 
-    void *result = realloc(ptr, new_size);
+    if (!reserve(subsystem, old_size, new_size)) {
+        fail();
+    }
+
+    struct allocation_header *result = allocator->reallocate(
+        allocator->user_data,
+        header,
+        HEADER_SIZE + old_size,
+        HEADER_SIZE + new_size);
     if (result == NULL) {
+        // The block stays as it was, and so do the counters.
+        reserve(subsystem, new_size, old_size);
         fprintf(stderr, "Not enough memory.\n");
-        free(ptr);
-        exit(EXIT_FAILURE);
-        return NULL;
+        fail();
+    }
+
+    result->size = new_size;
+    return (uint8_t *)result + HEADER_SIZE;
+}
+
+static void *default_allocate(void *user_data, const size_t size)
+{
+    (void)user_data;
+    return malloc(size);
+}
+
+static void *default_reallocate(void *user_data, void *ptr, const size_t old_size, const size_t new_size)
+{
+    (void)user_data;
+    (void)old_size;
+    return realloc(ptr, new_size);
+}
+
+static void default_free(void *user_data, void *ptr, const size_t size)
+{
+    (void)user_data;
+    (void)size;
+    free(ptr);
+}
+
+// Moves the count of a block of `subsystem` from `old_size` to `new_size` bytes. Growing fails, reporting it and
+// leaving the counters alone, when it would take the live bytes past the limit.
+static bool reserve(const enum sk_memory_subsystem subsystem, const size_t old_size, const size_t new_size)
+{
+    if (new_size > old_size && limit != 0 &&
+        (total_bytes > limit || new_size - old_size > limit - total_bytes)) {
+        fprintf(stderr, "Memory limit of %zu bytes exceeded in the %s.\n", limit, sk_memory_subsystem_name(subsystem));
+        return false;
+    }
+
+    struct sk_memory_stats *subsystem_stats = &stats[subsystem];
+    total_bytes = total_bytes - old_size + new_size;
+    subsystem_stats->bytes = subsystem_stats->bytes - old_size + new_size;
+    if (subsystem_stats->bytes > subsystem_stats->peak_bytes) {
+        subsystem_stats->peak_bytes = subsystem_stats->bytes;
+    }
+
+    return true;
+}
+
+// Runs the cleanups of the protected body and ends it, or ends the process when there is none.
+static void fail(void)
+{
+    if (recovery != NULL) {
+        while (cleanups != protected_cleanups) {
+            struct sk_memory_cleanup *cleanup = cleanups;
+            cleanups = cleanup->previous;
+            cleanup->run(cleanup->data);
+        }
+
+        longjmp(*recovery, 1);
     }
 
-    return result;
+    exit(EXIT_FAILURE);
 }
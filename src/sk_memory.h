@@ -1,8 +1,86 @@
 #ifndef SKARD_SK_UTILS_H
 #define SKARD_SK_UTILS_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdlib.h>
 
+// The types with the strictest alignment in C99. SK_MEMORY_ALIGNMENT is their alignment, which every block must have,
+// as malloc's blocks do.
+union sk_max_align {
+    long double long_double;
+    long long long_long;
+    double floating;
+    void *pointer;
+    void (*function)(void);
+};
+
+struct sk_max_align_probe {
+    char offset;
+    union sk_max_align value;
+};
+
+#define SK_MEMORY_ALIGNMENT offsetof(struct sk_max_align_probe, value)
+
+// Pluggable allocator. `allocate` and `reallocate` return NULL when they run out of memory, and blocks aligned to
+// SK_MEMORY_ALIGNMENT otherwise; the sizes passed to `reallocate` and `free` are the ones the block was last allocated
+// with.
+struct sk_allocator {
+    void *(*allocate)(void *user_data, size_t size);
+    void *(*reallocate)(void *user_data, void *ptr, size_t old_size, size_t new_size);
+    void (*free)(void *user_data, void *ptr, size_t size);
+    void *user_data;
+};
+
+// The C library's allocator, used until another one is selected.
+extern const struct sk_allocator sk_default_allocator;
+
+// Who allocates: every block is counted against the subsystem that was current when it was first allocated.
+enum sk_memory_subsystem {
+    SK_MEMORY_OTHER,
+    SK_MEMORY_PARSER,
+    SK_MEMORY_CHECKER,
+    SK_MEMORY_COMPILER,
+    SK_MEMORY_VM,
+    SK_MEMORY_SUBSYSTEM_COUNT,
+};
+
+struct sk_memory_stats {
+    size_t allocations;
+    // Bytes requested by the live blocks, without the bookkeeping of the allocator.
+    size_t bytes;
+    size_t peak_bytes;
+};
+
+// The current allocator and subsystem, the limit, the statistics and the cleanups are process-wide rather than passed
+// to each component, so only one program may be compiled or run at a time, on one thread.
+
+// Selects the allocator and subsystem of new blocks. Blocks that already exist are always resized and freed by the
+// allocator that made them, which must outlive them.
+void sk_memory_use(const struct sk_allocator *allocator, enum sk_memory_subsystem subsystem);
+
+// Caps the bytes of all live blocks together; 0 removes the cap.
+void sk_memory_set_limit(size_t limit);
+
+const struct sk_memory_stats *sk_memory_stats(enum sk_memory_subsystem subsystem);
+const char *sk_memory_subsystem_name(enum sk_memory_subsystem subsystem);
+
+// Runs `body`. An allocation that fails inside it, because of the limit or the allocator, is reported and ends `body`
+// right away, and false is returned. Outside of it such a failure exits the process.
+bool sk_memory_protect(void (*body)(void *data), void *data);
+
+// Releases what a protected body holds when an allocation failure ends it. The cleanups pushed inside the body and
+// not popped yet run newest first, while the frames they live in still exist, and before sk_memory_protect returns.
+struct sk_memory_cleanup {
+    void (*run)(void *data);
+    void *data;
+    struct sk_memory_cleanup *previous;
+};
+
+void sk_memory_push_cleanup(struct sk_memory_cleanup *cleanup);
+// Removes the most recently pushed cleanup, which must be `cleanup`, without running it.
+void sk_memory_pop_cleanup(const struct sk_memory_cleanup *cleanup);
+
 void *sk_reallocate(void *ptr, size_t new_size);
 
 #define sk_free(ptr) sk_reallocate((ptr), 0)
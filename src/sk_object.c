@@ -2,28 +2,59 @@
 
 #include <string.h>
 
-#include "sk_memory.h"
+#include "sk_gc.h"
+#include "sk_hashmap.h"
 
-struct sk_object *sk_object_new(const size_t size)
+#define allocate_object(heap, generation, type, object_type, additional_size)                                          \
+    ((type *)sk_heap_allocate((heap), (object_type), (generation), sizeof(type) + (additional_size)))
+
+size_t sk_object_size(const struct sk_object *object)
 {
-    struct sk_object *object = sk_allocs(size);
-    object->unused = false;
-    return object;
-}
+    switch (object->type) {
+        case SK_OBJECT_STRING:
+            return sizeof(struct sk_object_string) + ((const struct sk_object_string *)object)->length + 1;
+    }
 
-#define allocate_object(type, additional_size) ((type *)sk_object_new(sizeof(type) + (additional_size)))
+    return sizeof *object;
+}
 
-struct sk_object_string *sk_object_string_new(const size_t length)
+struct sk_object_string *sk_object_string_from_chars(
+    struct sk_heap *heap,
+    const enum sk_gc_generation generation,
+    const char *chars,
+    const size_t length)
 {
-    struct sk_object_string *string = allocate_object(struct sk_object_string, (length + 1) * sizeof(char));
+    const uint32_t hash = sk_hashmap_hash(chars, length);
+    struct sk_object_string *interned = sk_heap_find_string(heap, chars, length, hash);
+    if (interned != NULL && generation == SK_GC_OLD && sk_heap_is_young(heap, &interned->obj)) {
+        // Nothing may refer to the young copy once an old one exists, so the nursery is evacuated instead. If the
+        // string survives, the table then holds its promoted copy.
+        sk_gc_collect_young(heap);
+        interned = sk_heap_find_string(heap, chars, length, hash);
+    }
+
+    if (interned != NULL) {
+        return interned;
+    }
+
+    struct sk_object_string *string =
+        allocate_object(heap, generation, struct sk_object_string, SK_OBJECT_STRING, (length + 1) * sizeof(char));
+    string->hash = hash;
     string->length = length;
+    memcpy(string->chars, chars, length);
+    string->chars[length] = '\0';
+    sk_heap_add_string(heap, string);
     return string;
 }
 
-struct sk_object_string *sk_object_string_from_chars(const char *chars, const size_t length)
+struct sk_object_string *sk_object_string_concat(
+    struct sk_heap *heap,
+    const struct sk_object_string *a,
+    const struct sk_object_string *b)
 {
-    struct sk_object_string *string = sk_object_string_new(length);
-    memcpy(string->chars, chars, length);
-    string->chars[length] = '\0';
-    return string;
+    const size_t length = a->length + b->length;
+    char *chars = sk_heap_scratch(heap, length);
+    memcpy(chars, a->chars, a->length);
+    memcpy(chars + a->length, b->chars, b->length);
+    return sk_object_string_from_chars(heap, SK_GC_YOUNG, chars, length);
 }
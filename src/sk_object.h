@@ -3,23 +3,55 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
+struct sk_heap;
+
+enum sk_object_type {
+    SK_OBJECT_STRING,
+};
+
+// Where a new object goes. Most objects die young and are allocated in the nursery; objects that live as long as the
+// program, such as constants, go straight to the old generation.
+enum sk_gc_generation {
+    SK_GC_YOUNG,
+    SK_GC_OLD,
+};
+
+// Header of every heap object. The heap links its old objects through `next`; `marked` is only set while the
+// collector runs.
 struct sk_object {
-    // TODO: The following value is here only because this struct cannot be empty.
-    // Eventually it will be replaced by something else.
-    bool unused;
+    struct sk_object *next;
+    enum sk_object_type type;
+    bool marked;
 };
 
-struct sk_object *sk_object_new(size_t size);
+// The number of bytes the object takes up, header included.
+size_t sk_object_size(const struct sk_object *object);
 
+// Strings are interned in their heap: two strings with the same contents are the same object, so they are equal
+// exactly when their values are identical.
 struct sk_object_string {
     struct sk_object obj;
+    // sk_hashmap_hash of the contents.
+    uint32_t hash;
     size_t length;
     char chars[];
 };
 
-struct sk_object_string *sk_object_string_new(size_t length);
-struct sk_object_string *sk_object_string_from_chars(const char *chars, size_t length);
+// Returns the string with these contents, allocating it in `generation` if the heap has none yet. A young string that
+// is asked for in the old generation is promoted first.
+struct sk_object_string *sk_object_string_from_chars(
+    struct sk_heap *heap,
+    enum sk_gc_generation generation,
+    const char *chars,
+    size_t length);
 
+// Returns the string with the contents of `a` followed by those of `b`, allocating it young if the heap has none yet.
+// The allocation may collect and move both operands, so the caller must read them again rather than keep `a` or `b`.
+struct sk_object_string *sk_object_string_concat(
+    struct sk_heap *heap,
+    const struct sk_object_string *a,
+    const struct sk_object_string *b);
 
 #endif // SKARD_SK_OBJECT_H
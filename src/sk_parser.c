@@ -137,6 +137,7 @@ static struct sk_ast_node *ast_call_new(
         .as.call = (struct sk_ast_call) {
             .callee = callee,
             .args = args,
+            .inlined = NULL,
         },
     };
 
@@ -0,0 +1,634 @@
+#include "sk_peephole.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sk_memory.h"
+
+// The compiler never emits cyclic jump chains, but a hop limit keeps threading finite on any input.
+#define PEEPHOLE_MAX_JUMP_HOPS 16
+
+// The longest non-jump operands are three bytes: a two-byte function and a count for CALL_DIRECT and TAIL_CALL_DIRECT,
+// and a count and a cache entry for PRINT.
+#define PEEPHOLE_MAX_OPERANDS 3
+
+struct peephole_instruction {
+    uint8_t opcode;
+    uint8_t operands[PEEPHOLE_MAX_OPERANDS];
+    size_t target;
+    bool removed;
+    bool jump_target;
+};
+
+struct peephole_code {
+    struct peephole_instruction *instructions;
+    size_t count;
+};
+
+static bool decode(struct peephole_code *code, const struct sk_chunk *chunk);
+static bool encode(const struct peephole_code *code, struct sk_chunk *chunk);
+
+static bool is_jump(uint8_t opcode);
+static bool is_conditional_jump(uint8_t opcode);
+static bool is_value_test(uint8_t opcode);
+static size_t operand_count(uint8_t opcode);
+static bool is_pure_push(uint8_t opcode);
+static bool ends_flow(uint8_t opcode);
+static bool reads_local(const struct peephole_instruction *instruction, size_t slot);
+static size_t local_operand(const struct peephole_instruction *instruction);
+static bool negate_comparison(uint8_t opcode, uint8_t *negated);
+
+static size_t next_live(const struct peephole_code *code, size_t index);
+static size_t resolve_target(const struct peephole_code *code, size_t index);
+static void remove_instruction(struct peephole_code *code, size_t index);
+
+static bool remove_dead_pushes(struct peephole_code *code);
+static bool fuse_negations(struct peephole_code *code);
+static bool thread_jumps(struct peephole_code *code);
+static bool remove_jumps_to_next(struct peephole_code *code);
+static bool fold_constant_tests(struct peephole_code *code);
+static bool remove_unreachable(struct peephole_code *code, struct sk_peephole_stats *stats);
+static bool remove_dead_stores(struct peephole_code *code, struct sk_peephole_stats *stats);
+
+void sk_peephole_stats_init(struct sk_peephole_stats *stats)
+{
+    stats->bytes_before = 0;
+    stats->bytes_after = 0;
+    stats->unreachable_bytes = 0;
+    stats->dead_stores = 0;
+}
+
+void sk_peephole_optimize_chunk(struct sk_chunk *chunk, struct sk_peephole_stats *stats)
+{
+    const size_t bytes_before = chunk->count;
+
+    struct peephole_code code;
+    if (decode(&code, chunk)) {
+        // Counted into a copy so that a chunk that fails to encode reports nothing removed.
+        struct sk_peephole_stats removed;
+        sk_peephole_stats_init(&removed);
+
+        bool changed;
+        do {
+            changed = false;
+            changed |= fold_constant_tests(&code);
+            changed |= remove_unreachable(&code, &removed);
+            changed |= remove_dead_stores(&code, &removed);
+            changed |= remove_dead_pushes(&code);
+            changed |= fuse_negations(&code);
+            changed |= thread_jumps(&code);
+            changed |= remove_jumps_to_next(&code);
+        } while (changed);
+
+        if (encode(&code, chunk) && stats != NULL) {
+            stats->unreachable_bytes += removed.unreachable_bytes;
+            stats->dead_stores += removed.dead_stores;
+        }
+    }
+
+    sk_free(code.instructions);
+
+    if (stats != NULL) {
+        stats->bytes_before += bytes_before;
+        stats->bytes_after += chunk->count;
+    }
+}
+
+void sk_peephole_optimize_program(struct sk_program *program, struct sk_peephole_stats *stats)
+{
+    for (size_t i = 0; i < program->functions.count; i++) {
+        sk_peephole_optimize_chunk(&program->functions.functions[i].chunk, stats);
+    }
+}
+
+static bool decode(struct peephole_code *code, const struct sk_chunk *chunk)
+{
+    code->instructions = NULL;
+    code->count = 0;
+
+    // Maps byte offsets to instruction indices; offsets inside an instruction stay SIZE_MAX.
+    size_t *index_of = sk_realloc((size_t *)NULL, chunk->count + 1);
+    for (size_t offset = 0; offset <= chunk->count; offset++) {
+        index_of[offset] = SIZE_MAX;
+    }
+
+    size_t capacity = 0;
+    size_t offset = 0;
+    while (offset < chunk->count) {
+        const uint8_t opcode = chunk->code[offset];
+        const size_t length = sk_opcode_length(opcode);
+        if (offset + length > chunk->count) {
+            sk_free(index_of);
+            return false;
+        }
+
+        if (code->count >= capacity) {
+            capacity = sk_grow(capacity);
+            code->instructions = sk_realloc(code->instructions, capacity);
+        }
+
+        struct peephole_instruction *instruction = &code->instructions[code->count];
+        instruction->opcode = opcode;
+        for (size_t i = 0; i < operand_count(opcode); i++) {
+            instruction->operands[i] = chunk->code[offset + 1 + i];
+        }
+
+        instruction->target = 0;
+        instruction->removed = false;
+        instruction->jump_target = false;
+
+        index_of[offset] = code->count++;
+        offset += length;
+    }
+
+    index_of[chunk->count] = code->count;
+
+    // Jump targets are kept as instruction indices so that they survive removals.
+    offset = 0;
+    for (size_t i = 0; i < code->count; i++) {
+        struct peephole_instruction *instruction = &code->instructions[i];
+        const size_t end = offset + sk_opcode_length(instruction->opcode);
+
+        if (is_jump(instruction->opcode)) {
+            // The offset is always the last two bytes of a jump.
+            const size_t distance = (size_t)(chunk->code[end - 2] << 8 | chunk->code[end - 1]);
+            size_t target;
+            if (instruction->opcode == SK_OP_JMP_BACK) {
+                target = distance <= end ? end - distance : SIZE_MAX;
+            } else {
+                target = end + distance <= chunk->count ? end + distance : SIZE_MAX;
+            }
+
+            if (target == SIZE_MAX || index_of[target] == SIZE_MAX) {
+                sk_free(index_of);
+                return false;
+            }
+
+            instruction->target = index_of[target];
+        }
+
+        offset = end;
+    }
+
+    for (size_t i = 0; i < code->count; i++) {
+        const struct peephole_instruction *instruction = &code->instructions[i];
+        if (is_jump(instruction->opcode) && instruction->target < code->count) {
+            code->instructions[instruction->target].jump_target = true;
+        }
+    }
+
+    sk_free(index_of);
+    return true;
+}
+
+static bool encode(const struct peephole_code *code, struct sk_chunk *chunk)
+{
+    // A removed instruction gets the offset of the next live one, which is where jumps to it now land.
+    size_t *new_offset = sk_realloc((size_t *)NULL, code->count + 1);
+    size_t length = 0;
+    for (size_t i = 0; i < code->count; i++) {
+        new_offset[i] = length;
+        if (!code->instructions[i].removed) {
+            length += sk_opcode_length(code->instructions[i].opcode);
+        }
+    }
+
+    new_offset[code->count] = length;
+
+    uint8_t *bytes = sk_realloc((uint8_t *)NULL, length == 0 ? 1 : length);
+    size_t offset = 0;
+    for (size_t i = 0; i < code->count; i++) {
+        const struct peephole_instruction *instruction = &code->instructions[i];
+        if (instruction->removed) {
+            continue;
+        }
+
+        const size_t end = offset + sk_opcode_length(instruction->opcode);
+        if (!is_jump(instruction->opcode)) {
+            bytes[offset++] = instruction->opcode;
+            for (size_t j = 0; j < operand_count(instruction->opcode); j++) {
+                bytes[offset++] = instruction->operands[j];
+            }
+
+            continue;
+        }
+
+        const size_t destination = new_offset[instruction->target];
+        uint8_t opcode = instruction->opcode;
+        size_t distance;
+        if (destination >= end) {
+            opcode = opcode == SK_OP_JMP_BACK ? SK_OP_JMP : opcode;
+            distance = destination - end;
+        } else if (!is_conditional_jump(opcode)) {
+            opcode = SK_OP_JMP_BACK;
+            distance = end - destination;
+        } else {
+            distance = SIZE_MAX;
+        }
+
+        if (distance > UINT16_MAX) {
+            sk_free(bytes);
+            sk_free(new_offset);
+            return false;
+        }
+
+        bytes[offset++] = opcode;
+        for (size_t j = 0; j < operand_count(opcode); j++) {
+            bytes[offset++] = instruction->operands[j];
+        }
+
+        bytes[offset++] = (distance >> 8) & 0xFF;
+        bytes[offset++] = distance & 0xFF;
+    }
+
+    sk_free(chunk->code);
+    chunk->code = bytes;
+    chunk->capacity = length == 0 ? 1 : length;
+    chunk->count = length;
+
+    sk_free(new_offset);
+    return true;
+}
+
+static bool is_jump(const uint8_t opcode)
+{
+    return opcode == SK_OP_JMP || opcode == SK_OP_JMP_BACK || is_conditional_jump(opcode);
+}
+
+// Conditional jumps only go forward, so they cannot be threaded to an earlier instruction.
+static bool is_conditional_jump(const uint8_t opcode)
+{
+    return is_value_test(opcode) || sk_opcode_is_compare_jump(opcode);
+}
+
+// Tests of the boolean on top of the stack, which stays there whichever way the jump goes.
+static bool is_value_test(const uint8_t opcode)
+{
+    return opcode == SK_OP_JMP_TRUE || opcode == SK_OP_JMP_FALSE;
+}
+
+static size_t operand_count(const uint8_t opcode)
+{
+    return sk_opcode_length(opcode) - 1 - (is_jump(opcode) ? 2 : 0);
+}
+
+static bool is_pure_push(const uint8_t opcode)
+{
+    switch (opcode) {
+        case SK_OP_NOTHING:
+        case SK_OP_CONST:
+        case SK_OP_CONST_WIDE:
+        case SK_OP_LOAD_LOCAL:
+        case SK_OP_LOAD_LOCAL_WIDE:
+        case SK_OP_TRUE:
+        case SK_OP_FALSE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Instructions after which execution never reaches the next one.
+static bool ends_flow(const uint8_t opcode)
+{
+    switch (opcode) {
+        case SK_OP_HALT:
+        case SK_OP_RETURN:
+        case SK_OP_TAIL_CALL:
+        case SK_OP_TAIL_CALL_WIDE:
+        case SK_OP_TAIL_CALL_DIRECT:
+        case SK_OP_JMP:
+        case SK_OP_JMP_BACK:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool reads_local(const struct peephole_instruction *instruction, const size_t slot)
+{
+    switch (instruction->opcode) {
+        case SK_OP_LOAD_LOCAL:
+        case SK_OP_LOAD_LOCAL_WIDE:
+            return local_operand(instruction) == slot;
+        default:
+            break;
+    }
+
+    if (!sk_opcode_is_compare_jump(instruction->opcode)) {
+        return false;
+    }
+
+    // Compare-jumps test a local against a second local or a constant.
+    if (instruction->operands[0] == slot) {
+        return true;
+    }
+
+    return instruction->opcode <= SK_OP_JMP_IF_NOT_EQUAL_LOCALS && instruction->operands[1] == slot;
+}
+
+// The slot of a LOAD_LOCAL or STORE_LOCAL, one byte or two for the wide forms.
+static size_t local_operand(const struct peephole_instruction *instruction)
+{
+    if (instruction->opcode == SK_OP_LOAD_LOCAL_WIDE || instruction->opcode == SK_OP_STORE_LOCAL_WIDE) {
+        return (size_t)(instruction->operands[0] << 8 | instruction->operands[1]);
+    }
+
+    return instruction->operands[0];
+}
+
+static bool negate_comparison(const uint8_t opcode, uint8_t *negated)
+{
+    switch (opcode) {
+        case SK_OP_NLESS:
+            *negated = SK_OP_NGREATER_EQUAL;
+            return true;
+        case SK_OP_NLESS_EQUAL:
+            *negated = SK_OP_NGREATER;
+            return true;
+        case SK_OP_NGREATER:
+            *negated = SK_OP_NLESS_EQUAL;
+            return true;
+        case SK_OP_NGREATER_EQUAL:
+            *negated = SK_OP_NLESS;
+            return true;
+        case SK_OP_NEQUAL:
+            *negated = SK_OP_NNOT_EQUAL;
+            return true;
+        case SK_OP_NNOT_EQUAL:
+            *negated = SK_OP_NEQUAL;
+            return true;
+        case SK_OP_EQUAL:
+            *negated = SK_OP_NOT_EQUAL;
+            return true;
+        case SK_OP_NOT_EQUAL:
+            *negated = SK_OP_EQUAL;
+            return true;
+        default:
+            return false;
+    }
+}
+
+static size_t next_live(const struct peephole_code *code, size_t index)
+{
+    do {
+        index++;
+    } while (index < code->count && code->instructions[index].removed);
+
+    return index;
+}
+
+static size_t resolve_target(const struct peephole_code *code, size_t index)
+{
+    while (index < code->count && code->instructions[index].removed) {
+        index++;
+    }
+
+    return index;
+}
+
+static void remove_instruction(struct peephole_code *code, const size_t index)
+{
+    struct peephole_instruction *instruction = &code->instructions[index];
+    instruction->removed = true;
+
+    // Jumps to a removed instruction fall through to the next live one.
+    const size_t next = next_live(code, index);
+    if (instruction->jump_target && next < code->count) {
+        code->instructions[next].jump_target = true;
+    }
+}
+
+static bool remove_dead_pushes(struct peephole_code *code)
+{
+    bool changed = false;
+    for (size_t i = 0; i < code->count; i++) {
+        if (code->instructions[i].removed || !is_pure_push(code->instructions[i].opcode)) {
+            continue;
+        }
+
+        const size_t pop = next_live(code, i);
+        if (pop >= code->count || code->instructions[pop].opcode != SK_OP_POP || code->instructions[pop].jump_target) {
+            continue;
+        }
+
+        remove_instruction(code, pop);
+        remove_instruction(code, i);
+        changed = true;
+    }
+
+    return changed;
+}
+
+static bool fuse_negations(struct peephole_code *code)
+{
+    bool changed = false;
+    for (size_t i = 0; i < code->count; i++) {
+        struct peephole_instruction *instruction = &code->instructions[i];
+        if (instruction->removed) {
+            continue;
+        }
+
+        const size_t not = next_live(code, i);
+        if (not >= code->count || code->instructions[not].opcode != SK_OP_NOT || code->instructions[not].jump_target) {
+            continue;
+        }
+
+        uint8_t negated;
+        if (negate_comparison(instruction->opcode, &negated)) {
+            instruction->opcode = negated;
+            remove_instruction(code, not);
+            changed = true;
+        } else if (instruction->opcode == SK_OP_NOT) {
+            remove_instruction(code, not);
+            remove_instruction(code, i);
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+static bool thread_jumps(struct peephole_code *code)
+{
+    bool changed = false;
+    for (size_t i = 0; i < code->count; i++) {
+        struct peephole_instruction *instruction = &code->instructions[i];
+        if (instruction->removed || !is_jump(instruction->opcode)) {
+            continue;
+        }
+
+        const bool conditional = is_conditional_jump(instruction->opcode);
+        const size_t original = resolve_target(code, instruction->target);
+        size_t target = original;
+        size_t hops = 0;
+
+        while (target < code->count) {
+            const struct peephole_instruction *next = &code->instructions[target];
+
+            // A value test leaves its operand on the stack, so a following test of the same value is already decided.
+            const bool value_test = is_value_test(instruction->opcode);
+            size_t destination;
+            if (next->opcode == SK_OP_JMP || next->opcode == SK_OP_JMP_BACK) {
+                destination = resolve_target(code, next->target);
+            } else if (value_test && next->opcode == instruction->opcode) {
+                destination = resolve_target(code, next->target);
+            } else if (value_test && is_value_test(next->opcode)) {
+                destination = next_live(code, target);
+            } else {
+                break;
+            }
+
+            // There are no backward conditional jumps.
+            if (destination == target || (conditional && destination <= i)) {
+                break;
+            }
+
+            // A chain without an end is a cycle; leave the jump alone so that the pass still reaches a fixed point.
+            if (++hops > PEEPHOLE_MAX_JUMP_HOPS) {
+                target = original;
+                break;
+            }
+
+            target = destination;
+        }
+
+        if (target != original) {
+            instruction->target = target;
+            if (target < code->count) {
+                code->instructions[target].jump_target = true;
+            }
+
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+static bool remove_jumps_to_next(struct peephole_code *code)
+{
+    bool changed = false;
+    for (size_t i = 0; i < code->count; i++) {
+        const struct peephole_instruction *instruction = &code->instructions[i];
+        if (instruction->removed || !is_jump(instruction->opcode)) {
+            continue;
+        }
+
+        if (resolve_target(code, instruction->target) == next_live(code, i)) {
+            remove_instruction(code, i);
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+// A value test right after TRUE or FALSE is decided: the jump becomes unconditional or goes away. The test must not be
+// a jump target, where other paths may arrive with a different value on the stack.
+static bool fold_constant_tests(struct peephole_code *code)
+{
+    bool changed = false;
+    for (size_t i = 0; i < code->count; i++) {
+        const struct peephole_instruction *push = &code->instructions[i];
+        if (push->removed || (push->opcode != SK_OP_TRUE && push->opcode != SK_OP_FALSE)) {
+            continue;
+        }
+
+        const size_t test = next_live(code, i);
+        if (test >= code->count || !is_value_test(code->instructions[test].opcode) ||
+            code->instructions[test].jump_target) {
+            continue;
+        }
+
+        const bool value = push->opcode == SK_OP_TRUE;
+        if (value == (code->instructions[test].opcode == SK_OP_JMP_TRUE)) {
+            code->instructions[test].opcode = SK_OP_JMP;
+        } else {
+            remove_instruction(code, test);
+        }
+
+        changed = true;
+    }
+
+    return changed;
+}
+
+// Removes the instructions that no path from the start of the chunk reaches, such as code after a `return`, the
+// `NOTHING; RETURN` the compiler appends to a body that already returned and the untaken arm of a decided test.
+static bool remove_unreachable(struct peephole_code *code, struct sk_peephole_stats *stats)
+{
+    if (code->count == 0) {
+        return false;
+    }
+
+    bool *reachable = sk_realloc((bool *)NULL, code->count);
+    for (size_t i = 0; i < code->count; i++) {
+        reachable[i] = false;
+    }
+
+    // Every instruction adds at most two successors, and only the first time it is reached.
+    size_t *worklist = sk_realloc((size_t *)NULL, 2 * code->count + 1);
+    size_t pending = 0;
+    worklist[pending++] = resolve_target(code, 0);
+
+    while (pending > 0) {
+        const size_t index = worklist[--pending];
+        if (index >= code->count || reachable[index]) {
+            continue;
+        }
+
+        reachable[index] = true;
+        const struct peephole_instruction *instruction = &code->instructions[index];
+        if (is_jump(instruction->opcode)) {
+            worklist[pending++] = resolve_target(code, instruction->target);
+        }
+
+        if (!ends_flow(instruction->opcode)) {
+            worklist[pending++] = next_live(code, index);
+        }
+    }
+
+    bool changed = false;
+    for (size_t i = 0; i < code->count; i++) {
+        if (code->instructions[i].removed || reachable[i]) {
+            continue;
+        }
+
+        stats->unreachable_bytes += sk_opcode_length(code->instructions[i].opcode);
+        remove_instruction(code, i);
+        changed = true;
+    }
+
+    sk_free(worklist);
+    sk_free(reachable);
+    return changed;
+}
+
+// Turns stores to locals that nothing in the chunk reads into POPs, which remove_dead_pushes then drops together with
+// the push of the stored value where it can. Only reachable instructions are left by now, so a local read only by dead
+// code counts as unread.
+static bool remove_dead_stores(struct peephole_code *code, struct sk_peephole_stats *stats)
+{
+    bool changed = false;
+    for (size_t i = 0; i < code->count; i++) {
+        struct peephole_instruction *store = &code->instructions[i];
+        if (store->removed || (store->opcode != SK_OP_STORE_LOCAL && store->opcode != SK_OP_STORE_LOCAL_WIDE)) {
+            continue;
+        }
+
+        const size_t slot = local_operand(store);
+        bool read = false;
+        for (size_t j = 0; j < code->count && !read; j++) {
+            read = !code->instructions[j].removed && reads_local(&code->instructions[j], slot);
+        }
+
+        if (!read) {
+            store->opcode = SK_OP_POP;
+            stats->dead_stores++;
+            changed = true;
+        }
+    }
+
+    return changed;
+}
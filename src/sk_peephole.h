@@ -0,0 +1,31 @@
+#ifndef SKARD_SK_PEEPHOLE_H
+#define SKARD_SK_PEEPHOLE_H
+
+#include <stddef.h>
+
+#include "sk_vm.h"
+
+// Rewrites the stack bytecode of a chunk in place:
+// - instructions that no path from the start reaches are removed, and a test of TRUE or FALSE becomes an unconditional
+//   jump or none,
+// - a store to a local that no reachable instruction reads becomes a POP,
+// - a pushed value that is popped right away (e.g. the `STORE_LOCAL x; LOAD_LOCAL x; POP` of an assignment statement)
+//   is dropped,
+// - a comparison followed by NOT becomes the negated comparison and two NOTs cancel out,
+// - jumps to jumps are threaded to their final target and jumps to the next instruction are removed.
+// All jump offsets are recomputed afterwards. A chunk that cannot be decoded is left untouched.
+//
+// When `stats` is not NULL, the sizes of the chunks before and after the pass are added to it, together with what the
+// reachability analysis removed.
+struct sk_peephole_stats {
+    size_t bytes_before;
+    size_t bytes_after;
+    size_t unreachable_bytes;
+    size_t dead_stores;
+};
+
+void sk_peephole_stats_init(struct sk_peephole_stats *stats);
+void sk_peephole_optimize_chunk(struct sk_chunk *chunk, struct sk_peephole_stats *stats);
+void sk_peephole_optimize_program(struct sk_program *program, struct sk_peephole_stats *stats);
+
+#endif // SKARD_SK_PEEPHOLE_H
@@ -0,0 +1,776 @@
+#include "sk_register_compiler.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "sk_checker.h"
+#include "sk_register_vm.h"
+
+static void compiler_error(struct sk_register_compiler *compiler, const char *msg);
+
+static void emit(const struct sk_register_compiler *compiler, uint8_t byte);
+static void emit2(const struct sk_register_compiler *compiler, uint8_t byte1, uint8_t byte2);
+static void emit3(const struct sk_register_compiler *compiler, uint8_t byte1, uint8_t byte2, uint8_t byte3);
+static void emit4(
+    const struct sk_register_compiler *compiler,
+    uint8_t byte1,
+    uint8_t byte2,
+    uint8_t byte3,
+    uint8_t byte4);
+
+static void emit_const(struct sk_register_compiler *compiler, uint8_t target, struct sk_value constant);
+static void emit_const_index(struct sk_register_compiler *compiler, uint8_t target, size_t index);
+static void emit_move(const struct sk_register_compiler *compiler, uint8_t target, uint8_t source);
+static size_t emit_jmp(const struct sk_register_compiler *compiler, uint8_t instruction);
+static size_t emit_jmp_register(const struct sk_register_compiler *compiler, uint8_t instruction, uint8_t source);
+static void emit_jmp_back(struct sk_register_compiler *compiler, size_t target_offset);
+
+static void patch_jmp(struct sk_register_compiler *compiler, size_t offset);
+
+static uint8_t alloc_register(struct sk_register_compiler *compiler);
+static bool is_local_register(const struct sk_register_compiler *compiler, uint8_t reg);
+static bool has_assignment(const struct sk_ast_node *node);
+static bool is_true_literal(const struct sk_ast_node *node);
+
+static void compile_program(struct sk_register_compiler *compiler, const struct sk_ast_node *node);
+
+static void compile_declaration(struct sk_register_compiler *compiler, const struct sk_ast_node *node);
+static void compile_function(struct sk_register_compiler *compiler, const struct sk_ast_node *node);
+
+static void compile_statement(struct sk_register_compiler *compiler, const struct sk_ast_node *node);
+static void compile_block(struct sk_register_compiler *compiler, const struct sk_ast_node *node);
+static void compile_let_statement(struct sk_register_compiler *compiler, const struct sk_ast_node *node);
+static void compile_if_statement(struct sk_register_compiler *compiler, const struct sk_ast_node *node);
+static void compile_while_statement(struct sk_register_compiler *compiler, const struct sk_ast_node *node);
+static void compile_print_statement(struct sk_register_compiler *compiler, const struct sk_ast_node *node);
+static void compile_return_statement(struct sk_register_compiler *compiler, const struct sk_ast_node *node);
+static void compile_expr_stmt(struct sk_register_compiler *compiler, const struct sk_ast_node *node);
+
+static uint8_t compile_operand(struct sk_register_compiler *compiler, const struct sk_ast_node *node);
+static void compile_expression(struct sk_register_compiler *compiler, const struct sk_ast_node *node, uint8_t target);
+static void compile_binary(struct sk_register_compiler *compiler, const struct sk_ast_node *node, uint8_t target);
+static void compile_logical(struct sk_register_compiler *compiler, const struct sk_ast_node *node, uint8_t target);
+static void compile_unary(struct sk_register_compiler *compiler, const struct sk_ast_node *node, uint8_t target);
+static void compile_identifier(struct sk_register_compiler *compiler, const struct sk_ast_node *node, uint8_t target);
+static void compile_assignment(struct sk_register_compiler *compiler, const struct sk_ast_node *node, uint8_t target);
+static void compile_call(struct sk_register_compiler *compiler, const struct sk_ast_node *node, uint8_t target);
+static void compile_tail_call(struct sk_register_compiler *compiler, const struct sk_ast_node *node);
+static void compile_call_operands(
+    struct sk_register_compiler *compiler,
+    const struct sk_ast_node *node,
+    uint8_t opcode,
+    uint8_t direct_opcode,
+    uint8_t base);
+static bool is_direct_call(const struct sk_ast_node *callee, sk_fnptr *fnptr);
+static void compile_inlined_call(struct sk_register_compiler *compiler, const struct sk_ast_node *node, uint8_t target);
+static uint8_t local_register(const struct sk_register_compiler *compiler, const struct sk_symbol *symbol);
+
+static void compile_literal(struct sk_register_compiler *compiler, const struct sk_ast_node *node, uint8_t target);
+
+bool sk_register_compiler_compile(
+    struct sk_register_compiler *compiler,
+    const struct sk_ast_node *node,
+    struct sk_program *program)
+{
+    compiler->program = program;
+    compiler->next_register = 0;
+    compiler->max_registers = 0;
+    compiler->locals_count = 0;
+    compiler->has_error = false;
+    sk_program_init(program);
+    compile_program(compiler, node);
+    return !compiler->has_error;
+}
+
+static void compiler_error(struct sk_register_compiler *compiler, const char *msg)
+{
+    fprintf(stderr, "%s\n", msg);
+    compiler->has_error = true;
+}
+
+static void emit(const struct sk_register_compiler *compiler, const uint8_t byte)
+{
+    sk_chunk_add(compiler->current_chunk, byte);
+}
+
+static void emit2(const struct sk_register_compiler *compiler, const uint8_t byte1, const uint8_t byte2)
+{
+    emit(compiler, byte1);
+    emit(compiler, byte2);
+}
+
+static void emit3(
+    const struct sk_register_compiler *compiler,
+    const uint8_t byte1,
+    const uint8_t byte2,
+    const uint8_t byte3)
+{
+    emit(compiler, byte1);
+    emit(compiler, byte2);
+    emit(compiler, byte3);
+}
+
+static void emit4(
+    const struct sk_register_compiler *compiler,
+    const uint8_t byte1,
+    const uint8_t byte2,
+    const uint8_t byte3,
+    const uint8_t byte4)
+{
+    emit(compiler, byte1);
+    emit(compiler, byte2);
+    emit(compiler, byte3);
+    emit(compiler, byte4);
+}
+
+static void emit_const(struct sk_register_compiler *compiler, const uint8_t target, const struct sk_value constant)
+{
+    emit_const_index(compiler, target, sk_constant_table_add(&compiler->program->constants, constant));
+}
+
+static void emit_const_index(struct sk_register_compiler *compiler, const uint8_t target, const size_t index)
+{
+    if (index <= UINT8_MAX) {
+        emit3(compiler, SK_ROP_CONST, target, (uint8_t)index);
+    } else if (index <= SK_CHUNK_MAX_OPERAND) {
+        emit4(compiler, SK_ROP_CONST_WIDE, target, (index >> 8) & 0xFF, index & 0xFF);
+    } else {
+        compiler_error(compiler, "Too many constants.");
+    }
+}
+
+static void emit_move(const struct sk_register_compiler *compiler, const uint8_t target, const uint8_t source)
+{
+    if (target != source) {
+        emit3(compiler, SK_ROP_MOVE, target, source);
+    }
+}
+
+static size_t emit_jmp(const struct sk_register_compiler *compiler, const uint8_t instruction)
+{
+    emit3(compiler, instruction, 0xFF, 0xFF);
+    return compiler->current_chunk->count - 2;
+}
+
+static size_t emit_jmp_register(
+    const struct sk_register_compiler *compiler,
+    const uint8_t instruction,
+    const uint8_t source)
+{
+    emit4(compiler, instruction, source, 0xFF, 0xFF);
+    return compiler->current_chunk->count - 2;
+}
+
+static void emit_jmp_back(struct sk_register_compiler *compiler, const size_t target_offset)
+{
+    emit(compiler, SK_ROP_JMP_BACK);
+
+    const size_t offset = compiler->current_chunk->count - target_offset + 2;
+    if (offset > UINT16_MAX) {
+        compiler_error(compiler, "Too long jump.");
+        return;
+    }
+
+    emit(compiler, (offset >> 8) & 0xFF);
+    emit(compiler, offset & 0xFF);
+}
+
+static void patch_jmp(struct sk_register_compiler *compiler, const size_t offset)
+{
+    const size_t jmp_offset = compiler->current_chunk->count - offset - 2;
+
+    if (jmp_offset > UINT16_MAX) {
+        compiler_error(compiler, "Too long jump.");
+    }
+
+    compiler->current_chunk->code[offset] = (jmp_offset >> 8) & 0xFF;
+    compiler->current_chunk->code[offset + 1] = jmp_offset & 0xFF;
+}
+
+static uint8_t alloc_register(struct sk_register_compiler *compiler)
+{
+    if (compiler->next_register >= SK_REGISTER_VM_MAX_REGISTERS) {
+        if (!compiler->has_error) {
+            compiler_error(compiler, "Too many registers.");
+        }
+        return 0;
+    }
+
+    const size_t reg = compiler->next_register++;
+    if (compiler->next_register > compiler->max_registers) {
+        compiler->max_registers = compiler->next_register;
+    }
+
+    return (uint8_t)reg;
+}
+
+static bool is_local_register(const struct sk_register_compiler *compiler, const uint8_t reg)
+{
+    return reg < compiler->locals_count;
+}
+
+// Reports whether evaluating the expression can change a local variable.
+static bool has_assignment(const struct sk_ast_node *node)
+{
+    switch (node->type) {
+        case SK_AST_ASSIGN:
+            return true;
+        case SK_AST_UNARY:
+            return has_assignment(node->as.unary.expression);
+        case SK_AST_BINARY:
+            return has_assignment(node->as.binary.left) || has_assignment(node->as.binary.right);
+        case SK_AST_CALL:
+            if (has_assignment(node->as.call.callee)) {
+                return true;
+            }
+
+            for (size_t i = 0; i < node->as.call.args.count; i++) {
+                if (has_assignment(node->as.call.args.nodes[i])) {
+                    return true;
+                }
+            }
+
+            return false;
+        default:
+            return false;
+    }
+}
+
+static bool is_true_literal(const struct sk_ast_node *node)
+{
+    return node->type == SK_AST_LITERAL && node->as.literal.token.type == SK_TOKEN_TRUE;
+}
+
+static void compile_program(struct sk_register_compiler *compiler, const struct sk_ast_node *node)
+{
+    const struct sk_ast_program *program = &node->as.program;
+    for (size_t i = 0; i < program->declarations.count; i++) {
+        compile_declaration(compiler, program->declarations.nodes[i]);
+    }
+}
+
+static void compile_declaration(struct sk_register_compiler *compiler, const struct sk_ast_node *node)
+{
+    if (node->type == SK_AST_FN) {
+        compile_function(compiler, node);
+    }
+}
+
+static void compile_function(struct sk_register_compiler *compiler, const struct sk_ast_node *node)
+{
+    const struct sk_ast_fn *fn = &node->as.fn;
+    const sk_fnptr fnptr = fn->symbol->as.fn_overloads.overloads.fnptr;
+    struct sk_compiled_function *function = sk_program_add_function(compiler->program, fnptr);
+
+    if (fn->locals_count > SK_REGISTER_VM_MAX_REGISTERS) {
+        compiler_error(compiler, "Too many registers.");
+        return;
+    }
+
+    compiler->current_chunk = &function->chunk;
+    compiler->locals_count = fn->locals_count;
+    compiler->next_register = fn->locals_count;
+    compiler->max_registers = fn->locals_count;
+    compiler->register_base = 0;
+
+    compile_block(compiler, fn->body);
+
+    const uint8_t result = alloc_register(compiler);
+    emit2(compiler, SK_ROP_NOTHING, result);
+    emit2(compiler, SK_ROP_RETURN, result);
+
+    function->chunk.locals_count = compiler->max_registers;
+    function->parameter_count = fn->parameters.count;
+
+    if (fn->name.length == 4 && memcmp(fn->name.start, "main", 4) == 0) {
+        compiler->program->entry = fnptr;
+    }
+}
+
+static void compile_statement(struct sk_register_compiler *compiler, const struct sk_ast_node *node)
+{
+    // Temporaries never outlive the statement that allocated them.
+    const size_t mark = compiler->next_register;
+
+    switch (node->type) {
+        case SK_AST_BLOCK:
+            compile_block(compiler, node);
+            break;
+        case SK_AST_LET:
+            compile_let_statement(compiler, node);
+            break;
+        case SK_AST_IF:
+            compile_if_statement(compiler, node);
+            break;
+        case SK_AST_WHILE:
+            compile_while_statement(compiler, node);
+            break;
+        case SK_AST_PRINT:
+            compile_print_statement(compiler, node);
+            break;
+        case SK_AST_RETURN:
+            compile_return_statement(compiler, node);
+            break;
+        case SK_AST_EXPR_STMT:
+            compile_expr_stmt(compiler, node);
+            break;
+        default:
+            compiler_error(compiler, "Unsupported statement.");
+            break;
+    }
+
+    compiler->next_register = mark;
+}
+
+static void compile_block(struct sk_register_compiler *compiler, const struct sk_ast_node *node)
+{
+    const struct sk_ast_block *block = &node->as.block;
+    for (size_t i = 0; i < block->contents.count; i++) {
+        compile_statement(compiler, block->contents.nodes[i]);
+    }
+}
+
+static void compile_let_statement(struct sk_register_compiler *compiler, const struct sk_ast_node *node)
+{
+    const struct sk_ast_let *let = &node->as.let;
+
+    if (let->symbol == NULL) {
+        compiler_error(compiler, "Missing local symbol.");
+        return;
+    }
+
+    const uint8_t slot = local_register(compiler, let->symbol);
+    if (!let->has_initializer) {
+        emit2(compiler, SK_ROP_NOTHING, slot);
+        return;
+    }
+
+    compile_expression(compiler, let->expression, slot);
+}
+
+static void compile_if_statement(struct sk_register_compiler *compiler, const struct sk_ast_node *node)
+{
+    const size_t mark = compiler->next_register;
+    const uint8_t condition = compile_operand(compiler, node->as.ifn.condition);
+    const size_t then_branch_jmp = emit_jmp_register(compiler, SK_ROP_JMP_FALSE, condition);
+    compiler->next_register = mark;
+
+    compile_statement(compiler, node->as.ifn.then_branch);
+
+    if (node->as.ifn.else_branch == NULL) {
+        patch_jmp(compiler, then_branch_jmp);
+        return;
+    }
+
+    const size_t else_branch_jmp = emit_jmp(compiler, SK_ROP_JMP);
+    patch_jmp(compiler, then_branch_jmp);
+    compile_statement(compiler, node->as.ifn.else_branch);
+    patch_jmp(compiler, else_branch_jmp);
+}
+
+static void compile_while_statement(struct sk_register_compiler *compiler, const struct sk_ast_node *node)
+{
+    const size_t loop_start = compiler->current_chunk->count;
+
+    // A `while (true)` loop only ends through `return`, so it needs no test.
+    if (is_true_literal(node->as.whilen.condition)) {
+        compile_statement(compiler, node->as.whilen.body);
+        emit_jmp_back(compiler, loop_start);
+        return;
+    }
+
+    const size_t mark = compiler->next_register;
+    const uint8_t condition = compile_operand(compiler, node->as.whilen.condition);
+    const size_t exit_jmp = emit_jmp_register(compiler, SK_ROP_JMP_FALSE, condition);
+    compiler->next_register = mark;
+
+    compile_statement(compiler, node->as.whilen.body);
+
+    emit_jmp_back(compiler, loop_start);
+    patch_jmp(compiler, exit_jmp);
+}
+
+static void compile_print_statement(struct sk_register_compiler *compiler, const struct sk_ast_node *node)
+{
+    const struct sk_ast_print *print = &node->as.print;
+    if (print->args.count == 0) {
+        return;
+    }
+
+    if (print->args.count > UINT8_MAX) {
+        compiler_error(compiler, "Too many print arguments.");
+        return;
+    }
+
+    const size_t first = compiler->next_register;
+    for (size_t i = 0; i < print->args.count; i++) {
+        alloc_register(compiler);
+    }
+
+    for (size_t i = 0; i < print->args.count; i++) {
+        compile_expression(compiler, print->args.nodes[i], (uint8_t)(first + i));
+    }
+
+    emit3(compiler, SK_ROP_PRINT, (uint8_t)first, (uint8_t)print->args.count);
+}
+
+static void compile_return_statement(struct sk_register_compiler *compiler, const struct sk_ast_node *node)
+{
+    const struct sk_ast_node *expression = node->as.returnn.expression;
+    if (expression == NULL) {
+        const uint8_t result = alloc_register(compiler);
+        emit2(compiler, SK_ROP_NOTHING, result);
+        emit2(compiler, SK_ROP_RETURN, result);
+        return;
+    }
+
+    if (expression->type == SK_AST_CALL && expression->as.call.inlined == NULL) {
+        compile_tail_call(compiler, expression);
+        return;
+    }
+
+    const uint8_t result = compile_operand(compiler, expression);
+    emit2(compiler, SK_ROP_RETURN, result);
+}
+
+static void compile_expr_stmt(struct sk_register_compiler *compiler, const struct sk_ast_node *node)
+{
+    const struct sk_ast_node *expression = node->as.expr_stmt.expression;
+
+    // An assignment statement writes straight into the variable's register and needs no result register.
+    if (expression->type == SK_AST_ASSIGN && expression->as.assign.symbol != NULL) {
+        const uint8_t slot = local_register(compiler, expression->as.assign.symbol);
+        compile_expression(compiler, expression->as.assign.expression, slot);
+        return;
+    }
+
+    compile_expression(compiler, expression, alloc_register(compiler));
+}
+
+// Returns a register that holds the value of the expression. Locals are used in place, anything else is evaluated into
+// a fresh temporary.
+static uint8_t compile_operand(struct sk_register_compiler *compiler, const struct sk_ast_node *node)
+{
+    if (node->type == SK_AST_IDENTIFIER && node->as.identifier.symbol != NULL &&
+        node->as.identifier.symbol->type == SK_SYMBOL_LOCAL) {
+        return local_register(compiler, node->as.identifier.symbol);
+    }
+
+    const uint8_t reg = alloc_register(compiler);
+    compile_expression(compiler, node, reg);
+    return reg;
+}
+
+// Evaluates the expression into the target register. The target is written only after all operands have been read.
+static void compile_expression(
+    struct sk_register_compiler *compiler,
+    const struct sk_ast_node *node,
+    const uint8_t target)
+{
+    switch (node->type) {
+        case SK_AST_BINARY:
+            compile_binary(compiler, node, target);
+            break;
+        case SK_AST_UNARY:
+            compile_unary(compiler, node, target);
+            break;
+        case SK_AST_IDENTIFIER:
+            compile_identifier(compiler, node, target);
+            break;
+        case SK_AST_CALL:
+            compile_call(compiler, node, target);
+            break;
+        case SK_AST_ASSIGN:
+            compile_assignment(compiler, node, target);
+            break;
+        case SK_AST_LITERAL:
+            compile_literal(compiler, node, target);
+            break;
+        default:
+            compiler_error(compiler, "Unsupported expression.");
+            break;
+    }
+}
+
+static void compile_binary(struct sk_register_compiler *compiler, const struct sk_ast_node *node, const uint8_t target)
+{
+    const enum sk_token_type operator = node->as.binary.operator.type;
+    if (operator == SK_TOKEN_AND || operator == SK_TOKEN_OR) {
+        compile_logical(compiler, node, target);
+        return;
+    }
+
+    uint8_t opcode;
+    switch (operator) {
+        case SK_TOKEN_PLUS:
+            opcode = node->as.binary.number_operands ? SK_ROP_NADD : SK_ROP_CONCAT;
+            break;
+        case SK_TOKEN_MINUS:
+            opcode = SK_ROP_NSUB;
+            break;
+        case SK_TOKEN_STAR:
+            opcode = SK_ROP_NMUL;
+            break;
+        case SK_TOKEN_SLASH:
+            opcode = SK_ROP_NDIV;
+            break;
+        case SK_TOKEN_LESS:
+            opcode = SK_ROP_NLESS;
+            break;
+        case SK_TOKEN_LESS_EQ:
+            opcode = SK_ROP_NLESS_EQUAL;
+            break;
+        case SK_TOKEN_GREATER:
+            opcode = SK_ROP_NGREATER;
+            break;
+        case SK_TOKEN_GREATER_EQ:
+            opcode = SK_ROP_NGREATER_EQUAL;
+            break;
+        case SK_TOKEN_EQUAL:
+            opcode = node->as.binary.number_operands ? SK_ROP_NEQUAL : SK_ROP_EQUAL;
+            break;
+        case SK_TOKEN_NOT_EQUAL:
+            opcode = node->as.binary.number_operands ? SK_ROP_NNOT_EQUAL : SK_ROP_NOT_EQUAL;
+            break;
+        default:
+            compiler_error(compiler, "Unsupported binary operator.");
+            return;
+    }
+
+    const size_t mark = compiler->next_register;
+    uint8_t left = compile_operand(compiler, node->as.binary.left);
+
+    // A local read in place must be copied when the right operand may assign to it before the operator runs.
+    if (is_local_register(compiler, left) && has_assignment(node->as.binary.right)) {
+        const uint8_t copy = alloc_register(compiler);
+        emit_move(compiler, copy, left);
+        left = copy;
+    }
+
+    const uint8_t right = compile_operand(compiler, node->as.binary.right);
+    emit4(compiler, opcode, target, left, right);
+
+    compiler->next_register = mark;
+}
+
+static void compile_logical(struct sk_register_compiler *compiler, const struct sk_ast_node *node, const uint8_t target)
+{
+    // The left operand is stored before the right one is evaluated, so a local target would be clobbered too early.
+    const size_t mark = compiler->next_register;
+    const uint8_t result = is_local_register(compiler, target) ? alloc_register(compiler) : target;
+    const uint8_t instruction = node->as.binary.operator.type == SK_TOKEN_AND ? SK_ROP_JMP_FALSE : SK_ROP_JMP_TRUE;
+
+    compile_expression(compiler, node->as.binary.left, result);
+    const size_t jmp_offset = emit_jmp_register(compiler, instruction, result);
+    compile_expression(compiler, node->as.binary.right, result);
+    patch_jmp(compiler, jmp_offset);
+
+    emit_move(compiler, target, result);
+    compiler->next_register = mark;
+}
+
+static void compile_unary(struct sk_register_compiler *compiler, const struct sk_ast_node *node, const uint8_t target)
+{
+    if (node->as.unary.operator.type == SK_TOKEN_PLUS) {
+        // Unary plus preserves the operand; no bytecode is needed.
+        compile_expression(compiler, node->as.unary.expression, target);
+        return;
+    }
+
+    const size_t mark = compiler->next_register;
+    const uint8_t operand = compile_operand(compiler, node->as.unary.expression);
+
+    switch (node->as.unary.operator.type) {
+        case SK_TOKEN_MINUS:
+            emit3(compiler, SK_ROP_NNEG, target, operand);
+            break;
+        case SK_TOKEN_NOT:
+            emit3(compiler, SK_ROP_NOT, target, operand);
+            break;
+        default:
+            compiler_error(compiler, "Unsupported unary operator.");
+            break;
+    }
+
+    compiler->next_register = mark;
+}
+
+static void compile_identifier(
+    struct sk_register_compiler *compiler,
+    const struct sk_ast_node *node,
+    const uint8_t target)
+{
+    const struct sk_ast_identifier *identifier = &node->as.identifier;
+
+    if (identifier->symbol == NULL) {
+        compiler_error(compiler, "Missing identifier symbol.");
+        return;
+    }
+
+    if (identifier->symbol->type == SK_SYMBOL_FN_OVERLOADS) {
+        emit_const(compiler, target, sk_fnptr_value(identifier->symbol->as.fn_overloads.overloads.fnptr));
+        return;
+    }
+
+    emit_move(compiler, target, local_register(compiler, identifier->symbol));
+}
+
+static void compile_assignment(
+    struct sk_register_compiler *compiler,
+    const struct sk_ast_node *node,
+    const uint8_t target)
+{
+    const struct sk_ast_assign *assign = &node->as.assign;
+
+    if (assign->symbol == NULL) {
+        compiler_error(compiler, "Missing local symbol.");
+        return;
+    }
+
+    const uint8_t slot = local_register(compiler, assign->symbol);
+    compile_expression(compiler, assign->expression, slot);
+    emit_move(compiler, target, slot);
+}
+
+static void compile_call(struct sk_register_compiler *compiler, const struct sk_ast_node *node, const uint8_t target)
+{
+    if (node->as.call.inlined != NULL) {
+        compile_inlined_call(compiler, node, target);
+        return;
+    }
+
+    const struct sk_ast_node_array *args = &node->as.call.args;
+    if (args->count > UINT8_MAX) {
+        compiler_error(compiler, "Too many arguments.");
+        return;
+    }
+
+    // The callee and its arguments need consecutive registers on top of all live ones. A target that is the most
+    // recently allocated temporary can double as the base, which saves the final move.
+    const size_t mark = compiler->next_register;
+    const bool reuse_target = !is_local_register(compiler, target) && (size_t)target + 1 == compiler->next_register;
+    const uint8_t base = reuse_target ? target : alloc_register(compiler);
+
+    compile_call_operands(compiler, node, SK_ROP_CALL, SK_ROP_CALL_DIRECT, base);
+    emit_move(compiler, target, base);
+
+    compiler->next_register = mark;
+}
+
+static void compile_tail_call(struct sk_register_compiler *compiler, const struct sk_ast_node *node)
+{
+    const struct sk_ast_node_array *args = &node->as.call.args;
+    if (args->count > UINT8_MAX) {
+        compiler_error(compiler, "Too many arguments.");
+        return;
+    }
+
+    const size_t mark = compiler->next_register;
+    const uint8_t base = alloc_register(compiler);
+    compile_call_operands(compiler, node, SK_ROP_TAIL_CALL, SK_ROP_TAIL_CALL_DIRECT, base);
+
+    compiler->next_register = mark;
+}
+
+// Fills `base` with the callee and the registers after it with the arguments, then emits the call. A function named
+// directly is encoded in the instruction instead, which leaves `base` unused.
+static void compile_call_operands(
+    struct sk_register_compiler *compiler,
+    const struct sk_ast_node *node,
+    const uint8_t opcode,
+    const uint8_t direct_opcode,
+    const uint8_t base)
+{
+    const struct sk_ast_node_array *args = &node->as.call.args;
+    sk_fnptr fnptr;
+    const bool direct = is_direct_call(node->as.call.callee, &fnptr);
+
+    if (!direct) {
+        compile_expression(compiler, node->as.call.callee, base);
+    }
+
+    for (size_t i = 0; i < args->count; i++) {
+        compile_expression(compiler, args->nodes[i], alloc_register(compiler));
+    }
+
+    if (direct) {
+        emit3(compiler, direct_opcode, base, (fnptr >> 8) & 0xFF);
+        emit2(compiler, fnptr & 0xFF, (uint8_t)args->count);
+        return;
+    }
+
+    emit3(compiler, opcode, base, (uint8_t)args->count);
+}
+
+static bool is_direct_call(const struct sk_ast_node *callee, sk_fnptr *fnptr)
+{
+    if (callee->type != SK_AST_IDENTIFIER || callee->as.identifier.symbol == NULL ||
+        callee->as.identifier.symbol->type != SK_SYMBOL_FN_OVERLOADS) {
+        return false;
+    }
+
+    *fnptr = callee->as.identifier.symbol->as.fn_overloads.overloads.fnptr;
+    return *fnptr <= UINT16_MAX;
+}
+
+// The inliner only accepts expressions without calls or assignments, so the parameters stay unchanged while the
+// expression reads them in place.
+static void compile_inlined_call(
+    struct sk_register_compiler *compiler,
+    const struct sk_ast_node *node,
+    const uint8_t target)
+{
+    const struct sk_ast_node_array *args = &node->as.call.args;
+    const size_t mark = compiler->next_register;
+
+    for (size_t i = 0; i < args->count; i++) {
+        alloc_register(compiler);
+    }
+
+    for (size_t i = 0; i < args->count; i++) {
+        compile_expression(compiler, args->nodes[i], (uint8_t)(mark + i));
+    }
+
+    const size_t register_base = compiler->register_base;
+    compiler->register_base = mark;
+    compile_expression(compiler, node->as.call.inlined, target);
+    compiler->register_base = register_base;
+
+    compiler->next_register = mark;
+}
+
+static uint8_t local_register(const struct sk_register_compiler *compiler, const struct sk_symbol *symbol)
+{
+    return (uint8_t)(compiler->register_base + symbol->as.local.slot);
+}
+
+static void compile_literal(struct sk_register_compiler *compiler, const struct sk_ast_node *node, const uint8_t target)
+{
+    const struct sk_ast_literal *literal = &node->as.literal;
+
+    switch (literal->token.type) {
+        case SK_TOKEN_TRUE:
+            emit2(compiler, SK_ROP_TRUE, target);
+            break;
+        case SK_TOKEN_FALSE:
+            emit2(compiler, SK_ROP_FALSE, target);
+            break;
+        case SK_TOKEN_NUMBER: {
+            const sk_number number = sk_ast_literal_number(literal);
+            emit_const(compiler, target, sk_number_value(number));
+            break;
+        }
+        case SK_TOKEN_STRING: {
+            const size_t index = sk_constant_table_add_string(
+                &compiler->program->constants,
+                &compiler->program->heap,
+                literal->token.start + 1,
+                literal->token.length - 2);
+            emit_const_index(compiler, target, index);
+            break;
+        }
+        default:
+            compiler_error(compiler, "Unsupported literal.");
+            break;
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef SKARD_SK_REGISTER_COMPILER_H
+#define SKARD_SK_REGISTER_COMPILER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "sk_parser.h"
+#include "sk_vm.h"
+
+// Compiles a checked AST into register bytecode (see sk_register_vm.h). The checker's local slots are used as
+// registers directly; temporaries are allocated above them. The frame size of every function (locals and
+// temporaries) is stored in its chunk's `locals_count`.
+struct sk_register_compiler {
+    struct sk_chunk *current_chunk;
+    struct sk_program *program;
+    size_t locals_count;
+    size_t next_register;
+    size_t max_registers;
+
+    // Offset added to the slots of the expression being compiled. An inlined call evaluates its arguments into
+    // temporaries and compiles the callee's expression with its parameters shifted onto them.
+    size_t register_base;
+    bool has_error;
+};
+
+bool sk_register_compiler_compile(
+    struct sk_register_compiler *compiler,
+    const struct sk_ast_node *node,
+    struct sk_program *program);
+
+#endif // SKARD_SK_REGISTER_COMPILER_H
@@ -0,0 +1,443 @@
+#include "sk_register_vm.h"
+
+#include <stdio.h>
+
+void sk_register_vm_init(struct sk_register_vm *vm)
+{
+    vm->program = NULL;
+    vm->frame_count = 0;
+}
+
+void sk_register_vm_free(const struct sk_register_vm *vm)
+{
+    (void)vm;
+}
+
+static enum sk_vm_result register_vm_loop(struct sk_register_vm *vm);
+static void register_vm_print(const struct sk_value *arguments);
+static void mark_register_vm_roots(struct sk_heap *heap, void *data);
+
+enum sk_vm_result sk_register_vm_run(struct sk_register_vm *vm, struct sk_program *program)
+{
+    vm->program = program;
+    const struct sk_compiled_function *entry = &program->functions.functions[program->entry];
+    if (entry->chunk.locals_count > SK_REGISTER_VM_STACK_SIZE) {
+        fprintf(stderr, "Stack overflow.\n");
+        return SK_VM_ERR;
+    }
+
+    vm->frames[0].function = entry;
+    vm->frames[0].ip = entry->chunk.code;
+    vm->frames[0].base = 0;
+    vm->frame_count = 1;
+
+    for (size_t i = 0; i < entry->chunk.locals_count; i++) {
+        vm->registers[i] = sk_nothing_value();
+    }
+
+    sk_heap_add_roots(&program->heap, (struct sk_gc_roots) {vm, mark_register_vm_roots});
+    const enum sk_vm_result result = register_vm_loop(vm);
+    sk_heap_remove_roots(&program->heap, vm);
+    return result;
+}
+
+// The register windows of the frames overlap and end with the locals of the innermost one. A call clears the locals
+// of the new window, so every register below that end holds a live value.
+static void mark_register_vm_roots(struct sk_heap *heap, void *data)
+{
+    struct sk_register_vm *vm = data;
+    const struct sk_vm_frame *frame = &vm->frames[vm->frame_count - 1];
+    const size_t end = frame->base + frame->function->chunk.locals_count;
+    for (size_t i = 0; i < end; i++) {
+        sk_gc_mark_value(heap, &vm->registers[i]);
+    }
+}
+
+#if defined(SK_VM_COMPUTED_GOTO) && (defined(__GNUC__) || defined(__clang__))
+#define SK_REGISTER_VM_THREADED_DISPATCH 1
+#else
+#define SK_REGISTER_VM_THREADED_DISPATCH 0
+#endif
+
+#if SK_REGISTER_VM_THREADED_DISPATCH
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#pragma GCC diagnostic ignored "-Woverride-init"
+#endif
+
+static enum sk_vm_result register_vm_loop(struct sk_register_vm *vm)
+{
+    struct sk_vm_frame *frame = &vm->frames[vm->frame_count - 1];
+    uint8_t *ip = frame->ip;
+    struct sk_value *registers = vm->registers + frame->base;
+    const struct sk_value *constants = vm->program->constants.values.array;
+    struct sk_heap *heap = &vm->program->heap;
+
+#define load_frame()                                                                                                   \
+    do {                                                                                                               \
+        frame = &vm->frames[vm->frame_count - 1];                                                                      \
+        ip = frame->ip;                                                                                                \
+        registers = vm->registers + frame->base;                                                                       \
+    } while (false)
+
+#define read_byte() (*ip++)
+#define read_short() (ip += 2, (uint16_t)(ip[-2] << 8 | ip[-1]))
+#define read_register() (registers[read_byte()])
+
+#define binary_number_op(make_value, operator)                                                                         \
+    do {                                                                                                               \
+        struct sk_value *destination = &read_register();                                                               \
+        const sk_number a = sk_as_number(read_register());                                                             \
+        const sk_number b = sk_as_number(read_register());                                                             \
+        *destination = make_value(a operator b);                                                                       \
+    } while (false)
+
+// Used for <= and >=, which the language defines as the negated strict comparison; this matters for NaN operands.
+#define negated_number_op(operator)                                                                                    \
+    do {                                                                                                               \
+        struct sk_value *destination = &read_register();                                                               \
+        const sk_number a = sk_as_number(read_register());                                                             \
+        const sk_number b = sk_as_number(read_register());                                                             \
+        *destination = sk_boolean_value(!(a operator b));                                                              \
+    } while (false)
+
+// Used for == and != on non-number operands, which are equal when their values are identical.
+#define identity_op(operator)                                                                                          \
+    do {                                                                                                               \
+        struct sk_value *destination = &read_register();                                                               \
+        const uint64_t a = read_register().bits;                                                                       \
+        const uint64_t b = read_register().bits;                                                                       \
+        *destination = sk_boolean_value(a operator b);                                                                 \
+    } while (false)
+
+// Enters `callee` in a window that starts after `slot`, where the arguments already sit. RETURN later replaces `slot`
+// with the result. Generic calls keep the function value in `slot`; direct calls leave it unused.
+#define call(slot, callee, count)                                                                                      \
+    do {                                                                                                               \
+        const size_t argument_count = (count);                                                                         \
+        const struct sk_compiled_function *function = (callee);                                                        \
+        struct sk_value *window = (slot) + 1;                                                                          \
+        if (vm->frame_count >= SK_REGISTER_VM_MAX_FRAMES ||                                                            \
+            window + function->chunk.locals_count > vm->registers + SK_REGISTER_VM_STACK_SIZE) {                       \
+            frame->ip = ip;                                                                                            \
+            fprintf(stderr, "Stack overflow.\n");                                                                      \
+            return SK_VM_ERR;                                                                                          \
+        }                                                                                                              \
+                                                                                                                       \
+        for (size_t i = argument_count; i < function->chunk.locals_count; i++) {                                       \
+            window[i] = sk_nothing_value();                                                                            \
+        }                                                                                                              \
+                                                                                                                       \
+        frame->ip = ip;                                                                                                \
+        frame = &vm->frames[vm->frame_count++];                                                                        \
+        frame->function = function;                                                                                    \
+        frame->ip = function->chunk.code;                                                                              \
+        frame->base = (size_t)(window - vm->registers);                                                                \
+                                                                                                                       \
+        ip = frame->ip;                                                                                                \
+        registers = window;                                                                                            \
+    } while (false)
+
+// Runs `callee` in the current frame, so only its window has to fit. The arguments after `slot` always sit above the
+// first registers, so copying them upwards never overwrites one early.
+#define tail_call(slot, callee, count)                                                                                 \
+    do {                                                                                                               \
+        const size_t argument_count = (count);                                                                         \
+        const struct sk_compiled_function *function = (callee);                                                        \
+        const struct sk_value *arguments = (slot) + 1;                                                                 \
+        if (registers + function->chunk.locals_count > vm->registers + SK_REGISTER_VM_STACK_SIZE) {                    \
+            frame->ip = ip;                                                                                            \
+            fprintf(stderr, "Stack overflow.\n");                                                                      \
+            return SK_VM_ERR;                                                                                          \
+        }                                                                                                              \
+                                                                                                                       \
+        for (size_t i = 0; i < argument_count; i++) {                                                                  \
+            registers[i] = arguments[i];                                                                               \
+        }                                                                                                              \
+                                                                                                                       \
+        for (size_t i = argument_count; i < function->chunk.locals_count; i++) {                                       \
+            registers[i] = sk_nothing_value();                                                                         \
+        }                                                                                                              \
+                                                                                                                       \
+        frame->function = function;                                                                                    \
+        ip = function->chunk.code;                                                                                     \
+    } while (false)
+
+#define function_at(fnptr) (&vm->program->functions.functions[(fnptr)])
+
+#if SK_REGISTER_VM_THREADED_DISPATCH
+    static const void *const dispatch_table[UINT8_MAX + 1] = {
+        [0 ... UINT8_MAX] = &&vm_invalid,
+        [SK_ROP_HALT] = &&op_SK_ROP_HALT,
+        [SK_ROP_RETURN] = &&op_SK_ROP_RETURN,
+        [SK_ROP_PRINT] = &&op_SK_ROP_PRINT,
+        [SK_ROP_MOVE] = &&op_SK_ROP_MOVE,
+        [SK_ROP_NOTHING] = &&op_SK_ROP_NOTHING,
+        [SK_ROP_CONST] = &&op_SK_ROP_CONST,
+        [SK_ROP_CONST_WIDE] = &&op_SK_ROP_CONST_WIDE,
+        [SK_ROP_TRUE] = &&op_SK_ROP_TRUE,
+        [SK_ROP_FALSE] = &&op_SK_ROP_FALSE,
+        [SK_ROP_CALL] = &&op_SK_ROP_CALL,
+        [SK_ROP_CALL_DIRECT] = &&op_SK_ROP_CALL_DIRECT,
+        [SK_ROP_TAIL_CALL] = &&op_SK_ROP_TAIL_CALL,
+        [SK_ROP_TAIL_CALL_DIRECT] = &&op_SK_ROP_TAIL_CALL_DIRECT,
+        [SK_ROP_NNEG] = &&op_SK_ROP_NNEG,
+        [SK_ROP_NOT] = &&op_SK_ROP_NOT,
+        [SK_ROP_NADD] = &&op_SK_ROP_NADD,
+        [SK_ROP_NSUB] = &&op_SK_ROP_NSUB,
+        [SK_ROP_NMUL] = &&op_SK_ROP_NMUL,
+        [SK_ROP_NDIV] = &&op_SK_ROP_NDIV,
+        [SK_ROP_CONCAT] = &&op_SK_ROP_CONCAT,
+        [SK_ROP_NLESS] = &&op_SK_ROP_NLESS,
+        [SK_ROP_NLESS_EQUAL] = &&op_SK_ROP_NLESS_EQUAL,
+        [SK_ROP_NGREATER] = &&op_SK_ROP_NGREATER,
+        [SK_ROP_NGREATER_EQUAL] = &&op_SK_ROP_NGREATER_EQUAL,
+        [SK_ROP_NEQUAL] = &&op_SK_ROP_NEQUAL,
+        [SK_ROP_NNOT_EQUAL] = &&op_SK_ROP_NNOT_EQUAL,
+        [SK_ROP_EQUAL] = &&op_SK_ROP_EQUAL,
+        [SK_ROP_NOT_EQUAL] = &&op_SK_ROP_NOT_EQUAL,
+        [SK_ROP_JMP] = &&op_SK_ROP_JMP,
+        [SK_ROP_JMP_BACK] = &&op_SK_ROP_JMP_BACK,
+        [SK_ROP_JMP_TRUE] = &&op_SK_ROP_JMP_TRUE,
+        [SK_ROP_JMP_FALSE] = &&op_SK_ROP_JMP_FALSE,
+    };
+
+#define vm_dispatch() goto *dispatch_table[read_byte()];
+#define vm_case(opcode) op_##opcode
+#define vm_next() goto *dispatch_table[read_byte()]
+#define vm_default vm_invalid
+#else
+#define vm_dispatch() switch (read_byte())
+#define vm_case(opcode) case opcode
+#define vm_next() break
+#define vm_default default
+#endif
+
+    for (;;) {
+        vm_dispatch() {
+            vm_case(SK_ROP_HALT):
+                frame->ip = ip;
+                return SK_VM_OK;
+            vm_case(SK_ROP_RETURN): {
+                const struct sk_value result = read_register();
+                if (vm->frame_count == 1) {
+                    frame->ip = ip;
+                    return SK_VM_OK;
+                }
+
+                // The callee's window starts right after the register that held the callee.
+                registers[-1] = result;
+                vm->frame_count--;
+                load_frame();
+                vm_next();
+            }
+            vm_case(SK_ROP_PRINT): {
+                const struct sk_value *arguments = &read_register();
+                ip++; // The argument count is implied by the template.
+                register_vm_print(arguments);
+                vm_next();
+            }
+
+            vm_case(SK_ROP_MOVE): {
+                struct sk_value *destination = &read_register();
+                *destination = read_register();
+                vm_next();
+            }
+            vm_case(SK_ROP_NOTHING):
+                read_register() = sk_nothing_value();
+                vm_next();
+            vm_case(SK_ROP_CONST): {
+                struct sk_value *destination = &read_register();
+                *destination = constants[read_byte()];
+                vm_next();
+            }
+            vm_case(SK_ROP_CONST_WIDE): {
+                struct sk_value *destination = &read_register();
+                *destination = constants[read_short()];
+                vm_next();
+            }
+            vm_case(SK_ROP_TRUE):
+                read_register() = sk_boolean_true;
+                vm_next();
+            vm_case(SK_ROP_FALSE):
+                read_register() = sk_boolean_false;
+                vm_next();
+
+            vm_case(SK_ROP_CALL): {
+                struct sk_value *slot = &read_register();
+                const uint8_t count = read_byte();
+                call(slot, function_at(sk_as_fnptr(*slot)), count);
+                vm_next();
+            }
+            vm_case(SK_ROP_CALL_DIRECT): {
+                struct sk_value *slot = &read_register();
+                const uint16_t fnptr = read_short();
+                const uint8_t count = read_byte();
+                call(slot, function_at(fnptr), count);
+                vm_next();
+            }
+            vm_case(SK_ROP_TAIL_CALL): {
+                const struct sk_value *slot = &read_register();
+                const uint8_t count = read_byte();
+                tail_call(slot, function_at(sk_as_fnptr(*slot)), count);
+                vm_next();
+            }
+            vm_case(SK_ROP_TAIL_CALL_DIRECT): {
+                const struct sk_value *slot = &read_register();
+                const uint16_t fnptr = read_short();
+                const uint8_t count = read_byte();
+                tail_call(slot, function_at(fnptr), count);
+                vm_next();
+            }
+
+            vm_case(SK_ROP_NNEG): {
+                struct sk_value *destination = &read_register();
+                *destination = sk_number_value(-sk_as_number(read_register()));
+                vm_next();
+            }
+            vm_case(SK_ROP_NOT): {
+                struct sk_value *destination = &read_register();
+                *destination = sk_boolean_value(!sk_as_boolean(read_register()));
+                vm_next();
+            }
+
+            vm_case(SK_ROP_NADD):
+                binary_number_op(sk_number_value, +);
+                vm_next();
+            vm_case(SK_ROP_NSUB):
+                binary_number_op(sk_number_value, -);
+                vm_next();
+            vm_case(SK_ROP_NMUL):
+                binary_number_op(sk_number_value, *);
+                vm_next();
+            vm_case(SK_ROP_NDIV):
+                binary_number_op(sk_number_value, /);
+                vm_next();
+            vm_case(SK_ROP_CONCAT): {
+                // The operands stay in their registers, and so rooted, until the result has been allocated.
+                struct sk_value *destination = &read_register();
+                const struct sk_object_string *a = sk_as_string(read_register());
+                const struct sk_object_string *b = sk_as_string(read_register());
+                *destination = sk_object_value(sk_object_string_concat(heap, a, b));
+                vm_next();
+            }
+
+            vm_case(SK_ROP_NLESS):
+                binary_number_op(sk_boolean_value, <);
+                vm_next();
+            vm_case(SK_ROP_NLESS_EQUAL):
+                negated_number_op(>);
+                vm_next();
+            vm_case(SK_ROP_NGREATER):
+                binary_number_op(sk_boolean_value, >);
+                vm_next();
+            vm_case(SK_ROP_NGREATER_EQUAL):
+                negated_number_op(<);
+                vm_next();
+            vm_case(SK_ROP_NEQUAL):
+                binary_number_op(sk_boolean_value, ==);
+                vm_next();
+            vm_case(SK_ROP_NNOT_EQUAL):
+                binary_number_op(sk_boolean_value, !=);
+                vm_next();
+            vm_case(SK_ROP_EQUAL):
+                identity_op(==);
+                vm_next();
+            vm_case(SK_ROP_NOT_EQUAL):
+                identity_op(!=);
+                vm_next();
+
+            vm_case(SK_ROP_JMP): {
+                const uint16_t offset = read_short();
+                ip += offset;
+                vm_next();
+            }
+            vm_case(SK_ROP_JMP_BACK): {
+                const uint16_t offset = read_short();
+                ip -= offset;
+                // Registers need no syncing before a slice: the frames already describe every window.
+                if (heap->cycle != SK_GC_CYCLE_IDLE) {
+                    sk_gc_step(heap);
+                }
+
+                vm_next();
+            }
+            vm_case(SK_ROP_JMP_TRUE): {
+                const sk_bool a = sk_as_boolean(read_register());
+                const uint16_t offset = read_short();
+                if (a) {
+                    ip += offset;
+                }
+
+                vm_next();
+            }
+            vm_case(SK_ROP_JMP_FALSE): {
+                const sk_bool a = sk_as_boolean(read_register());
+                const uint16_t offset = read_short();
+                if (!a) {
+                    ip += offset;
+                }
+
+                vm_next();
+            }
+            vm_default:
+                frame->ip = ip;
+                fprintf(stderr, "Invalid instruction.\n");
+                return SK_VM_ERR;
+        }
+    }
+
+#undef vm_default
+#undef vm_next
+#undef vm_case
+#undef vm_dispatch
+#undef function_at
+#undef tail_call
+#undef call
+#undef identity_op
+#undef negated_number_op
+#undef binary_number_op
+#undef read_register
+#undef read_short
+#undef read_byte
+#undef load_frame
+}
+
+#if SK_REGISTER_VM_THREADED_DISPATCH
+#pragma GCC diagnostic pop
+#endif
+
+static void register_vm_print(const struct sk_value *arguments)
+{
+    const struct sk_object_string *template = sk_as_string(*arguments++);
+    for (size_t i = 0; i < template->length; i++) {
+        const char c = template->chars[i];
+        if (c == '%') {
+            // The following line is safe because the char on length + 1 is '\0'.
+            const char next_c = template->chars[++i];
+            switch (next_c) {
+                case 'n':
+                    sk_number_print(*arguments++);
+                    break;
+                case 'b':
+                    sk_boolean_print(*arguments++);
+                    break;
+                case 's':
+                    sk_string_print(*arguments++);
+                    break;
+                case 'f':
+                    sk_fnptr_print(*arguments++);
+                    break;
+                default:
+                    printf("INVALID");
+                    break;
+            }
+
+            continue;
+        }
+
+        printf("%c", c);
+    }
+
+    printf("\n");
+}
@@ -0,0 +1,70 @@
+#ifndef SKARD_SK_REGISTER_VM_H
+#define SKARD_SK_REGISTER_VM_H
+
+#include <stdint.h>
+
+#include "sk_value.h"
+#include "sk_vm.h"
+
+// Three-address register instruction set. Registers are slots of the current frame: the checker's local slots come
+// first and the compiler's temporaries follow them. Every register operand is one byte, constant operands are one byte
+// except in CONST_WIDE, and jump offsets are two bytes and relative to the end of the instruction.
+enum sk_register_opcode {
+    SK_ROP_HALT,
+    SK_ROP_RETURN, // RETURN src
+
+    SK_ROP_PRINT, // PRINT first count; the template is in `first`, the arguments follow it.
+
+    SK_ROP_MOVE, // MOVE dst src
+    SK_ROP_NOTHING, // NOTHING dst
+    SK_ROP_CONST, // CONST dst constant
+    SK_ROP_CONST_WIDE, // CONST_WIDE dst constant; the constant index takes two bytes.
+    SK_ROP_TRUE, // TRUE dst
+    SK_ROP_FALSE, // FALSE dst
+
+    SK_ROP_CALL, // CALL base count; the callee is in `base`, the arguments follow it and the result replaces it.
+    SK_ROP_CALL_DIRECT, // CALL_DIRECT base fnptr16 count; like CALL for a function the checker resolved by name.
+    SK_ROP_TAIL_CALL, // TAIL_CALL base count; like CALL, but the callee replaces the current frame.
+    SK_ROP_TAIL_CALL_DIRECT, // TAIL_CALL_DIRECT base fnptr16 count
+
+    SK_ROP_NNEG, // NNEG dst src
+    SK_ROP_NOT, // NOT dst src
+
+    SK_ROP_NADD, // NADD dst src1 src2
+    SK_ROP_NSUB,
+    SK_ROP_NMUL,
+    SK_ROP_NDIV,
+    SK_ROP_CONCAT, // CONCAT dst src1 src2; allocates a new young string.
+
+    SK_ROP_NLESS, // NLESS dst src1 src2
+    SK_ROP_NLESS_EQUAL,
+    SK_ROP_NGREATER,
+    SK_ROP_NGREATER_EQUAL,
+    SK_ROP_NEQUAL,
+    SK_ROP_NNOT_EQUAL,
+    SK_ROP_EQUAL, // EQUAL dst src1 src2; for non-number operands, which are equal when their values are identical.
+    SK_ROP_NOT_EQUAL,
+
+    SK_ROP_JMP, // JMP offset
+    SK_ROP_JMP_BACK, // JMP_BACK offset
+    SK_ROP_JMP_TRUE, // JMP_TRUE src offset
+    SK_ROP_JMP_FALSE, // JMP_FALSE src offset
+};
+
+#define SK_REGISTER_VM_MAX_REGISTERS (UINT8_MAX + 1)
+#define SK_REGISTER_VM_STACK_SIZE 4096
+#define SK_REGISTER_VM_MAX_FRAMES 256
+
+struct sk_register_vm {
+    struct sk_value registers[SK_REGISTER_VM_STACK_SIZE];
+    struct sk_program *program;
+    struct sk_vm_frame frames[SK_REGISTER_VM_MAX_FRAMES];
+    size_t frame_count;
+};
+
+void sk_register_vm_init(struct sk_register_vm *vm);
+void sk_register_vm_free(const struct sk_register_vm *vm);
+
+enum sk_vm_result sk_register_vm_run(struct sk_register_vm *vm, struct sk_program *program);
+
+#endif // SKARD_SK_REGISTER_VM_H
@@ -3,6 +3,12 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef SK_VALUE_CHECKED
+#include <assert.h>
+#endif
 
 #include "sk_object.h"
 
@@ -13,32 +19,95 @@ typedef struct sk_object sk_object;
 
 sk_number sk_number_from_string(const char *str, size_t length);
 
+// A value is NaN-boxed into a single 64-bit word. Numbers are stored as their own bits. Every other type lives inside
+// the quiet NaNs with bit 50 set, which arithmetic never produces on the supported targets: the sign bit marks object
+// pointers, bits 48-49 tell function pointers from the nothing and boolean singletons, and the low 48 bits hold the
+// payload. This relies on object pointers fitting in 48 bits, as they do on x86-64 and AArch64.
 struct sk_value {
-    union {
-        sk_number number;
-        sk_bool boolean;
-        sk_fnptr fnptr;
-
-        sk_object *object;
-    } as;
+    uint64_t bits;
 };
 
-#define sk_as_number(value) (value.as.number)
-#define sk_as_boolean(value) (value.as.boolean)
-#define sk_as_fnptr(value) (value.as.fnptr)
+#define SK_VALUE_SIGN_BIT ((uint64_t)1 << 63)
+#define SK_VALUE_QNAN ((uint64_t)0x7FFC000000000000)
+#define SK_VALUE_TAG_MASK ((uint64_t)3 << 48)
+#define SK_VALUE_TAG_FNPTR ((uint64_t)1 << 48)
+#define SK_VALUE_PAYLOAD_MASK (((uint64_t)1 << 48) - 1)
+
+#define SK_VALUE_NOTHING (SK_VALUE_QNAN | 1)
+#define SK_VALUE_FALSE (SK_VALUE_QNAN | 2)
+#define SK_VALUE_TRUE (SK_VALUE_QNAN | 3)
+
+#define sk_is_number(value) (((value).bits & SK_VALUE_QNAN) != SK_VALUE_QNAN)
+#define sk_is_nothing(value) ((value).bits == SK_VALUE_NOTHING)
+#define sk_is_boolean(value) (((value).bits | 1) == SK_VALUE_TRUE)
+#define sk_is_fnptr(value) (((value).bits & (SK_VALUE_SIGN_BIT | SK_VALUE_QNAN | SK_VALUE_TAG_MASK)) == \
+                            (SK_VALUE_QNAN | SK_VALUE_TAG_FNPTR))
+#define sk_is_object(value) (((value).bits & (SK_VALUE_SIGN_BIT | SK_VALUE_QNAN)) == \
+                             (SK_VALUE_SIGN_BIT | SK_VALUE_QNAN))
+
+// Builds with SK_VALUE_CHECKED assert that every value is read as the type it holds.
+#ifdef SK_VALUE_CHECKED
+#define sk_value_check(condition) assert(condition)
+#else
+#define sk_value_check(condition) ((void)0)
+#endif
+
+static inline sk_number sk_as_number(const struct sk_value value)
+{
+    sk_value_check(sk_is_number(value));
+    sk_number number;
+    memcpy(&number, &value.bits, sizeof number);
+    return number;
+}
 
-#define sk_as_string(value) ((struct sk_object_string *)value.as.object)
+static inline sk_bool sk_as_boolean(const struct sk_value value)
+{
+    sk_value_check(sk_is_boolean(value));
+    return value.bits == SK_VALUE_TRUE;
+}
+
+static inline sk_fnptr sk_as_fnptr(const struct sk_value value)
+{
+    sk_value_check(sk_is_fnptr(value));
+    return (sk_fnptr)(value.bits & SK_VALUE_PAYLOAD_MASK);
+}
+
+static inline sk_object *sk_as_object(const struct sk_value value)
+{
+    sk_value_check(sk_is_object(value));
+    return (sk_object *)(uintptr_t)(value.bits & SK_VALUE_PAYLOAD_MASK);
+}
+
+#define sk_as_string(value) ((struct sk_object_string *)sk_as_object(value))
 #define sk_as_cstring(value) (sk_as_string(value))->chars
 
-#define sk_nothing_value() ((struct sk_value) {0})
-#define sk_number_value(value) ((struct sk_value) {.as.number = (value)})
-#define sk_boolean_value(value) ((struct sk_value) {.as.boolean = (value)})
-#define sk_fnptr_value(value) ((struct sk_value) {.as.fnptr = (value)})
+static inline struct sk_value sk_number_value(const sk_number number)
+{
+    struct sk_value value;
+    memcpy(&value.bits, &number, sizeof value.bits);
+    return value;
+}
+
+static inline struct sk_value sk_boolean_value(const sk_bool boolean)
+{
+    return (struct sk_value) {SK_VALUE_FALSE | (uint64_t)(boolean != false)};
+}
+
+static inline struct sk_value sk_fnptr_value(const sk_fnptr fnptr)
+{
+    return (struct sk_value) {SK_VALUE_QNAN | SK_VALUE_TAG_FNPTR | (uint64_t)fnptr};
+}
+
+static inline struct sk_value sk_object_pointer_value(const sk_object *object)
+{
+    return (struct sk_value) {SK_VALUE_SIGN_BIT | SK_VALUE_QNAN | (uint64_t)(uintptr_t)object};
+}
 
-#define sk_object_value(value) ((struct sk_value) {.as.object = (sk_object *)(value)})
+#define sk_nothing_value() ((struct sk_value) {SK_VALUE_NOTHING})
+#define sk_object_value(object) sk_object_pointer_value((const sk_object *)(object))
 
-#define sk_boolean_true sk_boolean_value(true)
-#define sk_boolean_false sk_boolean_value(false)
+#define sk_boolean_true ((struct sk_value) {SK_VALUE_TRUE})
+#define sk_boolean_false ((struct sk_value) {SK_VALUE_FALSE})
 
 void sk_number_print(struct sk_value value);
 void sk_boolean_print(struct sk_value value);
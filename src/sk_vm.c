@@ -1,14 +1,31 @@
 #include "sk_vm.h"
 
+#include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "sk_memory.h"
 
+static uint8_t wide_opcode(uint8_t opcode);
+static ptrdiff_t stack_effect(const uint8_t *instruction);
+static size_t jump_target(const uint8_t *code, size_t offset);
+static uint64_t constant_bits(struct sk_value constant);
+static size_t constant_hash(uint64_t bits);
+static uint32_t *find_constant_slot(const struct sk_constant_table *table, uint64_t bits);
+static void grow_constant_slots(struct sk_constant_table *table);
+static void print_cache_free(struct sk_print_cache *cache);
+static void mark_program_roots(struct sk_heap *heap, void *data);
+static void parse_print_template(struct sk_print_template *template, const struct sk_object_string *source);
+static void add_print_segment(
+    struct sk_print_template *template,
+    const char *text,
+    size_t length,
+    const char *conversion);
+
 void sk_chunk_init(struct sk_chunk *chunk)
 {
-    sk_value_array_init(&chunk->constants);
-
     chunk->locals_count = 0;
+    chunk->frame_size = 0;
 
     chunk->code = NULL;
     chunk->capacity = 0;
@@ -17,8 +34,6 @@ void sk_chunk_init(struct sk_chunk *chunk)
 
 void sk_chunk_free(struct sk_chunk *chunk)
 {
-    sk_value_array_free(&chunk->constants);
-
     sk_free(chunk->code);
     sk_chunk_init(chunk);
 }
@@ -34,14 +49,288 @@ void sk_chunk_add(struct sk_chunk *chunk, const uint8_t byte)
     chunk->count++;
 }
 
-void sk_chunk_add_const(struct sk_chunk *chunk, const struct sk_value constant)
+// Appends `opcode operand`, switching to the _WIDE form of the opcode when the operand does not fit in one byte.
+// Returns false when it does not fit in two bytes either.
+bool sk_chunk_add_with_operand(struct sk_chunk *chunk, const uint8_t opcode, const size_t operand)
 {
-    sk_value_array_add(&chunk->constants, constant);
-    const size_t index = chunk->constants.count - 1;
+    if (operand <= UINT8_MAX) {
+        sk_chunk_add(chunk, opcode);
+        sk_chunk_add(chunk, (uint8_t)operand);
+        return true;
+    }
+
+    if (operand > SK_CHUNK_MAX_OPERAND) {
+        return false;
+    }
+
+    sk_chunk_add(chunk, wide_opcode(opcode));
+    sk_chunk_add(chunk, (operand >> 8) & 0xFF);
+    sk_chunk_add(chunk, operand & 0xFF);
+    return true;
+}
 
-    sk_chunk_add(chunk, SK_OP_CONST);
-    // FIXME: This can currently fail with index greater than a UINT8_MAX.
-    sk_chunk_add(chunk, index);
+static uint8_t wide_opcode(const uint8_t opcode)
+{
+    switch (opcode) {
+        case SK_OP_CONST:
+            return SK_OP_CONST_WIDE;
+        case SK_OP_LOAD_LOCAL:
+            return SK_OP_LOAD_LOCAL_WIDE;
+        case SK_OP_STORE_LOCAL:
+            return SK_OP_STORE_LOCAL_WIDE;
+        case SK_OP_CALL:
+            return SK_OP_CALL_WIDE;
+        case SK_OP_TAIL_CALL:
+            return SK_OP_TAIL_CALL_WIDE;
+        default:
+            return opcode;
+    }
+}
+
+// Walks every path through the chunk and returns the highest number of values its operand stack can hold. The compiler
+// keeps the depth at each instruction the same on every path that reaches it, so each instruction is visited once.
+size_t sk_chunk_max_stack_depth(const struct sk_chunk *chunk)
+{
+    if (chunk->count == 0) {
+        return 0;
+    }
+
+    // The depth before each instruction plus one, so that zero marks the instructions not reached yet.
+    size_t *depths = sk_realloc((size_t *)NULL, chunk->count);
+    memset(depths, 0, chunk->count * sizeof *depths);
+    size_t *worklist = sk_realloc((size_t *)NULL, chunk->count);
+    size_t worklist_count = 0;
+    size_t max_depth = 0;
+
+    depths[0] = 1;
+    worklist[worklist_count++] = 0;
+    while (worklist_count > 0) {
+        size_t offset = worklist[--worklist_count];
+        for (;;) {
+            const uint8_t opcode = chunk->code[offset];
+            const ptrdiff_t depth = (ptrdiff_t)depths[offset] - 1 + stack_effect(&chunk->code[offset]);
+            const size_t next_depth = depth > 0 ? (size_t)depth : 0;
+            max_depth = next_depth > max_depth ? next_depth : max_depth;
+
+            if (opcode == SK_OP_RETURN || opcode == SK_OP_TAIL_CALL || opcode == SK_OP_TAIL_CALL_WIDE ||
+                opcode == SK_OP_TAIL_CALL_DIRECT || opcode == SK_OP_HALT) {
+                break;
+            }
+
+            const bool is_jump = opcode == SK_OP_JMP || opcode == SK_OP_JMP_BACK || opcode == SK_OP_JMP_TRUE ||
+                                 opcode == SK_OP_JMP_FALSE || sk_opcode_is_compare_jump(opcode);
+            if (is_jump) {
+                const size_t target = jump_target(chunk->code, offset);
+                if (target < chunk->count && depths[target] == 0) {
+                    depths[target] = next_depth + 1;
+                    worklist[worklist_count++] = target;
+                }
+
+                if (opcode == SK_OP_JMP || opcode == SK_OP_JMP_BACK) {
+                    break;
+                }
+            }
+
+            offset += sk_opcode_length(opcode);
+            if (offset >= chunk->count || depths[offset] != 0) {
+                break;
+            }
+
+            depths[offset] = next_depth + 1;
+        }
+    }
+
+    sk_free(worklist);
+    sk_free(depths);
+    return max_depth;
+}
+
+// Returns how many values the instruction pushes minus how many it pops.
+static ptrdiff_t stack_effect(const uint8_t *instruction)
+{
+    switch (instruction[0]) {
+        case SK_OP_NOTHING:
+        case SK_OP_CONST:
+        case SK_OP_CONST_WIDE:
+        case SK_OP_LOAD_LOCAL:
+        case SK_OP_LOAD_LOCAL_WIDE:
+        case SK_OP_TRUE:
+        case SK_OP_FALSE:
+            return 1;
+        case SK_OP_RETURN:
+        case SK_OP_POP:
+        case SK_OP_STORE_LOCAL:
+        case SK_OP_STORE_LOCAL_WIDE:
+        case SK_OP_NADD:
+        case SK_OP_NSUB:
+        case SK_OP_NMUL:
+        case SK_OP_NDIV:
+        case SK_OP_CONCAT:
+        case SK_OP_NLESS:
+        case SK_OP_NLESS_EQUAL:
+        case SK_OP_NGREATER:
+        case SK_OP_NGREATER_EQUAL:
+        case SK_OP_NEQUAL:
+        case SK_OP_NNOT_EQUAL:
+        case SK_OP_EQUAL:
+        case SK_OP_NOT_EQUAL:
+            return -1;
+        case SK_OP_PRINT:
+        case SK_OP_PRINT_CACHED:
+            return -(ptrdiff_t)instruction[1] - 1;
+        case SK_OP_CALL:
+            return -(ptrdiff_t)instruction[1];
+        case SK_OP_CALL_WIDE:
+            return -(ptrdiff_t)(instruction[1] << 8 | instruction[2]);
+        case SK_OP_CALL_DIRECT:
+            return 1 - (ptrdiff_t)instruction[3];
+        default:
+            return 0;
+    }
+}
+
+// Jump offsets are relative to the end of the jump instruction.
+static size_t jump_target(const uint8_t *code, const size_t offset)
+{
+    const uint8_t opcode = code[offset];
+    const size_t length = sk_opcode_length(opcode);
+    const size_t jump = (size_t)(code[offset + length - 2] << 8 | code[offset + length - 1]);
+    return opcode == SK_OP_JMP_BACK ? offset + length - jump : offset + length + jump;
+}
+
+size_t sk_opcode_length(const uint8_t opcode)
+{
+    switch (opcode) {
+        case SK_OP_CONST:
+        case SK_OP_LOAD_LOCAL:
+        case SK_OP_STORE_LOCAL:
+        case SK_OP_CALL:
+        case SK_OP_TAIL_CALL:
+            return 2;
+        case SK_OP_CONST_WIDE:
+        case SK_OP_LOAD_LOCAL_WIDE:
+        case SK_OP_STORE_LOCAL_WIDE:
+        case SK_OP_CALL_WIDE:
+        case SK_OP_TAIL_CALL_WIDE:
+        case SK_OP_JMP:
+        case SK_OP_JMP_BACK:
+        case SK_OP_JMP_TRUE:
+        case SK_OP_JMP_FALSE:
+            return 3;
+        case SK_OP_PRINT:
+        case SK_OP_PRINT_CACHED:
+        case SK_OP_CALL_DIRECT:
+        case SK_OP_TAIL_CALL_DIRECT:
+            return 4;
+        default:
+            return sk_opcode_is_compare_jump(opcode) ? 5 : 1;
+    }
+}
+
+bool sk_opcode_is_compare_jump(const uint8_t opcode)
+{
+    return opcode >= SK_OP_JMP_IF_LESS_LOCALS && opcode <= SK_OP_JMP_IF_NOT_EQUAL_LOCAL_CONST;
+}
+
+void sk_constant_table_init(struct sk_constant_table *table)
+{
+    sk_value_array_init(&table->values);
+    table->slots = NULL;
+    table->slots_capacity = 0;
+}
+
+void sk_constant_table_free(struct sk_constant_table *table)
+{
+    sk_value_array_free(&table->values);
+    sk_free(table->slots);
+    sk_constant_table_init(table);
+}
+
+bool sk_constant_table_find(const struct sk_constant_table *table, const struct sk_value constant, size_t *index)
+{
+    if (table->slots_capacity == 0) {
+        return false;
+    }
+
+    const uint32_t slot = *find_constant_slot(table, constant_bits(constant));
+    if (slot == 0) {
+        return false;
+    }
+
+    *index = slot - 1;
+    return true;
+}
+
+// Returns the index of `constant`, adding it only if no constant with the same bits is there yet.
+size_t sk_constant_table_add(struct sk_constant_table *table, const struct sk_value constant)
+{
+    if ((table->values.count + 1) * 4 > table->slots_capacity * 3) {
+        grow_constant_slots(table);
+    }
+
+    uint32_t *slot = find_constant_slot(table, constant_bits(constant));
+    if (*slot == 0) {
+        sk_value_array_add(&table->values, constant);
+        *slot = (uint32_t)table->values.count;
+    }
+
+    return *slot - 1;
+}
+
+// Returns the index of the string constant with these contents. Constants live as long as the program, so they skip
+// the nursery.
+size_t sk_constant_table_add_string(
+    struct sk_constant_table *table,
+    struct sk_heap *heap,
+    const char *chars,
+    const size_t length)
+{
+    return sk_constant_table_add(table, sk_object_value(sk_object_string_from_chars(heap, SK_GC_OLD, chars, length)));
+}
+
+// Numbers compare by their bits, so -0 and 0 stay apart while every NaN literal shares one constant.
+static uint64_t constant_bits(const struct sk_value constant)
+{
+    return constant.bits;
+}
+
+static size_t constant_hash(uint64_t bits)
+{
+    bits ^= bits >> 33;
+    bits *= 0xFF51AFD7ED558CCDULL;
+    bits ^= bits >> 33;
+    return (size_t)bits;
+}
+
+// Returns the slot that holds the constant with these bits, or the free slot where it belongs.
+static uint32_t *find_constant_slot(const struct sk_constant_table *table, const uint64_t bits)
+{
+    const size_t mask = table->slots_capacity - 1;
+    for (size_t i = constant_hash(bits) & mask;; i = (i + 1) & mask) {
+        uint32_t *slot = &table->slots[i];
+        if (*slot == 0 || constant_bits(table->values.array[*slot - 1]) == bits) {
+            return slot;
+        }
+    }
+}
+
+static void grow_constant_slots(struct sk_constant_table *table)
+{
+    const size_t capacity = table->slots_capacity < 16 ? 16 : 2 * table->slots_capacity;
+    sk_free(table->slots);
+    table->slots = sk_realloc((uint32_t *)NULL, capacity);
+    table->slots_capacity = capacity;
+    memset(table->slots, 0, capacity * sizeof *table->slots);
+
+    const size_t mask = capacity - 1;
+    for (size_t index = 0; index < table->values.count; index++) {
+        size_t i = constant_hash(constant_bits(table->values.array[index])) & mask;
+        while (table->slots[i] != 0) {
+            i = (i + 1) & mask;
+        }
+
+        table->slots[i] = (uint32_t)(index + 1);
+    }
 }
 
 void sk_program_init(struct sk_program *program)
@@ -49,6 +338,12 @@ void sk_program_init(struct sk_program *program)
     program->functions.functions = NULL;
     program->functions.capacity = 0;
     program->functions.count = 0;
+    sk_constant_table_init(&program->constants);
+    program->print_cache.templates = NULL;
+    program->print_cache.capacity = 0;
+    program->print_cache.count = 0;
+    sk_heap_init(&program->heap);
+    sk_heap_add_roots(&program->heap, (struct sk_gc_roots) {program, mark_program_roots});
     program->entry = 0;
 }
 
@@ -59,9 +354,86 @@ void sk_program_free(struct sk_program *program)
     }
 
     sk_free(program->functions.functions);
+    sk_constant_table_free(&program->constants);
+    print_cache_free(&program->print_cache);
+    sk_heap_free(&program->heap);
     sk_program_init(program);
 }
 
+static void print_cache_free(struct sk_print_cache *cache)
+{
+    for (size_t i = 0; i < cache->count; i++) {
+        sk_free(cache->templates[i].segments);
+    }
+
+    sk_free(cache->templates);
+}
+
+// A cached template is compared with later templates by identity, so it must not be freed and reallocated under it.
+// When a minor collection moves it, its segments move along with the characters they point into.
+static void mark_program_roots(struct sk_heap *heap, void *data)
+{
+    struct sk_program *program = data;
+    for (size_t i = 0; i < program->constants.values.count; i++) {
+        sk_gc_mark_value(heap, &program->constants.values.array[i]);
+    }
+
+    for (size_t i = 0; i < program->print_cache.count; i++) {
+        struct sk_print_template *template = &program->print_cache.templates[i];
+        struct sk_object *source = (struct sk_object *)template->source;
+        sk_gc_mark_object(heap, &source);
+
+        const struct sk_object_string *moved = (const struct sk_object_string *)source;
+        if (moved != template->source) {
+            for (size_t j = 0; j < template->count; j++) {
+                template->segments[j].text = moved->chars + (template->segments[j].text - template->source->chars);
+            }
+
+            template->source = moved;
+        }
+    }
+}
+
+// The segments point into the template, which the print cache keeps alive as long as the program.
+static void parse_print_template(struct sk_print_template *template, const struct sk_object_string *source)
+{
+    template->source = source;
+    template->count = 0;
+
+    size_t start = 0;
+    for (size_t i = 0; i < source->length; i++) {
+        if (source->chars[i] == '%') {
+            // The conversion of a `%` at the very end is the terminating '\0', which prints as an invalid one.
+            add_print_segment(template, source->chars + start, i - start, &source->chars[i + 1]);
+            i++;
+            start = i + 1;
+        }
+    }
+
+    if (start < source->length) {
+        add_print_segment(template, source->chars + start, source->length - start, NULL);
+    }
+}
+
+static void add_print_segment(
+    struct sk_print_template *template,
+    const char *text,
+    const size_t length,
+    const char *conversion)
+{
+    if (template->count >= template->capacity) {
+        template->capacity = sk_grow(template->capacity);
+        template->segments = sk_realloc(template->segments, template->capacity);
+    }
+
+    template->segments[template->count++] = (struct sk_print_segment) {
+        .text = text,
+        .length = length,
+        .has_conversion = conversion != NULL,
+        .conversion = conversion != NULL ? *conversion : '\0',
+    };
+}
+
 struct sk_compiled_function *sk_program_add_function(struct sk_program *program, const sk_fnptr fnptr)
 {
     if (fnptr >= program->functions.capacity) {
@@ -86,14 +458,27 @@ struct sk_compiled_function *sk_program_add_function(struct sk_program *program,
     return &program->functions.functions[fnptr];
 }
 
+struct sk_gc_stats sk_program_gc_stats(const struct sk_program *program)
+{
+    return sk_heap_stats(&program->heap);
+}
+
+#define VM_INITIAL_STACK_SIZE 256
+#define VM_INITIAL_FRAMES 64
+
 void sk_vm_stack_init(struct sk_vm_stack *stack)
 {
+    stack->stack = sk_realloc((struct sk_value *)NULL, VM_INITIAL_STACK_SIZE);
     stack->top = stack->stack;
+    stack->capacity = VM_INITIAL_STACK_SIZE;
 }
 
-void sk_vm_stack_free(const struct sk_vm_stack *stack)
+void sk_vm_stack_free(struct sk_vm_stack *stack)
 {
-    (void)stack;
+    sk_free(stack->stack);
+    stack->stack = NULL;
+    stack->top = NULL;
+    stack->capacity = 0;
 }
 
 void sk_vm_stack_push(struct sk_vm_stack *stack, const struct sk_value value)
@@ -117,240 +502,642 @@ void sk_vm_init(struct sk_vm *vm)
 {
     sk_vm_stack_init(&vm->stack);
     vm->program = NULL;
+    vm->profiles = NULL;
+    vm->tier = NULL;
+    vm->frames = sk_realloc((struct sk_vm_frame *)NULL, VM_INITIAL_FRAMES);
     vm->frame_count = 0;
+    vm->frame_capacity = VM_INITIAL_FRAMES;
+    vm->max_stack_size = SK_VM_DEFAULT_MAX_STACK_SIZE;
+    vm->max_frames = SK_VM_DEFAULT_MAX_FRAMES;
 }
 
-void sk_vm_free(const struct sk_vm *vm)
+void sk_vm_free(struct sk_vm *vm)
 {
     sk_vm_stack_free(&vm->stack);
+    sk_free(vm->frames);
+    vm->frames = NULL;
+    vm->frame_capacity = 0;
+    sk_free(vm->profiles);
+    vm->profiles = NULL;
 }
 
 static enum sk_vm_result vm_loop(struct sk_vm *vm);
+static void mark_vm_roots(struct sk_heap *heap, void *data);
+static bool grow_stacks(struct sk_vm *vm, size_t stack_size, size_t frame_count);
+static uint8_t *tier_enter(
+    const struct sk_vm *vm,
+    struct sk_vm_profile *profile,
+    const struct sk_compiled_function *function,
+    uint8_t *ip,
+    struct sk_value *slots,
+    struct sk_value **sp);
 static void reserve_stack_slots(struct sk_vm *vm, size_t count);
-static void vm_print(struct sk_vm_stack *stack);
+static struct sk_value *vm_print(struct sk_value *top);
+static struct sk_value *vm_print_template(const struct sk_print_template *template, struct sk_value *top);
+static struct sk_value *print_conversion(char conversion, struct sk_value *top);
+static const struct sk_print_template *quicken_print(
+    struct sk_program *program,
+    uint8_t *instruction,
+    const struct sk_object_string *source);
 
 enum sk_vm_result sk_vm_run(struct sk_vm *vm, struct sk_program *program)
 {
     vm->program = program;
     const struct sk_compiled_function *entry = &program->functions.functions[program->entry];
+    if (!grow_stacks(vm, entry->chunk.frame_size, 1)) {
+        fprintf(stderr, "Stack overflow.\n");
+        return SK_VM_ERR;
+    }
+
+    sk_free(vm->profiles);
+    vm->profiles = sk_allocs(program->functions.count * sizeof *vm->profiles);
+    for (size_t i = 0; i < program->functions.count; i++) {
+        vm->profiles[i] = (struct sk_vm_profile) {0, 0, SK_VM_TIER_BASELINE};
+    }
+
     vm->frames[0].function = entry;
     vm->frames[0].ip = entry->chunk.code;
     vm->frames[0].base = 0;
+    vm->frames[0].result = 0;
     vm->frame_count = 1;
 
     reserve_stack_slots(vm, entry->chunk.locals_count);
 
-    return vm_loop(vm);
+    sk_heap_add_roots(&program->heap, (struct sk_gc_roots) {vm, mark_vm_roots});
+    const enum sk_vm_result result = vm_loop(vm);
+    sk_heap_remove_roots(&program->heap, vm);
+    return result;
+}
+
+// Every live value of the VM is on its stack below `top`: the frames only point at functions, whose constants are
+// roots of the program. An instruction that allocates must therefore store its frame first.
+static void mark_vm_roots(struct sk_heap *heap, void *data)
+{
+    const struct sk_vm *vm = data;
+    for (struct sk_value *value = vm->stack.stack; value < vm->stack.top; value++) {
+        sk_gc_mark_value(heap, value);
+    }
 }
 
+// Threaded dispatch relies on the GNU "labels as values" extension. Every handler ends with its own indirect jump,
+// which gives the branch predictor one jump site per opcode instead of the single shared site of a switch.
+#if defined(SK_VM_COMPUTED_GOTO) && (defined(__GNUC__) || defined(__clang__))
+#define SK_VM_THREADED_DISPATCH 1
+#else
+#define SK_VM_THREADED_DISPATCH 0
+#endif
+
+#if SK_VM_THREADED_DISPATCH
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#pragma GCC diagnostic ignored "-Woverride-init"
+#endif
+
 static enum sk_vm_result vm_loop(struct sk_vm *vm)
 {
-#define frame() (&vm->frames[vm->frame_count - 1])
-#define read_byte() *frame()->ip++
-#define read_const() sk_value_array_get(&frame()->function->chunk.constants, read_byte())
-#define read_short() (frame()->ip += 2, (uint16_t)(frame()->ip[-2] << 8 | frame()->ip[-1]))
+    // The interpreter state of the current frame lives in locals so that the compiler can keep it in registers. It is
+    // written back to vm->frames and vm->stack only when the current frame changes or the loop exits.
+    struct sk_vm_frame *frame = &vm->frames[vm->frame_count - 1];
+    uint8_t *ip = frame->ip;
+    struct sk_value *slots = vm->stack.stack + frame->base;
+    struct sk_value *sp = vm->stack.top;
+    const struct sk_value *stack_end = vm->stack.stack + vm->stack.capacity;
+    const struct sk_value *constants = vm->program->constants.values.array;
+    const struct sk_compiled_function *functions = vm->program->functions.functions;
+    struct sk_heap *heap = &vm->program->heap;
+
+#define load_frame()                                                                                                   \
+    do {                                                                                                               \
+        frame = &vm->frames[vm->frame_count - 1];                                                                      \
+        ip = frame->ip;                                                                                                \
+        slots = vm->stack.stack + frame->base;                                                                         \
+    } while (false)
+#define store_frame()                                                                                                  \
+    do {                                                                                                               \
+        frame->ip = ip;                                                                                                \
+        vm->stack.top = sp;                                                                                            \
+    } while (false)
+
+// Counts an entry into the current function in `counter` of its profile and lets the tier continue from there.
+#define count_entry(counter)                                                                                           \
+    do {                                                                                                               \
+        struct sk_vm_profile *profile = &vm->profiles[frame->function - functions];                                    \
+        profile->counter++;                                                                                            \
+        if (vm->tier != NULL) {                                                                                        \
+            uint8_t *resume = tier_enter(vm, profile, frame->function, ip, slots, &sp);                                \
+            if (resume != NULL) {                                                                                      \
+                ip = resume;                                                                                           \
+            }                                                                                                          \
+        }                                                                                                              \
+    } while (false)
+// Returning into a promoted function continues in the tier as well.
+#define tier_resume()                                                                                                  \
+    do {                                                                                                               \
+        if (vm->tier != NULL && vm->profiles[frame->function - functions].tier == SK_VM_TIER_PROMOTED) {               \
+            uint8_t *resume = vm->tier->enter(vm->tier->data, frame->function, ip, slots, &sp);                        \
+            if (resume != NULL) {                                                                                      \
+                ip = resume;                                                                                           \
+            }                                                                                                          \
+        }                                                                                                              \
+    } while (false)
+
+#define read_byte() (*ip++)
+#define read_const() (constants[read_byte()])
+#define read_short() (ip += 2, (uint16_t)(ip[-2] << 8 | ip[-1]))
+
+// Compares a local with a second operand and jumps forward by the trailing offset when `condition` holds.
+#define compare_and_jump(second_operand, condition)                                                                    \
+    do {                                                                                                               \
+        const sk_number a = sk_as_number(slots[read_byte()]);                                                          \
+        const sk_number b = sk_as_number(second_operand);                                                              \
+        const uint16_t offset = read_short();                                                                          \
+        if (condition) {                                                                                               \
+            ip += offset;                                                                                              \
+        }                                                                                                              \
+    } while (false)
+
+// Enters `callee` with the `count` values on top of the stack as its first locals, so the arguments never move and
+// only the remaining locals are cleared. RETURN leaves the result `result_offset` slots below the new frame: generic
+// calls pass 1 to replace the function value under the arguments, direct calls pass 0. This is the only place where
+// the stacks are checked: a frame that does not fit grows them, and a frame beyond the limits is an error.
+#define call(callee, count, result_offset)                                                                             \
+    do {                                                                                                               \
+        const size_t argument_count = (count);                                                                         \
+        const struct sk_compiled_function *function = (callee);                                                        \
+        struct sk_value *base = sp - argument_count;                                                                   \
+                                                                                                                       \
+        if ((size_t)(stack_end - base) < function->chunk.frame_size || vm->frame_count == vm->frame_capacity) {        \
+            const size_t base_index = (size_t)(base - vm->stack.stack);                                                \
+            store_frame();                                                                                             \
+            if (!grow_stacks(vm, base_index + function->chunk.frame_size, vm->frame_count + 1)) {                      \
+                fprintf(stderr, "Stack overflow.\n");                                                                  \
+                return SK_VM_ERR;                                                                                      \
+            }                                                                                                          \
+                                                                                                                       \
+            load_frame();                                                                                              \
+            stack_end = vm->stack.stack + vm->stack.capacity;                                                          \
+            base = vm->stack.stack + base_index;                                                                       \
+        }                                                                                                              \
+                                                                                                                       \
+        for (size_t i = argument_count; i < function->chunk.locals_count; i++) {                                       \
+            base[i] = sk_nothing_value();                                                                              \
+        }                                                                                                              \
+                                                                                                                       \
+        frame->ip = ip;                                                                                                \
+        frame = &vm->frames[vm->frame_count++];                                                                        \
+        frame->function = function;                                                                                    \
+        frame->ip = function->chunk.code;                                                                              \
+        frame->base = (size_t)(base - vm->stack.stack);                                                                \
+        frame->result = frame->base - (result_offset);                                                                 \
+                                                                                                                       \
+        ip = frame->ip;                                                                                                \
+        slots = base;                                                                                                  \
+        sp = base + function->chunk.locals_count;                                                                      \
+        count_entry(calls);                                                                                            \
+    } while (false)
+
+// Replaces the current frame with a frame of `callee`. The arguments slide down over the current locals, so a chain of
+// tail calls runs in constant stack space, and the result still goes where the replaced frame would have left it. The
+// frame is checked and grown just like in `call`.
+#define tail_call(callee, count)                                                                                       \
+    do {                                                                                                               \
+        const size_t argument_count = (count);                                                                         \
+        const struct sk_compiled_function *function = (callee);                                                        \
+        struct sk_value *arguments = sp - argument_count;                                                              \
+                                                                                                                       \
+        if ((size_t)(stack_end - slots) < function->chunk.frame_size) {                                                \
+            const size_t arguments_index = (size_t)(arguments - vm->stack.stack);                                      \
+            store_frame();                                                                                             \
+            if (!grow_stacks(vm, frame->base + function->chunk.frame_size, vm->frame_count)) {                         \
+                fprintf(stderr, "Stack overflow.\n");                                                                  \
+                return SK_VM_ERR;                                                                                      \
+            }                                                                                                          \
+                                                                                                                       \
+            load_frame();                                                                                              \
+            stack_end = vm->stack.stack + vm->stack.capacity;                                                          \
+            arguments = vm->stack.stack + arguments_index;                                                             \
+        }                                                                                                              \
+                                                                                                                       \
+        for (size_t i = 0; i < argument_count; i++) {                                                                  \
+            slots[i] = arguments[i];                                                                                   \
+        }                                                                                                              \
+                                                                                                                       \
+        for (size_t i = argument_count; i < function->chunk.locals_count; i++) {                                       \
+            slots[i] = sk_nothing_value();                                                                             \
+        }                                                                                                              \
+                                                                                                                       \
+        frame->function = function;                                                                                    \
+        ip = function->chunk.code;                                                                                     \
+        sp = slots + function->chunk.locals_count;                                                                     \
+        count_entry(calls);                                                                                            \
+    } while (false)
+
+// The function of a generic call is the value under its `count` arguments.
+#define function_under(count) (&vm->program->functions.functions[sk_as_fnptr(sp[-(ptrdiff_t)(count) - 1])])
+#define function_at(fnptr) (&vm->program->functions.functions[(fnptr)])
 
-#define push(value) sk_vm_stack_push(&vm->stack, value)
-#define pop() sk_vm_stack_pop(&vm->stack)
-#define peek(depth) sk_vm_stack_peek(&vm->stack, (depth))
+#define push(value) (*sp++ = (value))
+#define pop() (*--sp)
+#define peek(depth) (sp[-(depth) - 1])
+
+#if SK_VM_THREADED_DISPATCH
+    static const void *const dispatch_table[UINT8_MAX + 1] = {
+        [0 ... UINT8_MAX] = &&vm_invalid,
+        [SK_OP_HALT] = &&op_SK_OP_HALT,
+        [SK_OP_RETURN] = &&op_SK_OP_RETURN,
+        [SK_OP_PRINT] = &&op_SK_OP_PRINT,
+        [SK_OP_PRINT_CACHED] = &&op_SK_OP_PRINT_CACHED,
+        [SK_OP_POP] = &&op_SK_OP_POP,
+        [SK_OP_NOTHING] = &&op_SK_OP_NOTHING,
+        [SK_OP_CONST] = &&op_SK_OP_CONST,
+        [SK_OP_CONST_WIDE] = &&op_SK_OP_CONST_WIDE,
+        [SK_OP_LOAD_LOCAL] = &&op_SK_OP_LOAD_LOCAL,
+        [SK_OP_LOAD_LOCAL_WIDE] = &&op_SK_OP_LOAD_LOCAL_WIDE,
+        [SK_OP_STORE_LOCAL] = &&op_SK_OP_STORE_LOCAL,
+        [SK_OP_STORE_LOCAL_WIDE] = &&op_SK_OP_STORE_LOCAL_WIDE,
+        [SK_OP_CALL] = &&op_SK_OP_CALL,
+        [SK_OP_CALL_WIDE] = &&op_SK_OP_CALL_WIDE,
+        [SK_OP_CALL_DIRECT] = &&op_SK_OP_CALL_DIRECT,
+        [SK_OP_TAIL_CALL] = &&op_SK_OP_TAIL_CALL,
+        [SK_OP_TAIL_CALL_WIDE] = &&op_SK_OP_TAIL_CALL_WIDE,
+        [SK_OP_TAIL_CALL_DIRECT] = &&op_SK_OP_TAIL_CALL_DIRECT,
+        [SK_OP_NNEG] = &&op_SK_OP_NNEG,
+        [SK_OP_NADD] = &&op_SK_OP_NADD,
+        [SK_OP_NSUB] = &&op_SK_OP_NSUB,
+        [SK_OP_NMUL] = &&op_SK_OP_NMUL,
+        [SK_OP_NDIV] = &&op_SK_OP_NDIV,
+        [SK_OP_CONCAT] = &&op_SK_OP_CONCAT,
+        [SK_OP_NLESS] = &&op_SK_OP_NLESS,
+        [SK_OP_NLESS_EQUAL] = &&op_SK_OP_NLESS_EQUAL,
+        [SK_OP_NGREATER] = &&op_SK_OP_NGREATER,
+        [SK_OP_NGREATER_EQUAL] = &&op_SK_OP_NGREATER_EQUAL,
+        [SK_OP_NEQUAL] = &&op_SK_OP_NEQUAL,
+        [SK_OP_NNOT_EQUAL] = &&op_SK_OP_NNOT_EQUAL,
+        [SK_OP_EQUAL] = &&op_SK_OP_EQUAL,
+        [SK_OP_NOT_EQUAL] = &&op_SK_OP_NOT_EQUAL,
+        [SK_OP_TRUE] = &&op_SK_OP_TRUE,
+        [SK_OP_FALSE] = &&op_SK_OP_FALSE,
+        [SK_OP_NOT] = &&op_SK_OP_NOT,
+        [SK_OP_JMP] = &&op_SK_OP_JMP,
+        [SK_OP_JMP_BACK] = &&op_SK_OP_JMP_BACK,
+        [SK_OP_JMP_TRUE] = &&op_SK_OP_JMP_TRUE,
+        [SK_OP_JMP_FALSE] = &&op_SK_OP_JMP_FALSE,
+        [SK_OP_JMP_IF_LESS_LOCALS] = &&op_SK_OP_JMP_IF_LESS_LOCALS,
+        [SK_OP_JMP_IF_NOT_LESS_LOCALS] = &&op_SK_OP_JMP_IF_NOT_LESS_LOCALS,
+        [SK_OP_JMP_IF_GREATER_LOCALS] = &&op_SK_OP_JMP_IF_GREATER_LOCALS,
+        [SK_OP_JMP_IF_NOT_GREATER_LOCALS] = &&op_SK_OP_JMP_IF_NOT_GREATER_LOCALS,
+        [SK_OP_JMP_IF_EQUAL_LOCALS] = &&op_SK_OP_JMP_IF_EQUAL_LOCALS,
+        [SK_OP_JMP_IF_NOT_EQUAL_LOCALS] = &&op_SK_OP_JMP_IF_NOT_EQUAL_LOCALS,
+        [SK_OP_JMP_IF_LESS_LOCAL_CONST] = &&op_SK_OP_JMP_IF_LESS_LOCAL_CONST,
+        [SK_OP_JMP_IF_NOT_LESS_LOCAL_CONST] = &&op_SK_OP_JMP_IF_NOT_LESS_LOCAL_CONST,
+        [SK_OP_JMP_IF_GREATER_LOCAL_CONST] = &&op_SK_OP_JMP_IF_GREATER_LOCAL_CONST,
+        [SK_OP_JMP_IF_NOT_GREATER_LOCAL_CONST] = &&op_SK_OP_JMP_IF_NOT_GREATER_LOCAL_CONST,
+        [SK_OP_JMP_IF_EQUAL_LOCAL_CONST] = &&op_SK_OP_JMP_IF_EQUAL_LOCAL_CONST,
+        [SK_OP_JMP_IF_NOT_EQUAL_LOCAL_CONST] = &&op_SK_OP_JMP_IF_NOT_EQUAL_LOCAL_CONST,
+    };
+
+#define vm_dispatch() goto *dispatch_table[read_byte()];
+#define vm_case(opcode) op_##opcode
+#define vm_next() goto *dispatch_table[read_byte()]
+#define vm_default vm_invalid
+#else
+#define vm_dispatch() switch (read_byte())
+#define vm_case(opcode) case opcode
+#define vm_next() break
+#define vm_default default
+#endif
 
     for (;;) {
-        switch (read_byte()) {
-            case SK_OP_HALT:
+        vm_dispatch() {
+            vm_case(SK_OP_HALT):
+                store_frame();
                 return SK_VM_OK;
-            case SK_OP_RETURN: {
+            vm_case(SK_OP_RETURN): {
                 const struct sk_value result = pop();
                 if (vm->frame_count == 1) {
+                    store_frame();
                     return SK_VM_OK;
                 }
 
-                const size_t call_base = vm->frames[vm->frame_count - 1].base;
+                sp = vm->stack.stack + frame->result;
                 vm->frame_count--;
-                vm->stack.top = vm->stack.stack + call_base;
+                load_frame();
                 push(result);
-                break;
+                tier_resume();
+                vm_next();
             }
-            case SK_OP_PRINT: {
-                vm_print(&vm->stack);
-                break;
+            vm_case(SK_OP_PRINT): {
+                // The argument count is only needed to size frames; the template says how many values to pop.
+                uint8_t *instruction = ip - 1;
+                ip += 3;
+                const struct sk_print_template *template = quicken_print(
+                    vm->program,
+                    instruction,
+                    sk_as_string(peek(0)));
+                sp = template != NULL ? vm_print_template(template, sp) : vm_print(sp);
+                vm_next();
             }
+            vm_case(SK_OP_PRINT_CACHED): {
+                ip++;
+                const struct sk_print_template *template = &vm->program->print_cache.templates[read_short()];
+                if (template->source != sk_as_string(peek(0))) {
+                    // The guard failed: print generically and let the next execution parse the new template.
+                    ip[-4] = SK_OP_PRINT;
+                    sp = vm_print(sp);
+                    vm_next();
+                }
 
-            case SK_OP_POP:
-                pop();
-                break;
+                sp = vm_print_template(template, sp);
+                vm_next();
+            }
+
+            vm_case(SK_OP_POP):
+                sp--;
+                vm_next();
 
-            case SK_OP_NOTHING:
+            vm_case(SK_OP_NOTHING):
                 push(sk_nothing_value());
-                break;
+                vm_next();
 
-            case SK_OP_CONST:
+            vm_case(SK_OP_CONST):
                 push(read_const());
-                break;
+                vm_next();
+            vm_case(SK_OP_CONST_WIDE):
+                push(constants[read_short()]);
+                vm_next();
 
-            case SK_OP_LOAD_LOCAL: {
+            vm_case(SK_OP_LOAD_LOCAL): {
                 const uint8_t slot = read_byte();
-                push(vm->stack.stack[frame()->base + slot]);
-                break;
+                push(slots[slot]);
+                vm_next();
+            }
+            vm_case(SK_OP_LOAD_LOCAL_WIDE): {
+                const uint16_t slot = read_short();
+                push(slots[slot]);
+                vm_next();
             }
 
-            case SK_OP_STORE_LOCAL: {
+            vm_case(SK_OP_STORE_LOCAL): {
                 const uint8_t slot = read_byte();
-                vm->stack.stack[frame()->base + slot] = pop();
-                break;
+                slots[slot] = pop();
+                vm_next();
+            }
+            vm_case(SK_OP_STORE_LOCAL_WIDE): {
+                const uint16_t slot = read_short();
+                slots[slot] = pop();
+                vm_next();
             }
 
-            case SK_OP_CALL: {
-                const uint8_t argument_count = read_byte();
-                const size_t call_base = (size_t)(vm->stack.top - vm->stack.stack) - argument_count - 1;
-                const sk_fnptr fnptr = sk_as_fnptr(vm->stack.stack[call_base]);
-                const struct sk_compiled_function *function = &vm->program->functions.functions[fnptr];
-
-                for (size_t i = 0; i < argument_count; i++) {
-                    vm->stack.stack[call_base + i] = vm->stack.stack[call_base + i + 1];
-                }
-
-                vm->frames[vm->frame_count].function = function;
-                vm->frames[vm->frame_count].ip = function->chunk.code;
-                vm->frames[vm->frame_count].base = call_base;
-                vm->frame_count++;
-                vm->stack.top = vm->stack.stack + call_base + function->chunk.locals_count;
-                for (size_t i = argument_count; i < function->chunk.locals_count; i++) {
-                    vm->stack.stack[call_base + i] = sk_nothing_value();
-                }
-                break;
+            vm_case(SK_OP_CALL): {
+                const uint8_t count = read_byte();
+                call(function_under(count), count, 1);
+                vm_next();
+            }
+            vm_case(SK_OP_CALL_WIDE): {
+                const uint16_t count = read_short();
+                call(function_under(count), count, 1);
+                vm_next();
+            }
+            vm_case(SK_OP_CALL_DIRECT): {
+                const uint16_t fnptr = read_short();
+                const uint8_t count = read_byte();
+                call(function_at(fnptr), count, 0);
+                vm_next();
+            }
+            vm_case(SK_OP_TAIL_CALL): {
+                const uint8_t count = read_byte();
+                tail_call(function_under(count), count);
+                vm_next();
+            }
+            vm_case(SK_OP_TAIL_CALL_WIDE): {
+                const uint16_t count = read_short();
+                tail_call(function_under(count), count);
+                vm_next();
+            }
+            vm_case(SK_OP_TAIL_CALL_DIRECT): {
+                const uint16_t fnptr = read_short();
+                const uint8_t count = read_byte();
+                tail_call(function_at(fnptr), count);
+                vm_next();
             }
 
-            case SK_OP_NNEG: {
+            vm_case(SK_OP_NNEG): {
                 const sk_number a = sk_as_number(pop());
                 push(sk_number_value(-a));
-                break;
+                vm_next();
             }
-            case SK_OP_NADD: {
+            vm_case(SK_OP_NADD): {
                 const sk_number b = sk_as_number(pop());
                 const sk_number a = sk_as_number(pop());
                 push(sk_number_value(a + b));
-                break;
+                vm_next();
             }
-            case SK_OP_NSUB: {
+            vm_case(SK_OP_NSUB): {
                 const sk_number b = sk_as_number(pop());
                 const sk_number a = sk_as_number(pop());
                 push(sk_number_value(a - b));
-                break;
+                vm_next();
             }
-            case SK_OP_NMUL: {
+            vm_case(SK_OP_NMUL): {
                 const sk_number b = sk_as_number(pop());
                 const sk_number a = sk_as_number(pop());
                 push(sk_number_value(a * b));
-                break;
+                vm_next();
             }
-            case SK_OP_NDIV: {
+            vm_case(SK_OP_NDIV): {
                 const sk_number b = sk_as_number(pop());
                 const sk_number a = sk_as_number(pop());
                 push(sk_number_value(a / b));
-                break;
+                vm_next();
+            }
+            vm_case(SK_OP_CONCAT): {
+                // The operands stay on the stack, and so rooted, until the result has been allocated.
+                store_frame();
+                const struct sk_object_string *result =
+                    sk_object_string_concat(heap, sk_as_string(peek(1)), sk_as_string(peek(0)));
+                sp--;
+                sp[-1] = sk_object_value(result);
+                vm_next();
             }
 
-            case SK_OP_NLESS: {
+            vm_case(SK_OP_NLESS): {
                 const sk_number b = sk_as_number(pop());
                 const sk_number a = sk_as_number(pop());
                 push(sk_boolean_value(a < b));
-                break;
+                vm_next();
+            }
+            vm_case(SK_OP_NLESS_EQUAL): {
+                // Negated rather than `<=` so that NaN operands behave exactly like NGREATER followed by NOT.
+                const sk_number b = sk_as_number(pop());
+                const sk_number a = sk_as_number(pop());
+                push(sk_boolean_value(!(a > b)));
+                vm_next();
             }
-            case SK_OP_NGREATER: {
+            vm_case(SK_OP_NGREATER): {
                 const sk_number b = sk_as_number(pop());
                 const sk_number a = sk_as_number(pop());
                 push(sk_boolean_value(a > b));
-                break;
+                vm_next();
+            }
+            vm_case(SK_OP_NGREATER_EQUAL): {
+                const sk_number b = sk_as_number(pop());
+                const sk_number a = sk_as_number(pop());
+                push(sk_boolean_value(!(a < b)));
+                vm_next();
             }
-            case SK_OP_NEQUAL: {
+            vm_case(SK_OP_NEQUAL): {
                 const sk_number b = sk_as_number(pop());
                 const sk_number a = sk_as_number(pop());
                 push(sk_boolean_value(a == b));
-                break;
+                vm_next();
+            }
+            vm_case(SK_OP_NNOT_EQUAL): {
+                const sk_number b = sk_as_number(pop());
+                const sk_number a = sk_as_number(pop());
+                push(sk_boolean_value(a != b));
+                vm_next();
+            }
+            vm_case(SK_OP_EQUAL): {
+                const struct sk_value b = pop();
+                const struct sk_value a = pop();
+                push(sk_boolean_value(a.bits == b.bits));
+                vm_next();
+            }
+            vm_case(SK_OP_NOT_EQUAL): {
+                const struct sk_value b = pop();
+                const struct sk_value a = pop();
+                push(sk_boolean_value(a.bits != b.bits));
+                vm_next();
             }
 
-            case SK_OP_TRUE: {
+            vm_case(SK_OP_TRUE): {
                 push(sk_boolean_true);
-                break;
+                vm_next();
             }
-            case SK_OP_FALSE: {
+            vm_case(SK_OP_FALSE): {
                 push(sk_boolean_false);
-                break;
+                vm_next();
             }
-            case SK_OP_NOT: {
+            vm_case(SK_OP_NOT): {
                 const sk_bool a = sk_as_boolean(pop());
                 push(sk_boolean_value(!a));
-                break;
+                vm_next();
             }
 
-            case SK_OP_JMP: {
+            vm_case(SK_OP_JMP): {
                 const uint16_t offset = read_short();
-                frame()->ip += offset;
-                break;
+                ip += offset;
+                vm_next();
             }
-            case SK_OP_JMP_BACK: {
+            vm_case(SK_OP_JMP_BACK): {
                 const uint16_t offset = read_short();
-                frame()->ip -= offset;
-                break;
+                ip -= offset;
+                count_entry(back_edges);
+                // A running incremental collection gets a slice on every back-edge, so that loops that do not allocate
+                // still finish it.
+                if (heap->cycle != SK_GC_CYCLE_IDLE) {
+                    store_frame();
+                    sk_gc_step(heap);
+                }
+
+                vm_next();
             }
-            case SK_OP_JMP_TRUE: {
+            vm_case(SK_OP_JMP_TRUE): {
                 const uint16_t offset = read_short();
                 const sk_bool a = sk_as_boolean(peek(0));
                 if (a) {
-                    frame()->ip += offset;
+                    ip += offset;
                 }
 
-                break;
+                vm_next();
             }
-            case SK_OP_JMP_FALSE: {
+            vm_case(SK_OP_JMP_FALSE): {
                 const uint16_t offset = read_short();
                 const sk_bool a = sk_as_boolean(peek(0));
                 if (!a) {
-                    frame()->ip += offset;
+                    ip += offset;
                 }
 
-                break;
+                vm_next();
             }
-            default:
+
+            vm_case(SK_OP_JMP_IF_LESS_LOCALS):
+                compare_and_jump(slots[read_byte()], a < b);
+                vm_next();
+            vm_case(SK_OP_JMP_IF_NOT_LESS_LOCALS):
+                compare_and_jump(slots[read_byte()], !(a < b));
+                vm_next();
+            vm_case(SK_OP_JMP_IF_GREATER_LOCALS):
+                compare_and_jump(slots[read_byte()], a > b);
+                vm_next();
+            vm_case(SK_OP_JMP_IF_NOT_GREATER_LOCALS):
+                compare_and_jump(slots[read_byte()], !(a > b));
+                vm_next();
+            vm_case(SK_OP_JMP_IF_EQUAL_LOCALS):
+                compare_and_jump(slots[read_byte()], a == b);
+                vm_next();
+            vm_case(SK_OP_JMP_IF_NOT_EQUAL_LOCALS):
+                compare_and_jump(slots[read_byte()], a != b);
+                vm_next();
+
+            vm_case(SK_OP_JMP_IF_LESS_LOCAL_CONST):
+                compare_and_jump(read_const(), a < b);
+                vm_next();
+            vm_case(SK_OP_JMP_IF_NOT_LESS_LOCAL_CONST):
+                compare_and_jump(read_const(), !(a < b));
+                vm_next();
+            vm_case(SK_OP_JMP_IF_GREATER_LOCAL_CONST):
+                compare_and_jump(read_const(), a > b);
+                vm_next();
+            vm_case(SK_OP_JMP_IF_NOT_GREATER_LOCAL_CONST):
+                compare_and_jump(read_const(), !(a > b));
+                vm_next();
+            vm_case(SK_OP_JMP_IF_EQUAL_LOCAL_CONST):
+                compare_and_jump(read_const(), a == b);
+                vm_next();
+            vm_case(SK_OP_JMP_IF_NOT_EQUAL_LOCAL_CONST):
+                compare_and_jump(read_const(), a != b);
+                vm_next();
+            vm_default:
+                store_frame();
                 fprintf(stderr, "Invalid instruction.\n");
                 return SK_VM_ERR;
         }
     }
 
+#undef vm_default
+#undef vm_next
+#undef vm_case
+#undef vm_dispatch
+#undef peek
+#undef function_at
+#undef function_under
+#undef tail_call
+#undef call
+#undef compare_and_jump
 #undef pop
 #undef push
-#undef frame
 #undef read_short
 #undef read_const
 #undef read_byte
+#undef tier_resume
+#undef count_entry
+#undef store_frame
+#undef load_frame
 }
 
-static void vm_print(struct sk_vm_stack *stack)
+#if SK_VM_THREADED_DISPATCH
+#pragma GCC diagnostic pop
+#endif
+
+static struct sk_value *vm_print(struct sk_value *top)
 {
-    const struct sk_object_string *template = sk_as_string(sk_vm_stack_pop(stack));
+    const struct sk_object_string *template = sk_as_string(*--top);
     for (size_t i = 0; i < template->length; i++) {
         const char c = template->chars[i];
         if (c == '%') {
             // The following line is safe because the char on length + 1 is '\0'.
-            const char next_c = template->chars[++i];
-            switch (next_c) {
-                case 'n':
-                    sk_number_print(sk_vm_stack_pop(stack));
-                    break;
-                case 'b':
-                    sk_boolean_print(sk_vm_stack_pop(stack));
-                    break;
-                case 's':
-                    sk_string_print(sk_vm_stack_pop(stack));
-                    break;
-                case 'f':
-                    sk_fnptr_print(sk_vm_stack_pop(stack));
-                    break;
-                default:
-                    printf("INVALID");
-                    break;
-            }
-
+            top = print_conversion(template->chars[++i], top);
             continue;
         }
 
@@ -358,6 +1145,139 @@ static void vm_print(struct sk_vm_stack *stack)
     }
 
     printf("\n");
+    return top;
+}
+
+static struct sk_value *vm_print_template(const struct sk_print_template *template, struct sk_value *top)
+{
+    top--;
+    for (size_t i = 0; i < template->count; i++) {
+        const struct sk_print_segment *segment = &template->segments[i];
+        fwrite(segment->text, 1, segment->length, stdout);
+        if (segment->has_conversion) {
+            top = print_conversion(segment->conversion, top);
+        }
+    }
+
+    printf("\n");
+    return top;
+}
+
+// Prints the value below `top` in the format named by the conversion character and returns the new top.
+static struct sk_value *print_conversion(const char conversion, struct sk_value *top)
+{
+    switch (conversion) {
+        case 'n':
+            sk_number_print(*--top);
+            break;
+        case 'b':
+            sk_boolean_print(*--top);
+            break;
+        case 's':
+            sk_string_print(*--top);
+            break;
+        case 'f':
+            sk_fnptr_print(*--top);
+            break;
+        default:
+            printf("INVALID");
+            break;
+    }
+
+    return top;
+}
+
+// Parses the template into the instruction's print cache entry, allocating the entry on first use, and rewrites the
+// instruction into PRINT_CACHED. Returns NULL and leaves the instruction generic once the cache is full.
+static const struct sk_print_template *quicken_print(
+    struct sk_program *program,
+    uint8_t *instruction,
+    const struct sk_object_string *source)
+{
+    struct sk_print_cache *cache = &program->print_cache;
+    size_t index = (size_t)(instruction[2] << 8 | instruction[3]);
+
+    if (index == SK_PRINT_CACHE_NONE) {
+        if (cache->count == SK_PRINT_CACHE_NONE) {
+            return NULL;
+        }
+
+        if (cache->count >= cache->capacity) {
+            cache->capacity = sk_grow(cache->capacity);
+            cache->templates = sk_realloc(cache->templates, cache->capacity);
+        }
+
+        index = cache->count++;
+        cache->templates[index] = (struct sk_print_template) {
+            .source = NULL,
+            .segments = NULL,
+            .capacity = 0,
+            .count = 0,
+        };
+        instruction[2] = (index >> 8) & 0xFF;
+        instruction[3] = index & 0xFF;
+    }
+
+    struct sk_print_template *template = &cache->templates[index];
+    parse_print_template(template, source);
+    instruction[0] = SK_OP_PRINT_CACHED;
+    return template;
+}
+
+// Makes room for `stack_size` values and `frame_count` frames, keeping the top of the stack at the same offset. Returns
+// false when that would exceed the VM's limits.
+static bool grow_stacks(struct sk_vm *vm, const size_t stack_size, const size_t frame_count)
+{
+    if (stack_size > vm->max_stack_size || frame_count > vm->max_frames) {
+        return false;
+    }
+
+    if (stack_size > vm->stack.capacity) {
+        size_t capacity = vm->stack.capacity;
+        while (capacity < stack_size) {
+            capacity = sk_grow(capacity);
+        }
+
+        capacity = capacity > vm->max_stack_size ? vm->max_stack_size : capacity;
+        const size_t top = (size_t)(vm->stack.top - vm->stack.stack);
+        vm->stack.stack = sk_realloc(vm->stack.stack, capacity);
+        vm->stack.top = vm->stack.stack + top;
+        vm->stack.capacity = capacity;
+    }
+
+    if (frame_count > vm->frame_capacity) {
+        size_t capacity = vm->frame_capacity;
+        while (capacity < frame_count) {
+            capacity = sk_grow(capacity);
+        }
+
+        capacity = capacity > vm->max_frames ? vm->max_frames : capacity;
+        vm->frames = sk_realloc(vm->frames, capacity);
+        vm->frame_capacity = capacity;
+    }
+
+    return true;
+}
+
+// Offers the function to the tier once its profile reaches the threshold, and runs it in the tier once promoted.
+static uint8_t *tier_enter(
+    const struct sk_vm *vm,
+    struct sk_vm_profile *profile,
+    const struct sk_compiled_function *function,
+    uint8_t *ip,
+    struct sk_value *slots,
+    struct sk_value **sp)
+{
+    const struct sk_vm_tier *tier = vm->tier;
+    if (profile->tier == SK_VM_TIER_BASELINE) {
+        if (profile->calls + profile->back_edges < tier->threshold) {
+            return NULL;
+        }
+
+        profile->tier = tier->promote(tier->data, function, profile) ? SK_VM_TIER_PROMOTED : SK_VM_TIER_REJECTED;
+    }
+
+    return profile->tier == SK_VM_TIER_PROMOTED ? tier->enter(tier->data, function, ip, slots, sp) : NULL;
 }
 
 static void reserve_stack_slots(struct sk_vm *vm, const size_t count)
@@ -1,34 +1,62 @@
 #ifndef SKARD_SK_VM_H
 #define SKARD_SK_VM_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
+#include "sk_gc.h"
 #include "sk_value.h"
 
 enum sk_opcode {
     SK_OP_HALT,
     SK_OP_RETURN,
+    // PRINT count cache16 prints a template and `count` values. Its first execution parses the template into the
+    // program's print cache and rewrites the instruction into PRINT_CACHED, which prints from the parsed template for
+    // as long as the same template string comes back. Any other template rewrites it back to PRINT.
     SK_OP_PRINT,
+    SK_OP_PRINT_CACHED,
 
     SK_OP_POP,
 
     SK_OP_NOTHING,
+
+    // The _WIDE forms take a two-byte operand. They are only emitted when the operand does not fit in one byte, so
+    // small functions keep the compact encoding.
     SK_OP_CONST,
+    SK_OP_CONST_WIDE,
 
     SK_OP_LOAD_LOCAL,
+    SK_OP_LOAD_LOCAL_WIDE,
     SK_OP_STORE_LOCAL,
+    SK_OP_STORE_LOCAL_WIDE,
 
     SK_OP_CALL,
+    SK_OP_CALL_WIDE,
+    // CALL_DIRECT fnptr16 count calls a function the checker resolved by name, without a function value on the stack.
+    SK_OP_CALL_DIRECT,
+    // Calls in tail position replace the current frame instead of pushing a new one.
+    SK_OP_TAIL_CALL,
+    SK_OP_TAIL_CALL_WIDE,
+    SK_OP_TAIL_CALL_DIRECT,
 
     SK_OP_NNEG,
     SK_OP_NADD,
     SK_OP_NSUB,
     SK_OP_NMUL,
     SK_OP_NDIV,
+    // Concatenates two strings into a new young string.
+    SK_OP_CONCAT,
 
     SK_OP_NLESS,
+    SK_OP_NLESS_EQUAL,
     SK_OP_NGREATER,
+    SK_OP_NGREATER_EQUAL,
     SK_OP_NEQUAL,
+    SK_OP_NNOT_EQUAL,
+
+    // Non-number operands are equal when their values are identical.
+    SK_OP_EQUAL,
+    SK_OP_NOT_EQUAL,
 
     SK_OP_TRUE,
     SK_OP_FALSE,
@@ -38,11 +66,33 @@ enum sk_opcode {
     SK_OP_JMP_BACK,
     SK_OP_JMP_TRUE,
     SK_OP_JMP_FALSE,
+
+    // Compare two Number locals (`a b offset`) or a Number local with a constant (`slot constant offset`) and jump
+    // forward when the comparison holds. They stand for a whole `if`/`while` test: the comparison, JMP_FALSE and POPs.
+    SK_OP_JMP_IF_LESS_LOCALS,
+    SK_OP_JMP_IF_NOT_LESS_LOCALS,
+    SK_OP_JMP_IF_GREATER_LOCALS,
+    SK_OP_JMP_IF_NOT_GREATER_LOCALS,
+    SK_OP_JMP_IF_EQUAL_LOCALS,
+    SK_OP_JMP_IF_NOT_EQUAL_LOCALS,
+    SK_OP_JMP_IF_LESS_LOCAL_CONST,
+    SK_OP_JMP_IF_NOT_LESS_LOCAL_CONST,
+    SK_OP_JMP_IF_GREATER_LOCAL_CONST,
+    SK_OP_JMP_IF_NOT_GREATER_LOCAL_CONST,
+    SK_OP_JMP_IF_EQUAL_LOCAL_CONST,
+    SK_OP_JMP_IF_NOT_EQUAL_LOCAL_CONST,
 };
 
+#define SK_CHUNK_MAX_OPERAND UINT16_MAX
+
+// The cache operand of a PRINT that has no print cache entry yet.
+#define SK_PRINT_CACHE_NONE UINT16_MAX
+
 struct sk_chunk {
-    struct sk_value_array constants;
     size_t locals_count;
+    // Stack slots a frame of this chunk can use: its locals plus the deepest operand stack. The stack VM checks this
+    // once per call instead of checking every push.
+    size_t frame_size;
     uint8_t *code;
     size_t capacity;
     size_t count;
@@ -59,47 +109,149 @@ struct sk_function_array {
     size_t count;
 };
 
+// Constants shared by every function of a program, found by their bits so that each distinct literal has one entry.
+// Strings are interned on the program's heap, so equal literals are one object and share their bits as well. The heap
+// keeps them alive for as long as the table holds them.
+struct sk_constant_table {
+    struct sk_value_array values;
+    // Open-addressing set of value indices plus one (zero is a free slot), keyed by the value bits.
+    uint32_t *slots;
+    size_t slots_capacity;
+};
+
+// A run of template text followed, unless it ends the template, by a conversion such as `%n`.
+struct sk_print_segment {
+    const char *text;
+    size_t length;
+    bool has_conversion;
+    char conversion;
+};
+
+struct sk_print_template {
+    const struct sk_object_string *source;
+    struct sk_print_segment *segments;
+    size_t capacity;
+    size_t count;
+};
+
+// Parsed templates of the PRINT instructions executed so far, indexed by their cache operand. Each instruction owns
+// its entry, so a template that changes at run time reuses the entry instead of adding another.
+struct sk_print_cache {
+    struct sk_print_template *templates;
+    size_t capacity;
+    size_t count;
+};
+
+// A program owns the heap its objects live on. Its constants and the templates of its print cache are roots of that
+// heap; a VM running the program adds its own while it runs. The heap refers back to the program, which therefore must
+// not be moved once initialized.
 struct sk_program {
     struct sk_function_array functions;
+    struct sk_constant_table constants;
+    struct sk_print_cache print_cache;
+    struct sk_heap heap;
     sk_fnptr entry;
 };
 
 void sk_chunk_init(struct sk_chunk *chunk);
 void sk_chunk_free(struct sk_chunk *chunk);
 void sk_chunk_add(struct sk_chunk *chunk, uint8_t byte);
-void sk_chunk_add_const(struct sk_chunk *chunk, struct sk_value constant);
+bool sk_chunk_add_with_operand(struct sk_chunk *chunk, uint8_t opcode, size_t operand);
+size_t sk_chunk_max_stack_depth(const struct sk_chunk *chunk);
+size_t sk_opcode_length(uint8_t opcode);
+bool sk_opcode_is_compare_jump(uint8_t opcode);
+
+void sk_constant_table_init(struct sk_constant_table *table);
+void sk_constant_table_free(struct sk_constant_table *table);
+bool sk_constant_table_find(const struct sk_constant_table *table, struct sk_value constant, size_t *index);
+size_t sk_constant_table_add(struct sk_constant_table *table, struct sk_value constant);
+size_t sk_constant_table_add_string(
+    struct sk_constant_table *table,
+    struct sk_heap *heap,
+    const char *chars,
+    size_t length);
 
 void sk_program_init(struct sk_program *program);
 void sk_program_free(struct sk_program *program);
 struct sk_compiled_function *sk_program_add_function(struct sk_program *program, sk_fnptr fnptr);
+// Statistics of the collections on the program's heap so far, whichever VM ran it, pause histogram included.
+struct sk_gc_stats sk_program_gc_stats(const struct sk_program *program);
 
-#define SK_VM_STACK_MAX_SIZE 256
-#define SK_VM_CALL_FRAME_MAX 256
+// The value stack and the frame stack start small and grow geometrically up to these limits, which `run` can change.
+#define SK_VM_DEFAULT_MAX_STACK_SIZE (1 << 20)
+#define SK_VM_DEFAULT_MAX_FRAMES (1 << 16)
 
 struct sk_vm_stack {
-    struct sk_value stack[SK_VM_STACK_MAX_SIZE];
+    struct sk_value *stack;
     struct sk_value *top;
+    size_t capacity;
 };
 
 void sk_vm_stack_init(struct sk_vm_stack *stack);
-void sk_vm_stack_free(const struct sk_vm_stack *stack);
+void sk_vm_stack_free(struct sk_vm_stack *stack);
 void sk_vm_stack_push(struct sk_vm_stack *stack, struct sk_value value);
 struct sk_value sk_vm_stack_pop(struct sk_vm_stack *stack);
 struct sk_value sk_vm_stack_peek(const struct sk_vm_stack *stack, int depth);
 
+struct sk_vm_frame {
+    const struct sk_compiled_function *function;
+    uint8_t *ip;
+    size_t base;
+    // Where the stack VM's RETURN leaves the result: the function value under the arguments for generic calls and the
+    // first argument for direct ones.
+    size_t result;
+};
+
+enum sk_vm_tier_state {
+    SK_VM_TIER_BASELINE,
+    SK_VM_TIER_PROMOTED,
+    SK_VM_TIER_REJECTED,
+};
+
+// How often the stack VM entered a function: calls, tail calls included, and loop back-edges taken inside it.
+struct sk_vm_profile {
+    size_t calls;
+    size_t back_edges;
+    enum sk_vm_tier_state tier;
+};
+
+// A faster way to execute functions that become hot. Once the calls and back-edges of a function reach `threshold`,
+// `promote` is asked once to take it over. From then on `enter` runs the promoted function from `ip` whenever the VM
+// enters it, takes a back-edge to a loop header or returns into it, which makes loop headers on-stack replacement
+// points. `enter` works on the interpreter's frame and moves `sp` like the interpreter would; it returns the
+// instruction the interpreter continues with, or NULL to let the interpreter execute `ip` itself.
+//
+// A tier that runs loops without going back to the VM must keep up what the VM's JMP_BACK does. It counts the
+// back-edges it takes in the function's `profile`, which stays in place until the run ends, and while an incremental
+// collection of the program's heap is running it leaves every back-edge to the VM, which does a slice of it.
+struct sk_vm_tier {
+    void *data;
+    size_t threshold;
+    bool (*promote)(void *data, const struct sk_compiled_function *function, struct sk_vm_profile *profile);
+    uint8_t *(*enter)(
+        void *data,
+        const struct sk_compiled_function *function,
+        uint8_t *ip,
+        struct sk_value *slots,
+        struct sk_value **sp);
+};
+
 struct sk_vm {
     struct sk_vm_stack stack;
     struct sk_program *program;
-    struct {
-        const struct sk_compiled_function *function;
-        uint8_t *ip;
-        size_t base;
-    } frames[SK_VM_CALL_FRAME_MAX];
+    // One per function of the program, kept after the run.
+    struct sk_vm_profile *profiles;
+    // Not owned by the VM; NULL to only interpret.
+    const struct sk_vm_tier *tier;
+    struct sk_vm_frame *frames;
     size_t frame_count;
+    size_t frame_capacity;
+    size_t max_stack_size;
+    size_t max_frames;
 };
 
 void sk_vm_init(struct sk_vm *vm);
-void sk_vm_free(const struct sk_vm *vm);
+void sk_vm_free(struct sk_vm *vm);
 
 enum sk_vm_result {
     SK_VM_OK,
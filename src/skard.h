@@ -1,15 +1,24 @@
 #ifndef SKARD_SKARD_H
 #define SKARD_SKARD_H
 
+#include "sk_arena.h"
 #include "sk_ast.h"
 #include "sk_checker.h"
 #include "sk_compiler.h"
 #include "sk_debug.h"
+#include "sk_fold.h"
+#include "sk_gc.h"
 #include "sk_hashmap.h"
+#include "sk_inline.h"
+#include "sk_ir.h"
+#include "sk_jit.h"
 #include "sk_lexer.h"
 #include "sk_memory.h"
 #include "sk_object.h"
 #include "sk_parser.h"
+#include "sk_peephole.h"
+#include "sk_register_compiler.h"
+#include "sk_register_vm.h"
 #include "sk_value.h"
 #include "sk_vm.h"
 
@@ -0,0 +1,188 @@
+import argparse
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+from pathlib import Path
+from typing import List, NamedTuple, Optional, Sequence
+
+
+DEFAULT_ITERATIONS = 1000000
+DEFAULT_REPEATS = 5
+UNROLL = 10
+# Folding and the peephole pass would remove most of the statements below, whose values are never used, so the
+# benchmarks run the bytecode exactly as the compiler emits it.
+RUN_OPTIONS = ("--no-fold", "--no-peephole")
+
+
+class Benchmark(NamedTuple):
+    name: str
+    opcodes: str
+    statement: str
+
+
+# Every statement is unrolled UNROLL times inside a counting loop. `{i}` is replaced by the unroll index so that
+# `let` statements get distinct names. The locals a, b (Number), t, f (Boolean) and the function `nop` are available.
+BENCHMARKS = (
+    Benchmark("const", "CONST STORE_LOCAL", "let v{i}: Number = 1"),
+    Benchmark("load_local", "LOAD_LOCAL STORE_LOCAL", "let v{i}: Number = a"),
+    Benchmark("store_local", "LOAD_LOCAL STORE_LOCAL", "a = b"),
+    Benchmark("pop", "LOAD_LOCAL LOAD_LOCAL NADD POP", "a + b"),
+    Benchmark("nneg", "LOAD_LOCAL NNEG STORE_LOCAL", "let v{i}: Number = -a"),
+    Benchmark("nadd", "LOAD_LOCAL LOAD_LOCAL NADD STORE_LOCAL", "let v{i}: Number = a + b"),
+    Benchmark("nsub", "LOAD_LOCAL LOAD_LOCAL NSUB STORE_LOCAL", "let v{i}: Number = a - b"),
+    Benchmark("nmul", "LOAD_LOCAL LOAD_LOCAL NMUL STORE_LOCAL", "let v{i}: Number = a * b"),
+    Benchmark("ndiv", "LOAD_LOCAL LOAD_LOCAL NDIV STORE_LOCAL", "let v{i}: Number = a / b"),
+    Benchmark("nless", "LOAD_LOCAL LOAD_LOCAL NLESS STORE_LOCAL", "let v{i}: Boolean = a < b"),
+    Benchmark("nless_equal", "LOAD_LOCAL LOAD_LOCAL NLESS_EQUAL STORE_LOCAL", "let v{i}: Boolean = a <= b"),
+    Benchmark("ngreater", "LOAD_LOCAL LOAD_LOCAL NGREATER STORE_LOCAL", "let v{i}: Boolean = a > b"),
+    Benchmark("nequal", "LOAD_LOCAL LOAD_LOCAL NEQUAL STORE_LOCAL", "let v{i}: Boolean = a == b"),
+    Benchmark("true", "TRUE STORE_LOCAL", "let v{i}: Boolean = true"),
+    Benchmark("false", "FALSE STORE_LOCAL", "let v{i}: Boolean = false"),
+    Benchmark("not", "LOAD_LOCAL NOT STORE_LOCAL", "let v{i}: Boolean = !t"),
+    Benchmark("jmp_true", "LOAD_LOCAL JMP_TRUE STORE_LOCAL", "let v{i}: Boolean = t || t"),
+    Benchmark("jmp_false", "LOAD_LOCAL JMP_FALSE POP", "if (f) {}"),
+    Benchmark("jmp", "LOAD_LOCAL JMP_FALSE POP JMP", "if (t) {}"),
+    Benchmark("jmp_if", "JMP_IF_NOT_LESS_LOCALS", "if (a < b) {}"),
+    Benchmark("call", "CALL_DIRECT NOTHING RETURN POP", "nop()"),
+    Benchmark("print", "CONST PRINT_CACHED", 'print("")'),
+)
+
+
+def program_source(statement: Optional[str], iterations: int) -> str:
+    body = ""
+    if statement is not None:
+        body = "".join(f"        {statement.replace('{i}', str(i))}\n" for i in range(UNROLL))
+
+    return (
+        "fn nop() {}\n"
+        "\n"
+        "fn main() {\n"
+        "    let a: Number = 3\n"
+        "    let b: Number = 7\n"
+        "    let t: Boolean = true\n"
+        "    let f: Boolean = false\n"
+        "    let i: Number = 0\n"
+        f"    while (i < {iterations}) {{\n"
+        f"{body}"
+        "        i = i + 1\n"
+        "    }\n"
+        "}\n"
+    )
+
+
+def measure(executable: str, source_file: Path, repeats: int) -> Optional[float]:
+    best = None
+    for _ in range(repeats):
+        start = time.perf_counter()
+        result = subprocess.run(
+            [executable, "run", *RUN_OPTIONS, str(source_file)],
+            stdout=subprocess.DEVNULL,
+            stderr=subprocess.PIPE,
+            text=True,
+            check=False,
+        )
+        elapsed = time.perf_counter() - start
+        if result.returncode != 0:
+            print(f"'{executable}' failed on {source_file.name}: {result.stderr.strip()}", file=sys.stderr)
+            return None
+        best = elapsed if best is None else min(best, elapsed)
+
+    return best
+
+
+def positive_int(value: str) -> int:
+    parsed = int(value)
+    if parsed <= 0:
+        raise argparse.ArgumentTypeError("must be greater than zero")
+    return parsed
+
+
+def parse_arguments(arguments: Optional[Sequence[str]] = None) -> argparse.Namespace:
+    parser = argparse.ArgumentParser(
+        description="Measure the per-opcode cost of one or more Skard executables.",
+    )
+    parser.add_argument(
+        "executables",
+        nargs="+",
+        help="Skard executables to compare; the first one is the baseline.",
+    )
+    parser.add_argument(
+        "--iterations",
+        type=positive_int,
+        default=DEFAULT_ITERATIONS,
+        help=f"Loop iterations per benchmark (default: {DEFAULT_ITERATIONS}).",
+    )
+    parser.add_argument(
+        "--repeats",
+        type=positive_int,
+        default=DEFAULT_REPEATS,
+        help=f"Runs per benchmark; the fastest one is reported (default: {DEFAULT_REPEATS}).",
+    )
+    return parser.parse_args(arguments)
+
+
+def resolve_executable(value: str) -> Optional[str]:
+    candidate = Path(value).expanduser()
+    if candidate.is_file():
+        return str(candidate.resolve())
+
+    return shutil.which(value)
+
+
+def main(arguments: Optional[Sequence[str]] = None) -> int:
+    args = parse_arguments(arguments)
+
+    executables: List[str] = []
+    for value in args.executables:
+        executable = resolve_executable(value)
+        if executable is None:
+            print(f"Executable '{value}' does not exist and was not found on PATH.", file=sys.stderr)
+            return 1
+        executables.append(executable)
+
+    operations = args.iterations * UNROLL
+    header = f"{'benchmark':<13}" + "".join(f"{f'ns/op [{i}]':>14}" for i in range(len(executables)))
+    if len(executables) > 1:
+        header += "".join(f"{f'[{i}]/[0]':>10}" for i in range(1, len(executables)))
+    header += "  opcodes"
+
+    for index, executable in enumerate(executables):
+        print(f"[{index}] {executable}")
+    print()
+    print(header)
+
+    with tempfile.TemporaryDirectory() as directory:
+        loop_file = Path(directory) / "loop.sk"
+        loop_file.write_text(program_source(None, args.iterations), encoding="utf-8")
+        loop_times = [measure(executable, loop_file, args.repeats) for executable in executables]
+        if None in loop_times:
+            return 1
+
+        loop_row = "".join(f"{loop_time / args.iterations * 1e9:>14.2f}" for loop_time in loop_times)
+        if len(executables) > 1:
+            loop_row += "".join(f"{loop_time / loop_times[0]:>10.2f}" for loop_time in loop_times[1:])
+        print(f"{'loop':<13}{loop_row}  JMP_IF_NOT_LESS_LOCAL_CONST ... JMP_BACK (per iteration)")
+
+        for benchmark in BENCHMARKS:
+            source_file = Path(directory) / f"{benchmark.name}.sk"
+            source_file.write_text(program_source(benchmark.statement, args.iterations), encoding="utf-8")
+
+            costs = []
+            for executable, loop_time in zip(executables, loop_times):
+                elapsed = measure(executable, source_file, args.repeats)
+                if elapsed is None:
+                    return 1
+                costs.append(max(elapsed - loop_time, 0.0) / operations * 1e9)
+
+            row = "".join(f"{cost:>14.2f}" for cost in costs)
+            if len(executables) > 1:
+                row += "".join(f"{cost / costs[0] if costs[0] > 0 else 0.0:>10.2f}" for cost in costs[1:])
+            print(f"{benchmark.name:<13}{row}  {benchmark.opcodes}")
+
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
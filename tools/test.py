@@ -45,12 +45,13 @@ def print_status(label: str, color: str, message: str) -> None:
 def run_test_program(
     executable: str,
     command: str,
+    options: Sequence[str],
     test_file: Path,
     timeout: float,
 ) -> Optional[subprocess.CompletedProcess]:
     try:
         return subprocess.run(
-            [executable, command, display_path(test_file)],
+            [executable, command, *options, display_path(test_file)],
             capture_output=True,
             text=True,
             encoding="utf-8",
@@ -85,11 +86,12 @@ def generate_test(
     test_file: Path,
     executable: str,
     command: str,
+    options: Sequence[str],
     timeout: float,
 ) -> bool:
     path = display_path(test_file)
     print(f"Generating {path}")
-    result = run_test_program(executable, command, test_file, timeout)
+    result = run_test_program(executable, command, options, test_file, timeout)
     if result is None:
         return False
 
@@ -185,11 +187,12 @@ def test_file(
     source_file: Path,
     executable: str,
     command: str,
+    options: Sequence[str],
     timeout: float,
 ) -> bool:
     path = display_path(source_file)
     print(f"Testing {path}")
-    result = run_test_program(executable, command, source_file, timeout)
+    result = run_test_program(executable, command, options, source_file, timeout)
     if result is None:
         return False
 
@@ -251,10 +254,17 @@ def parse_arguments(arguments: Optional[Sequence[str]] = None) -> argparse.Names
     parser.add_argument("executable", help="Path or command name of the Skard executable.")
     parser.add_argument(
         "--command",
-        choices=("ast", "run"),
+        choices=("ast", "ir", "run"),
         default="ast",
         help="Skard command used for each test (default: ast).",
     )
+    parser.add_argument(
+        "--option",
+        dest="options",
+        action="append",
+        default=[],
+        help="Extra option passed to the Skard command before the test file; may be repeated.",
+    )
     parser.add_argument(
         "--tests-dir",
         type=Path,
@@ -320,7 +330,7 @@ def main(arguments: Optional[Sequence[str]] = None) -> int:
 
     operation = generate_test if args.action == "generate" else test_file
     results = [
-        operation(test, executable, args.command, args.timeout)
+        operation(test, executable, args.command, args.options, args.timeout)
         for test in test_files
     ]
 
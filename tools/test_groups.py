@@ -8,8 +8,30 @@ from typing import Optional, Sequence
 PROJECT_ROOT = Path(__file__).resolve().parent.parent
 TEST_RUNNER = PROJECT_ROOT / "tools" / "test.py"
 TEST_GROUPS = (
-    ("ast", PROJECT_ROOT / "tests" / "ast"),
-    ("run", PROJECT_ROOT / "tests" / "run"),
+    ("ast", PROJECT_ROOT / "tests" / "ast", ()),
+    ("ir", PROJECT_ROOT / "tests" / "ir", ()),
+    ("run", PROJECT_ROOT / "tests" / "run", ()),
+    ("run", PROJECT_ROOT / "tests" / "run", ("--no-fold",)),
+    ("run", PROJECT_ROOT / "tests" / "run", ("--no-peephole",)),
+    ("run", PROJECT_ROOT / "tests" / "run", ("--inline=0",)),
+    ("run", PROJECT_ROOT / "tests" / "run", ("--jit", "--jit-threshold=1")),
+    ("run", PROJECT_ROOT / "tests" / "run", ("--ir",)),
+    ("run", PROJECT_ROOT / "tests" / "run", ("--vm=register",)),
+    ("run", PROJECT_ROOT / "tests" / "run_register", ("--vm=register",)),
+    ("run", PROJECT_ROOT / "tests" / "run_stack", ()),
+    ("run", PROJECT_ROOT / "tests" / "run_stack", ("--no-peephole",)),
+    ("run", PROJECT_ROOT / "tests" / "peephole_stats", ("--peephole-stats",)),
+    ("run", PROJECT_ROOT / "tests" / "memory_limit", ("--memory-limit=131072",)),
+    ("run", PROJECT_ROOT / "tests" / "memory_limit", ("--memory-limit=131072", "--jit", "--jit-threshold=1")),
+    ("run", PROJECT_ROOT / "tests" / "gc", ("--gc-stats",)),
+    ("run", PROJECT_ROOT / "tests" / "gc_growth", ("--gc-stats", "--gc-growth=4")),
+    ("run", PROJECT_ROOT / "tests" / "gc_incremental", ("--gc-stats", "--gc-incremental", "--gc-step=4")),
+    (
+        "run",
+        PROJECT_ROOT / "tests" / "gc_incremental",
+        ("--gc-stats", "--gc-incremental", "--gc-step=4", "--jit", "--jit-threshold=1"),
+    ),
+    ("run", PROJECT_ROOT / "tests" / "gc_pause", ("--gc-incremental", "--gc-step=100000", "--gc-max-pause=1")),
 )
 
 
@@ -17,6 +39,12 @@ def parse_arguments(arguments: Optional[Sequence[str]] = None) -> argparse.Names
     parser = argparse.ArgumentParser(description="Process all Skard golden-test groups.")
     parser.add_argument("action", choices=("test", "generate"))
     parser.add_argument("executable", help="Path or command name of the Skard executable.")
+    parser.add_argument(
+        "--exclude",
+        action="append",
+        default=[],
+        help="Skip the groups whose directory under tests/ has this name. Can be given more than once.",
+    )
     return parser.parse_args(arguments)
 
 
@@ -24,7 +52,10 @@ def main(arguments: Optional[Sequence[str]] = None) -> int:
     args = parse_arguments(arguments)
     failed = False
 
-    for command, tests_dir in TEST_GROUPS:
+    for command, tests_dir, options in TEST_GROUPS:
+        if tests_dir.name in args.exclude:
+            continue
+
         result = subprocess.run(
             [
                 sys.executable,
@@ -36,6 +67,7 @@ def main(arguments: Optional[Sequence[str]] = None) -> int:
                 "--tests-dir",
                 str(tests_dir),
                 "--no-color",
+                *(f"--option={option}" for option in options),
             ],
             cwd=PROJECT_ROOT,
             check=False,